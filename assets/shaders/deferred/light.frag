@@ -0,0 +1,103 @@
+#version 330
+
+// This shader adds the light of one light volume (or of all the directional lights) to the light accumulation target
+// of "DeferredRenderer" using the surface data stored in the G-buffer (see "GBUFFER" in "lighting.frag")
+
+#define MAX_TABLE_LIGHTS 128
+
+#define DIRECTIONAL 0
+#define POINT 1
+#define SPOT 2
+
+// The members are ordered to match "LightBlockElement" in "light-clusters.hpp" (std140 layout)
+struct Light {
+    vec3 position;
+    int type;
+    vec3 direction;
+    float range;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 attenuation; // x*d^2 + y*d + z
+    vec2 cone_angles; // x: inner_angle, y: outer_angle
+};
+
+layout(std140) uniform Camera {
+    mat4 VP;
+    vec3 eye;
+};
+
+layout(std140) uniform Lights {
+    int light_count;
+    Light lights[MAX_TABLE_LIGHTS];
+};
+
+uniform int volume_lights_start;
+
+// The G-buffer targets (read with texelFetch so no sampler is needed)
+uniform sampler2D gbuffer_albedo;   // (albedo, roughness)
+uniform sampler2D gbuffer_specular; // (specular, ambient occlusion)
+uniform sampler2D gbuffer_normal;   // (normal * 0.5 + 0.5, unused)
+uniform sampler2D gbuffer_depth;
+// Transforms a point from the NDC space to the world space
+uniform mat4 inverse_VP;
+
+#ifdef VOLUME
+flat in int light_index;
+#endif
+
+out vec4 frag_color;
+
+// The same lighting model as "shade" in "lighting.frag"
+vec3 shade(Light light, vec3 world, vec3 normal, vec3 view, vec3 material_diffuse, vec3 material_specular, float material_shininess){
+    vec3 direction_to_light = -light.direction;
+    if(light.type != DIRECTIONAL){
+        direction_to_light = normalize(light.position - world);
+    }
+    
+    vec3 diffuse = light.diffuse * material_diffuse * max(0, dot(normal, direction_to_light));
+    
+    vec3 reflected = reflect(-direction_to_light, normal);
+    
+    vec3 specular = light.specular * material_specular * pow(max(0, dot(view, reflected)), material_shininess);
+
+    float attenuation = 1;
+    if(light.type != DIRECTIONAL){
+        float d = distance(light.position, world);
+        attenuation /= dot(light.attenuation, vec3(d*d, d, 1));
+        if(light.type == SPOT){
+            float angle = acos(dot(-direction_to_light, light.direction));
+            attenuation *= smoothstep(light.cone_angles.y, light.cone_angles.x, angle);
+        }
+    }
+
+    return (diffuse + specular) * attenuation;
+}
+
+void main(){
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gbuffer_depth, pixel, 0).r;
+    // Nothing was drawn to the G-buffer at this pixel
+    if(depth == 1.0) discard;
+
+    // Reconstruct the world position of the surface from its depth
+    vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(gbuffer_depth, 0))) * 2.0 - 1.0;
+    vec4 world = inverse_VP * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    world /= world.w;
+
+    vec4 albedo = texelFetch(gbuffer_albedo, pixel, 0);
+    vec3 material_diffuse = albedo.rgb;
+    vec3 material_specular = texelFetch(gbuffer_specular, pixel, 0).rgb;
+    float material_shininess = 2.0 / pow(clamp(albedo.a, 0.001, 0.999), 4.0) - 2.0;
+    vec3 normal = normalize(texelFetch(gbuffer_normal, pixel, 0).xyz * 2.0 - 1.0);
+    vec3 view = normalize(eye - world.xyz);
+
+    // The alpha is 0 so that the alpha of the accumulation target stays 1 with the additive blending
+    frag_color = vec4(0.0);
+#ifdef VOLUME
+    frag_color.rgb = shade(lights[light_index], world.xyz, normal, view, material_diffuse, material_specular, material_shininess);
+#else
+    for(int i = 0; i < volume_lights_start; i++){
+        frag_color.rgb += shade(lights[i], world.xyz, normal, view, material_diffuse, material_specular, material_shininess);
+    }
+#endif
+}
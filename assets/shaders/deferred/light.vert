@@ -0,0 +1,55 @@
+#version 330
+
+// This shader draws the lights of "DeferredRenderer"
+// The "VOLUME" variant draws a sphere around each point & spot light (one instance per light)
+// and the other variant draws a fullscreen triangle for the directional lights
+
+#define MAX_TABLE_LIGHTS 128
+// The light volumes are slightly larger than the influence radius since the sphere mesh is inscribed in the actual sphere
+#define VOLUME_MARGIN 1.05
+
+// The members are ordered to match "LightBlockElement" in "light-clusters.hpp" (std140 layout)
+struct Light {
+    vec3 position;
+    int type;
+    vec3 direction;
+    float range;
+    vec3 diffuse;
+    vec3 specular;
+    vec3 attenuation;
+    vec2 cone_angles;
+};
+
+layout(std140) uniform Camera {
+    mat4 VP;
+    vec3 eye;
+};
+
+// The directional lights come first in the light table, then the lights drawn as volumes
+layout(std140) uniform Lights {
+    int light_count;
+    Light lights[MAX_TABLE_LIGHTS];
+};
+
+uniform int volume_lights_start;
+
+#ifdef VOLUME
+layout(location=0) in vec3 position;
+flat out int light_index;
+#endif
+
+void main(){
+#ifdef VOLUME
+    light_index = volume_lights_start + gl_InstanceID;
+    Light light = lights[light_index];
+    gl_Position = VP * vec4(light.position + position * light.range * VOLUME_MARGIN, 1.0);
+#else
+    // The same fullscreen triangle as "fullscreen.vert"
+    vec2 positions[] = vec2[](
+        vec2(-1.0, -1.0),
+        vec2( 3.0, -1.0),
+        vec2(-1.0,  3.0)
+    );
+    gl_Position = vec4(positions[gl_VertexID], 0.0, 1.0);
+#endif
+}
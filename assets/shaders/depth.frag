@@ -0,0 +1,5 @@
+#version 330
+
+// The depth pre-pass only writes the depth (the color writes are disabled)
+void main(){
+}
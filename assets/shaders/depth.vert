@@ -0,0 +1,24 @@
+#version 330
+
+// This shader draws the depth pre-pass of the lit objects (see "depth-prepass" in "ForwardRenderer")
+// The main pass tests the depth with GL_EQUAL, so the position must be computed exactly like in "lighting.vert"
+
+layout(std140) uniform Camera {
+    mat4 VP;
+    vec3 eye;
+};
+
+#ifdef INSTANCED
+layout(location=4) in mat4 M;
+#else
+uniform mat4 M;
+#endif
+
+layout(location=0) in vec3 position;
+
+invariant gl_Position;
+
+void main(){
+    vec3 world = (M * vec4(position, 1.0)).xyz;
+    gl_Position = VP * vec4(world, 1.0);
+}
@@ -1,29 +1,78 @@
 #version 330
 
 #define MAX_LIGHTS 16
+// The size of the light table read by the "DRAW_LIGHTS" variants (must match "LightSelection::MAX_LIGHTS")
+#define MAX_TABLE_LIGHTS 128
+
+#ifdef DRAW_LIGHTS
+#define LIGHTS_SIZE MAX_TABLE_LIGHTS
+#else
+#define LIGHTS_SIZE MAX_LIGHTS
+#endif
 
 #define DIRECTIONAL 0
 #define POINT 1
 #define SPOT 2
 
+// The members are ordered to match "LightBlockElement" in "light-clusters.hpp" (std140 layout)
 struct Light {
-    int type;
     vec3 position;
+    int type;
     vec3 direction;
+    float range; // The influence radius (only used by the deferred light volumes)
     vec3 diffuse;
     vec3 specular;
     vec3 attenuation; // x*d^2 + y*d + z
     vec2 cone_angles; // x: inner_angle, y: outer_angle
 };
 
-uniform Light lights[MAX_LIGHTS];
-uniform int light_count;
+// The lights and the sky colors are shared by all the draws in a frame (see "UNIFORM_BLOCK_*" in "shader.hpp")
+// In the clustered variant, the "Lights" block only holds the directional lights
+// In the "DRAW_LIGHTS" variants, it holds the light table and each object only walks the lights selected for it
+layout(std140) uniform Lights {
+    int light_count;
+    Light lights[LIGHTS_SIZE];
+};
 
-struct Sky {
+layout(std140) uniform Sky {
     vec3 top, middle, bottom;
+} sky;
+
+#ifdef DRAW_LIGHTS
+flat in uvec2 object_lights;
+#endif
+
+#ifdef CLUSTERED
+// The point and spot lights are assigned to the clusters on the CPU (see "LightClusters" in "light-clusters.hpp")
+// Each light takes 6 texels of "light_data" (one per vec4 of "Light", the type is stored as a float in the first w)
+uniform samplerBuffer light_data;
+// The offset (in "light_indices") and the count of the lights of each cluster
+uniform usamplerBuffer light_grid;
+uniform usamplerBuffer light_indices;
+
+layout(std140) uniform Clusters {
+    mat4 cluster_view;
+    uvec4 cluster_counts;
+    vec4 cluster_depth; // (near, far, scale, bias): the slice of a view depth d is floor(log(d) * scale + bias)
+    vec4 cluster_screen;
 };
 
-uniform Sky sky;
+Light fetchLight(int index){
+    int base = 6 * index;
+    vec4 texel = texelFetch(light_data, base);
+    Light light;
+    light.position = texel.xyz;
+    light.type = int(texel.w + 0.5);
+    texel = texelFetch(light_data, base + 1);
+    light.direction = texel.xyz;
+    light.range = texel.w;
+    light.diffuse = texelFetch(light_data, base + 2).xyz;
+    light.specular = texelFetch(light_data, base + 3).xyz;
+    light.attenuation = texelFetch(light_data, base + 4).xyz;
+    light.cone_angles = texelFetch(light_data, base + 5).xy;
+    return light;
+}
+#endif
 
 struct Material {
     sampler2D albedo;
@@ -43,7 +92,41 @@ in Varyings {
     vec3 world;
 } fs_in;
 
+#ifdef GBUFFER
+// The G-buffer of "DeferredRenderer": the lights are accumulated later from these targets
+// The ambient & emissive light don't depend on the lights so they are written directly to the light accumulation target
+layout(location=0) out vec4 gbuffer_albedo;   // (albedo, roughness)
+layout(location=1) out vec4 gbuffer_specular; // (specular, ambient occlusion)
+layout(location=2) out vec4 gbuffer_normal;   // (normal * 0.5 + 0.5, unused)
+layout(location=3) out vec4 frag_color;
+#else
 out vec4 frag_color;
+#endif
+
+vec3 shade(Light light, vec3 normal, vec3 view, vec3 material_diffuse, vec3 material_specular, float material_shininess){
+    vec3 direction_to_light = -light.direction;
+    if(light.type != DIRECTIONAL){
+        direction_to_light = normalize(light.position - fs_in.world);
+    }
+    
+    vec3 diffuse = light.diffuse * material_diffuse * max(0, dot(normal, direction_to_light));
+    
+    vec3 reflected = reflect(-direction_to_light, normal);
+    
+    vec3 specular = light.specular * material_specular * pow(max(0, dot(view, reflected)), material_shininess);
+
+    float attenuation = 1;
+    if(light.type != DIRECTIONAL){
+        float d = distance(light.position, fs_in.world);
+        attenuation /= dot(light.attenuation, vec3(d*d, d, 1));
+        if(light.type == SPOT){
+            float angle = acos(dot(-direction_to_light, light.direction));
+            attenuation *= smoothstep(light.cone_angles.y, light.cone_angles.x, angle);
+        }
+    }
+
+    return (diffuse + specular) * attenuation;
+}
 
 void main(){
     vec3 view = normalize(fs_in.view);
@@ -64,31 +147,38 @@ void main(){
 
     frag_color = vec4(material_emissive + material_ambient * sky_light, 1.0);
 
+#ifdef GBUFFER
+    gbuffer_albedo = vec4(material_diffuse, material_roughness);
+    gbuffer_specular = vec4(material_specular, texture(material.ambient_occlusion, fs_in.tex_coord).r);
+    gbuffer_normal = vec4(normal * 0.5 + 0.5, 0.0);
+    return;
+#endif
+
+#ifdef DRAW_LIGHTS
+    // The indices are sorted by importance and end at the first unused byte (255)
+    for(int i = 0; i < DRAW_LIGHTS; i++){
+        uint index = ((i < 4 ? object_lights.x : object_lights.y) >> uint(8 * (i % 4))) & 255u;
+        if(index == 255u) break;
+        frag_color.rgb += shade(lights[index], normal, view, material_diffuse, material_specular, material_shininess);
+    }
+#else
     int clamped_light_count = min(MAX_LIGHTS, light_count);
     for(int i = 0; i < clamped_light_count; i++){
-        Light light = lights[i];
-
-        vec3 direction_to_light = -light.direction;
-        if(light.type != DIRECTIONAL){
-            direction_to_light = normalize(light.position - fs_in.world);
-        }
-        
-        vec3 diffuse = light.diffuse * material_diffuse * max(0, dot(normal, direction_to_light));
-        
-        vec3 reflected = reflect(-direction_to_light, normal);
-        
-        vec3 specular = light.specular * material_specular * pow(max(0, dot(view, reflected)), material_shininess);
-
-        float attenuation = 1;
-        if(light.type != DIRECTIONAL){
-            float d = distance(light.position, fs_in.world);
-            attenuation /= dot(light.attenuation, vec3(d*d, d, 1));
-            if(light.type == SPOT){
-                float angle = acos(dot(-direction_to_light, light.direction));
-                attenuation *= smoothstep(light.cone_angles.y, light.cone_angles.x, angle);
-            }
-        }
-
-        frag_color.rgb += (diffuse + specular) * attenuation;
+        frag_color.rgb += shade(lights[i], normal, view, material_diffuse, material_specular, material_shininess);
+    }
+#endif
+
+#ifdef CLUSTERED
+    // Find the cluster of the fragment then only walk the lights that touch it
+    ivec3 counts = ivec3(cluster_counts.xyz);
+    ivec2 tile = ivec2(gl_FragCoord.xy / cluster_screen.xy * vec2(counts.xy));
+    float depth = -(cluster_view * vec4(fs_in.world, 1.0)).z;
+    int slice = int(floor(log(max(depth, cluster_depth.x)) * cluster_depth.z + cluster_depth.w));
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), counts - 1);
+    uvec2 range = texelFetch(light_grid, (cluster.z * counts.y + cluster.y) * counts.x + cluster.x).xy;
+    for(uint i = 0u; i < range.y; i++){
+        int index = int(texelFetch(light_indices, int(range.x + i)).x);
+        frag_color.rgb += shade(fetchLight(index), normal, view, material_diffuse, material_specular, material_shininess);
     }
-}
\ No newline at end of file
+#endif
+}
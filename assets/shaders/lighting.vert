@@ -1,9 +1,29 @@
 #version 330
 
-uniform vec3 eye;
-uniform mat4 VP;
+// The camera data is shared by all the draws in a frame (see "UNIFORM_BLOCK_CAMERA" in "shader.hpp")
+layout(std140) uniform Camera {
+    mat4 VP;
+    vec3 eye;
+};
+
+#ifdef INSTANCED
+// In the instanced variant, each instance reads its own model matrices from the instance buffer
+layout(location=4) in mat4 M;
+layout(location=8) in mat4 MIT;
+#else
 uniform mat4 M;
 uniform mat4 MIT;
+#endif
+
+#ifdef DRAW_LIGHTS
+// The packed indices (one byte each) of the lights that reach the object (see "LightSelection" in "light-selection.hpp")
+#ifdef INSTANCED
+layout(location=12) in uvec2 draw_lights;
+#else
+uniform uvec2 draw_lights;
+#endif
+flat out uvec2 object_lights;
+#endif
 
 layout(location=0) in vec3 position;
 layout(location=1) in vec4 color;
@@ -18,6 +38,9 @@ out Varyings {
     vec3 world;
 } vs_out;
 
+// The position must be the same as in "depth.vert" for the GL_EQUAL depth test after the depth pre-pass
+invariant gl_Position;
+
 void main(){
     vec3 world = (M * vec4(position, 1.0)).xyz;
     gl_Position = VP * vec4(world, 1.0);
@@ -26,4 +49,7 @@ void main(){
     vs_out.normal = normalize((MIT * vec4(normal, 0.0)).xyz);
     vs_out.view = eye - world;
     vs_out.world = world;
+#ifdef DRAW_LIGHTS
+    object_lights = draw_lights;
+#endif
 }
\ No newline at end of file
@@ -6,8 +6,20 @@ layout(location = 1) in vec4 color;
 out Varyings {
     vec4 color;
 } vs_out;
+#ifdef INSTANCED
+// In the instanced variant, the transform is built from the camera VP and the model matrix of each instance
+layout(std140) uniform Camera {
+    mat4 VP;
+    vec3 eye;
+};
+layout(location = 4) in mat4 M;
+#else
 uniform mat4 transform;
+#endif
 void main(){
+#ifdef INSTANCED
+    mat4 transform = VP * M;
+#endif
     //TODO: (Req 6) Change the next line to apply the transformation matrix
     gl_Position =transform * vec4(position, 1.0);
     vs_out.color = color;
@@ -1,9 +1,13 @@
-param([string[]] $tests)
+param([string[]] $tests, [switch] $headless)
+
+# Pass "-headless" to render the tests offscreen (no window or display server is needed)
+$extraArgs = @()
+if ($headless) { $extraArgs += "--headless" }
 
 function Invoke-Tests {
     param([string[]] $configs)
     foreach ($config in $configs){
-        ./bin/GAME_APPLICATION -f=2 -c="$config"
+        ./bin/GAME_APPLICATION -f=2 -c="$config" @extraArgs
     }
 }
 
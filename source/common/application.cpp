@@ -1,4 +1,5 @@
 #include "application.hpp"
+#include "gl-state-cache.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -6,9 +7,11 @@
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <cmath>
 #include <queue>
 #include <tuple>
 #include <filesystem>
+#include <memory>
 
 #include <flags/flags.h>
 
@@ -131,6 +134,14 @@ void our::Application::configureOpenGL() {
 
     //Set the refresh rate of the window (GLFW_DONT_CARE = Run as fast as possible)
     glfwWindowHint(GLFW_REFRESH_RATE, GLFW_DONT_CARE);
+
+    if(headless){
+        // In headless mode, the window is never shown and we ask for an OSMesa context which renders in system memory.
+        // This works with Mesa's software rasterizer (llvmpipe) so it needs neither a GPU nor a display server
+        // (as long as GLFW is built with OSMesa, see the option "GAME_HEADLESS_OSMESA" in "CMakeLists.txt").
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
 }
 
 our::WindowConfiguration our::Application::getWindowConfiguration() {
@@ -165,7 +176,8 @@ int our::Application::run(int run_for_frames) {
 
     // Create a window with the given "WindowConfiguration" attributes.
     // If it should be fullscreen, monitor should point to one of the monitors (e.g. primary monitor), otherwise it should be null
-    GLFWmonitor* monitor = win_config.isFullscreen ? glfwGetPrimaryMonitor() : nullptr;
+    // A headless application is never fullscreen since it has no visible window.
+    GLFWmonitor* monitor = (win_config.isFullscreen && !headless) ? glfwGetPrimaryMonitor() : nullptr;
     // The last parameter "share" can be used to share the resources (OpenGL objects) between multiple windows.
     window = glfwCreateWindow(win_config.size.x, win_config.size.y, win_config.title.c_str(), monitor, nullptr);
     if(!window) {
@@ -183,6 +195,9 @@ int our::Application::run(int run_for_frames) {
     std::cout << "VERSION         : " << glGetString(GL_VERSION) << std::endl;
     std::cout << "GLSL VERSION    : " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
+    // In headless mode, we render into an offscreen framebuffer that has the configured window size
+    if(headless) createOffscreenFrameBuffer(win_config.size);
+
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
     // if we have OpenGL debug messages enabled, set the message callback
     glDebugMessageCallback(opengl_callback, nullptr);
@@ -225,6 +240,32 @@ int our::Application::run(int run_for_frames) {
         }
     }
 
+    // Start the worker threads
+    int worker_count = app_config.value("jobs", nlohmann::json::object()).value("workers", -1);
+    jobSystem.start(worker_count);
+    std::cout << "JOB WORKERS     : " << jobSystem.getWorkerCount() << std::endl;
+
+    // The screenshots are read from the framebuffer on this thread (it owns the OpenGL context)
+    // then they are encoded & saved on the worker threads so that the frame doesn't wait for the png encoder
+    our::JobCounter screenshot_jobs;
+    auto save_screenshot = [this, &screenshot_jobs](const std::string& path){
+        auto image = std::make_shared<our::ScreenshotImage>();
+        our::screenshot_capture(*image);
+        jobSystem.run([image, path](){
+            if(our::screenshot_save_png(path, *image)){
+                std::cout << "Screenshot saved to: " << path << std::endl;
+            } else {
+                std::cerr << "Failed to save a screenshot to: " << path << std::endl;
+            }
+        }, &screenshot_jobs);
+    };
+
+    // Read the simulation rate
+    if(auto simulation = app_config.value("simulation", nlohmann::json::object()); simulation.is_object()) {
+        fixedDeltaTime = 1.0 / simulation.value("rate", 1.0 / fixedDeltaTime);
+        maxFixedSteps = simulation.value("max-steps", maxFixedSteps);
+    }
+
     // If a scene change was requested, apply it
     if(nextState) {
         currentState = nextState;
@@ -257,6 +298,10 @@ int our::Application::run(int run_for_frames) {
         // Render the ImGui commands we called (this doesn't actually draw to the screen yet.
         ImGui::Render();
 
+        // In headless mode, the offscreen framebuffer takes the place of the default framebuffer.
+        // We bind it for both drawing (the state & ImGui) and reading (the screenshots).
+        if(headless) glBindFramebuffer(GL_FRAMEBUFFER, offscreenFrameBuffer);
+
         // Just in case ImGui changed the OpenGL viewport (the portion of the window to which we render the geometry),
         // we set it back to cover the whole window
         auto frame_buffer_size = getFrameBufferSize();
@@ -265,6 +310,19 @@ int our::Application::run(int run_for_frames) {
         // Get the current time (the time at which we are starting the current frame).
         double current_frame_time = glfwGetTime();
 
+        // Run the simulation steps that fit in the time accumulated so far
+        // The steps stop early if the state requested a change since the world might not be valid anymore (e.g. it was cleared)
+        simulationAccumulator += current_frame_time - last_frame_time;
+        int steps = 0;
+        while(currentState && !nextState && steps < maxFixedSteps && simulationAccumulator >= fixedDeltaTime) {
+            currentState->onFixedUpdate(fixedDeltaTime);
+            simulationAccumulator -= fixedDeltaTime;
+            steps++;
+        }
+        // If the simulation can't keep up, the remaining time is dropped (the game slows down instead of falling further behind)
+        if(simulationAccumulator >= fixedDeltaTime) simulationAccumulator = std::fmod(simulationAccumulator, fixedDeltaTime);
+        interpolationAlpha = simulationAccumulator / fixedDeltaTime;
+
         // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
         if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
@@ -275,6 +333,8 @@ int our::Application::run(int run_for_frames) {
         glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+        // ImGui changes the OpenGL state behind the back of the state cache, so the cached state is no longer trusted
+        our::GLStateCache::invalidate();
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
         // Re-enable the debug messages
         glEnable(GL_DEBUG_OUTPUT);
@@ -284,27 +344,18 @@ int our::Application::run(int run_for_frames) {
         // If F12 is pressed, take a screenshot
         if(keyboard.justPressed(GLFW_KEY_F12)){
             glViewport(0, 0, frame_buffer_size.x, frame_buffer_size.y);
-            std::string path = default_screenshot_filepath();
-            if(our::screenshot_png(path)){
-                std::cout << "Screenshot saved to: " << path << std::endl;
-            } else {
-                std::cerr << "Failed to save a Screenshot" << std::endl;
-            }
+            save_screenshot(default_screenshot_filepath());
         }
         // There are any requested screenshots, take them
         while(requested_screenshots.size()){ 
             if(const auto& request = requested_screenshots.top(); request.first == current_frame){
-                if(our::screenshot_png(request.second)){
-                    std::cout << "Screenshot saved to: " << request.second << std::endl;
-                } else {
-                    std::cerr << "Failed to save a screenshot to: " << request.second << std::endl;
-                }
+                save_screenshot(request.second);
                 requested_screenshots.pop();
             } else break;
         }
 
-        // Swap the frame buffers
-        glfwSwapBuffers(window);
+        // Swap the frame buffers (a headless application has nothing to present)
+        if(!headless) glfwSwapBuffers(window);
 
         // Update the keyboard and mouse data
         keyboard.update();
@@ -319,6 +370,9 @@ int our::Application::run(int run_for_frames) {
             nextState = nullptr;
             // Initialize the new scene
             currentState->onInitialize();
+            // The time spent before the change (and in initializing the scene) should not be simulated by the new scene
+            simulationAccumulator = 0;
+            last_frame_time = glfwGetTime();
         }
 
         ++current_frame;
@@ -327,11 +381,18 @@ int our::Application::run(int run_for_frames) {
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
 
+    // Finish saving the screenshots then stop the worker threads
+    jobSystem.wait(screenshot_jobs);
+    jobSystem.stop();
+
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    // Delete the offscreen framebuffer while its context still exists
+    destroyOffscreenFrameBuffer();
+
     // Destroy the window
     glfwDestroyWindow(window);
 
@@ -340,6 +401,39 @@ int our::Application::run(int run_for_frames) {
     return 0; // Good bye
 }
 
+// Creates a framebuffer with an RGBA8 color renderbuffer and a 24-bit depth (+ 8-bit stencil) renderbuffer of the given size.
+// This matches the default framebuffer requested in "configureOpenGL" so the states render the same whether headless or not.
+void our::Application::createOffscreenFrameBuffer(glm::ivec2 size) {
+    offscreenSize = size;
+
+    glGenRenderbuffers(1, &offscreenColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+    glGenRenderbuffers(1, &offscreenDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &offscreenFrameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFrameBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepthBuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        std::cerr << "The offscreen framebuffer is incomplete" << std::endl;
+    }
+}
+
+// Deletes the offscreen framebuffer and its renderbuffers (if they were created)
+void our::Application::destroyOffscreenFrameBuffer() {
+    if(offscreenFrameBuffer == 0) return;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &offscreenFrameBuffer);
+    glDeleteRenderbuffers(1, &offscreenColorBuffer);
+    glDeleteRenderbuffers(1, &offscreenDepthBuffer);
+    offscreenFrameBuffer = offscreenColorBuffer = offscreenDepthBuffer = 0;
+}
+
 // Sets-up the window callback functions from GLFW to our (Mouse/Keyboard) classes.
 void our::Application::setupCallbacks() {
 
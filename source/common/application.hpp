@@ -12,6 +12,7 @@
 
 #include "input/keyboard.hpp"
 #include "input/mouse.hpp"
+#include "jobs/job-system.hpp"
 
 namespace our {
 
@@ -33,6 +34,7 @@ namespace our {
     public:
         virtual void onInitialize(){}                   // Called once before the game loop.
         virtual void onImmediateGui(){}                 // Called every frame to draw the Immediate GUI (if any).
+        virtual void onFixedUpdate(double fixedDeltaTime){} // Called at a fixed rate to advance the simulation (zero or more times per frame before onDraw).
         virtual void onDraw(double deltaTime){}         // Called every frame in the game loop passing the time taken to draw the frame "Delta time".
         virtual void onDestroy(){}                      // Called once after the game loop ends for house cleaning.
 
@@ -53,6 +55,12 @@ namespace our {
     class Application {
     protected:
         GLFWwindow * window = nullptr;      // Pointer to the window created by GLFW using "glfwCreateWindow()".
+
+        bool headless = false;              // If true, the window is hidden and every frame is rendered into an offscreen framebuffer.
+        glm::ivec2 offscreenSize = {0, 0};  // The size of the offscreen framebuffer (equal to the configured window size).
+        GLuint offscreenFrameBuffer = 0;    // The offscreen framebuffer used instead of the default framebuffer in headless mode.
+        GLuint offscreenColorBuffer = 0;    // The color renderbuffer attached to the offscreen framebuffer.
+        GLuint offscreenDepthBuffer = 0;    // The depth-stencil renderbuffer attached to the offscreen framebuffer.
         
         Keyboard keyboard;                  // Instance of "our" keyboard class that handles keyboard functionalities.
         Mouse mouse;                        // Instance of "our" mouse class that handles mouse functionalities.
@@ -63,6 +71,19 @@ namespace our {
         State * currentState = nullptr;         // This will store the current scene that is being run
         State * nextState = nullptr;            // If it is requested to go to another scene, this will contain a pointer to that scene
 
+        // The simulation runs in fixed steps that are independent of the frame rate (see "State::onFixedUpdate").
+        // Each frame adds its duration to the accumulator then runs as many steps as the accumulated time allows.
+        // The number of steps per frame is clamped so that a slow frame doesn't cause even more work on the next frame.
+        // The values are read from "simulation" in the config ("rate" in steps per second & "max-steps" per frame).
+        double fixedDeltaTime = 1.0 / 120.0;
+        int maxFixedSteps = 8;
+        double simulationAccumulator = 0;   // The time that was not simulated yet (less than a step after each frame)
+        double interpolationAlpha = 0;      // The fraction of a step in the accumulator (used to interpolate the drawn transforms)
+
+        // The job system is started by "run" with the number of workers given in "jobs" in the config ("workers", default: -1
+        // which starts one worker per hardware thread except the main thread). It is available to the states during the whole run.
+        JobSystem jobSystem;
+
         
         // Virtual functions to be overrode and change the default behaviour of the application
         // according to the example needs.
@@ -70,10 +91,14 @@ namespace our {
         virtual WindowConfiguration getWindowConfiguration();       // Returns the WindowConfiguration current struct instance.
         virtual void setupCallbacks();                              // Sets-up the window callback functions from GLFW to our (Mouse/Keyboard) classes.
 
+        void createOffscreenFrameBuffer(glm::ivec2 size);           // Creates the framebuffer that replaces the window in headless mode.
+        void destroyOffscreenFrameBuffer();                         // Deletes the offscreen framebuffer (if any).
+
     public:
 
         // Create an application with following configuration
-        Application(const nlohmann::json& app_config) : app_config(app_config) {}
+        // If headless is true, no visible window is shown and the frames are rendered offscreen (useful for batch tests and benchmarks)
+        Application(const nlohmann::json& app_config, bool headless = false) : headless(headless), app_config(app_config) {}
         // On destruction, delete all the states
         ~Application(){ for (auto &it : states) delete it.second; }
 
@@ -114,8 +139,22 @@ namespace our {
 
         [[nodiscard]] const nlohmann::json& getConfig() const { return app_config; }
 
+        // Returns the job system used to run work on the worker threads (see "JobSystem")
+        JobSystem& getJobSystem() { return jobSystem; }
+
+        // Returns the duration of a simulation step in seconds
+        [[nodiscard]] double getFixedDeltaTime() const { return fixedDeltaTime; }
+        // Returns how far the current frame is between the last simulation step and the next one (in the range [0, 1])
+        // The states draw their entities at a blend of their previous & current transforms using this value (see "World::beginInterpolation")
+        [[nodiscard]] double getInterpolationAlpha() const { return interpolationAlpha; }
+
+        // Returns whether the application is rendering offscreen without a visible window.
+        [[nodiscard]] bool isHeadless() const { return headless; }
+
         // Get the size of the frame buffer of the window in pixels.
+        // In headless mode, this is the size of the offscreen framebuffer.
         glm::ivec2 getFrameBufferSize() {
+            if(headless) return offscreenSize;
             glm::ivec2 size;
             glfwGetFramebufferSize(window, &(size.x), &(size.y));
             return size;
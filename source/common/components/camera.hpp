@@ -23,6 +23,8 @@ namespace our {
 
         // The ID of this component type is "Camera"
         static std::string getID() { return "Camera"; }
+        // The index of this component type in the entity's component table
+        static constexpr ComponentType getTypeIndex() { return ComponentType::CAMERA; }
 
         // Reads camera parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
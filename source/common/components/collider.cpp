@@ -0,0 +1,15 @@
+#include "collider.hpp"
+#include "../deserialize-utils.hpp"
+
+namespace our {
+    // Reads the collider parameters from the given json object
+    void ColliderComponent::deserialize(const nlohmann::json& data){
+        if(!data.is_object()) return;
+        isStatic = data.value("static", isStatic);
+        swept = data.value("swept", swept);
+        useMeshBounds = !data.contains("extents");
+        center = data.value("center", center);
+        extents = data.value("extents", extents);
+        padding = data.value("padding", padding);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../ecs/component.hpp"
+
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // This component denotes that the owning entity takes part in the collision detection (see "common/systems/collision.hpp").
+    // The collider is an axis aligned bounding box in world space. By default, it is computed from the bounds of the mesh
+    // drawn by the entity's mesh renderer, otherwise, it is computed from the local box given by "center" & "extents".
+    class ColliderComponent : public Component {
+    public:
+        // Static colliders are only tested against the non-static ones (e.g. obstacles are only tested against the car).
+        // A static collider can still be moved, it just doesn't need to know when it touches other static colliders.
+        bool isStatic = false;
+        // A swept collider is tested along the path it moved since the last update instead of only at its current position.
+        // This should be enabled for fast movers so that they don't pass through thin colliders between two frames.
+        bool swept = false;
+        // If true and the entity has a mesh renderer, the local box is the bounds of its mesh
+        bool useMeshBounds = true;
+        glm::vec3 center = {0, 0, 0};  // The center of the local box
+        glm::vec3 extents = {1, 1, 1}; // The half size of the local box
+        glm::vec3 padding = {0, 0, 0}; // Added to the half size of the world space box (e.g. to make a thin object easier to hit)
+
+        // The world space box of the last update (used by the swept test). It is maintained by the collision system.
+        glm::vec3 previousMin = {0, 0, 0}, previousMax = {0, 0, 0};
+        bool hasPrevious = false;
+
+        // Call this after teleporting a swept collider so that the jump is not tested as a motion
+        void resetMotion() { hasPrevious = false; }
+
+        // The ID of this component type is "Collider"
+        static std::string getID() { return "Collider"; }
+        // The index of this component type in the entity's component table
+        static constexpr ComponentType getTypeIndex() { return ComponentType::COLLIDER; }
+
+        // Reads the collider parameters from the given json object
+        // If "extents" is given, the local box is used instead of the mesh bounds
+        void deserialize(const nlohmann::json& data) override;
+    };
+
+}
@@ -21,6 +21,8 @@ namespace our {
 
         // The ID of this component type is "Free Camera Controller"
         static std::string getID() { return "Free Camera Controller"; }
+        // The index of this component type in the entity's component table
+        static constexpr ComponentType getTypeIndex() { return ComponentType::FREE_CAMERA_CONTROLLER; }
 
         // Reads sensitivities & speedupFactor from the given json object
         void deserialize(const nlohmann::json& data) override;
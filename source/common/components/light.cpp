@@ -1,6 +1,9 @@
 #include "light.hpp"
 #include "../deserialize-utils.hpp"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 namespace our
 {
@@ -25,6 +28,7 @@ namespace our
     else if (lightTypeStr == "SPOT")
     {
       lightType = LightType::SPOT;
+      attenuation = data.value("attenuation", attenuation);
       cone_angles = data.value("cone_angles", cone_angles);
     }
 
@@ -34,4 +38,23 @@ namespace our
     direction= data.value("direction",direction);
 
   }
-}
\ No newline at end of file
+
+  float LightComponent::getInfluenceRadius(float threshold) const
+  {
+    const float infinity = std::numeric_limits<float>::infinity();
+    if (lightType == LightType::DIRECTIONAL)
+      return infinity;
+    float intensity = std::max({diffuse.x, diffuse.y, diffuse.z, specular.x, specular.y, specular.z});
+    if (intensity <= 0.0f)
+      return 0.0f;
+    // Solve a*d^2 + b*d + c = intensity / threshold for the largest d
+    float a = attenuation.x, b = attenuation.y, c = attenuation.z - intensity / threshold;
+    if (c >= 0.0f)
+      return 0.0f; // Even at the light position, the contribution is below the threshold
+    if (a > 0.0f)
+      return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+    if (b > 0.0f)
+      return -c / b;
+    return infinity;
+  }
+}
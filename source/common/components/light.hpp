@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include "../ecs/component.hpp"
 #include <glm/glm.hpp>
+#include <limits>
 
 namespace our
 {
@@ -30,9 +31,17 @@ namespace our
 
     // The ID of this component type is "Light"
     static std::string getID() { return "Light"; }
+    // The index of this component type in the entity's component table
+    static constexpr ComponentType getTypeIndex() { return ComponentType::LIGHT; }
 
     // Reads Light parameters from the given json object
     void deserialize(const nlohmann::json &data) override;
+
+    // Returns the distance beyond which the light contributes less than "threshold" (relative to a light of intensity 1)
+    // The light intensity falls as 1 / (attenuation.x * d^2 + attenuation.y * d + attenuation.z), so the radius is where this
+    // falls below threshold / intensity, where the intensity is the largest diffuse or specular channel.
+    // Returns infinity for the directional lights and for the lights whose attenuation doesn't grow with the distance.
+    float getInfluenceRadius(float threshold) const;
   };
 
 } // namespace our
\ No newline at end of file
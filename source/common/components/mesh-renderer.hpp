@@ -15,6 +15,8 @@ namespace our {
 
         // The ID of this component type is "Mesh Renderer"
         static std::string getID() { return "Mesh Renderer"; }
+        // The index of this component type in the entity's component table
+        static constexpr ComponentType getTypeIndex() { return ComponentType::MESH_RENDERER; }
 
         // Receives the mesh & material from the AssetLoader by the names given in the json object
         void deserialize(const nlohmann::json& data) override;
@@ -17,6 +17,8 @@ namespace our {
 
         // The ID of this component type is "Movement"
         static std::string getID() { return "Movement"; }
+        // The index of this component type in the entity's component table
+        static constexpr ComponentType getTypeIndex() { return ComponentType::MOVEMENT; }
 
         // Reads linearVelocity & angularVelocity from the given json object
         void deserialize(const nlohmann::json& data) override;
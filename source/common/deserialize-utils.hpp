@@ -111,6 +111,18 @@ namespace our {
                 {"GL_MIN", GL_MIN},
                 {"GL_MAX", GL_MAX}
         };
+
+        inline EnumMap texture_formats = {
+                {"GL_R8", GL_R8},
+                {"GL_RG8", GL_RG8},
+                {"GL_RGBA8", GL_RGBA8},
+                {"GL_RGB10_A2", GL_RGB10_A2},
+                {"GL_R11F_G11F_B10F", GL_R11F_G11F_B10F},
+                {"GL_R16F", GL_R16F},
+                {"GL_RG16F", GL_RG16F},
+                {"GL_RGBA16F", GL_RGBA16F},
+                {"GL_RGBA32F", GL_RGBA32F}
+        };
     }
 
 }
\ No newline at end of file
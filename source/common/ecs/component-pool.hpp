@@ -0,0 +1,120 @@
+#pragma once
+
+#include "component.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace our {
+
+    // The base of all the component pools, it allows the entity to release a component without knowing its type
+    class ComponentPoolBase {
+    public:
+        virtual void destroy(Component* component) = 0;
+        virtual ~ComponentPoolBase() = default;
+    };
+
+    // A component pool stores all the components of one type contiguously in fixed size chunks.
+    // Iterating over a pool walks the chunks linearly instead of chasing a pointer per entity.
+    // The components are never moved (a chunk is never reallocated) so the pointers held by the entities stay valid.
+    // The slots of the destroyed components are reused by the next created components.
+    template<typename T>
+    class ComponentPool : public ComponentPoolBase {
+    public:
+        // The number of components in each chunk
+        static constexpr std::uint32_t CHUNK_SIZE = 1024;
+
+    private:
+        struct Chunk {
+            alignas(T) unsigned char storage[CHUNK_SIZE * sizeof(T)];
+            bool alive[CHUNK_SIZE] = {}; // Whether each slot holds a component
+            std::uint32_t generations[CHUNK_SIZE] = {}; // Incremented whenever the component of a slot is destroyed
+        };
+
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::vector<std::uint32_t> freeSlots; // The slots that were released and can be reused
+        std::uint32_t slotCount = 0;          // The number of slots used so far (alive or free)
+        std::uint32_t aliveCount = 0;
+
+        T* slot(std::uint32_t index) const {
+            return reinterpret_cast<T*>(chunks[index / CHUNK_SIZE]->storage) + (index % CHUNK_SIZE);
+        }
+
+    public:
+        // Creates a component in a free slot and returns a pointer to it
+        T* create() {
+            std::uint32_t index;
+            if(!freeSlots.empty()) {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                index = slotCount++;
+                if(index / CHUNK_SIZE >= chunks.size()) chunks.push_back(std::make_unique<Chunk>());
+            }
+            T* component = new (slot(index)) T();
+            component->poolSlot = index;
+            component->poolGeneration = chunks[index / CHUNK_SIZE]->generations[index % CHUNK_SIZE];
+            chunks[index / CHUNK_SIZE]->alive[index % CHUNK_SIZE] = true;
+            aliveCount++;
+            return component;
+        }
+
+        // Destroys a component created by this pool and releases its slot
+        void destroy(Component* component) override {
+            std::uint32_t index = component->poolSlot;
+            static_cast<T*>(component)->~T();
+            chunks[index / CHUNK_SIZE]->alive[index % CHUNK_SIZE] = false;
+            chunks[index / CHUNK_SIZE]->generations[index % CHUNK_SIZE]++;
+            freeSlots.push_back(index);
+            aliveCount--;
+        }
+
+        // Returns the number of components in this pool
+        std::uint32_t size() const { return aliveCount; }
+
+        // Calls "function(component)" for every component in this pool in memory order
+        template<typename Function>
+        void forEach(Function&& function) const {
+            for(std::uint32_t chunkIndex = 0; chunkIndex < chunks.size(); chunkIndex++) {
+                Chunk& chunk = *chunks[chunkIndex];
+                std::uint32_t end = std::min(CHUNK_SIZE, slotCount - chunkIndex * CHUNK_SIZE);
+                T* components = reinterpret_cast<T*>(chunk.storage);
+                for(std::uint32_t index = 0; index < end; index++)
+                    if(chunk.alive[index]) function(components[index]);
+            }
+        }
+
+        ~ComponentPool() override {
+            for(std::uint32_t index = 0; index < slotCount; index++)
+                if(chunks[index / CHUNK_SIZE]->alive[index % CHUNK_SIZE]) slot(index)->~T();
+        }
+    };
+
+    // This holds one pool for each component type (the pools are created the first time they are needed)
+    class ComponentPools {
+        std::unique_ptr<ComponentPoolBase> pools[COMPONENT_TYPE_COUNT];
+    public:
+        // Returns the pool of the component type T
+        template<typename T>
+        ComponentPool<T>& get() {
+            auto& pool = pools[static_cast<std::size_t>(T::getTypeIndex())];
+            if(!pool) pool = std::make_unique<ComponentPool<T>>();
+            return static_cast<ComponentPool<T>&>(*pool);
+        }
+
+        // Returns the pool of the component type T if it exists (or nullptr if no component of type T was ever created)
+        template<typename T>
+        const ComponentPool<T>* find() const {
+            return static_cast<const ComponentPool<T>*>(pools[static_cast<std::size_t>(T::getTypeIndex())].get());
+        }
+
+        // Destroys a component given its type index
+        void destroy(std::size_t typeIndex, Component* component) {
+            pools[typeIndex]->destroy(component);
+        }
+    };
+
+}
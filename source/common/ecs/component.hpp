@@ -2,28 +2,59 @@
 
 #include <json/json.hpp>
 #include <string>
+#include <cstdint>
 
 namespace our {
 
     class Entity; // A forward declaration of the Entity Class
 
+    // Each type of components has a unique index that is known at compile time
+    // The entity stores its components in a table indexed by these values, so finding a component needs no hashing nor casting checks
+    // When you create a new type of components, add an index for it here and return it from its "getTypeIndex"
+    enum class ComponentType : std::uint8_t {
+        CAMERA,
+        MESH_RENDERER,
+        FREE_CAMERA_CONTROLLER,
+        MOVEMENT,
+        LIGHT,
+        COLLIDER,
+        COUNT // The number of component types (must be last)
+    };
+
+    // The number of component types and a mask type that has one bit per component type
+    constexpr std::size_t COMPONENT_TYPE_COUNT = static_cast<std::size_t>(ComponentType::COUNT);
+    using ComponentMask = std::uint32_t;
+    static_assert(COMPONENT_TYPE_COUNT <= sizeof(ComponentMask) * 8, "ComponentMask must have a bit for every component type");
+
+    // Returns the mask bit of the given component type
+    constexpr ComponentMask componentBit(ComponentType type) { return ComponentMask(1) << static_cast<std::size_t>(type); }
+
     // A component is a data container that can be added to an entity.
     // The role of the entity in the world is defined by the components it holds.
     // For example, an entity with a camera component specifies that this entity should be used as a camera
     // Thus any renderer system should look for an entity holding a camera component in order to compute the camera related uniforms (e.g. VP matrix)
     class Component {
         Entity* owner; // A pointer to the entity that owns this component
+        std::uint32_t poolSlot; // The slot of this component in its pool (see "component-pool.hpp")
+        std::uint32_t poolGeneration; // The generation of its slot (incremented whenever a component in this slot is destroyed)
         friend Entity; // The entity is a friend since it is the only one allowed to set itself as an owner of a certain component.
+        template<typename T> friend class ComponentPool; // The pool is a friend since it is the only one allowed to set the slot
     public:
         // This static method returns a unique string that identifies each type of components
-        // This ID will be used as the key to store a component into the entity's component map 
+        // This ID is the type name used in the json files (see "deserializeComponent")
         // When you create a new type of components, override this function to return a new unique ID
         static std::string getID() { return "Component"; }
+        // Each component type should also define "static constexpr ComponentType getTypeIndex()"
+        // which returns its index in the entity's component table (see "ComponentType")
         // Reads the data of the component from a json object
         // It is abstract since it must be overriden by derived components
         virtual void deserialize(const nlohmann::json& data) = 0;
         // Returns the owner of this component
         Entity* getOwner() const { return owner; }
+        // Returns the slot of this component in its pool and the generation of that slot
+        // Together, they identify this component among all the components of its type that were ever created in the world
+        std::uint32_t getPoolSlot() const { return poolSlot; }
+        std::uint32_t getPoolGeneration() const { return poolGeneration; }
         // Define a virtual destructor
         virtual ~Component(){}
     };
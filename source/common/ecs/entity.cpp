@@ -1,4 +1,5 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
@@ -10,26 +11,69 @@ namespace our {
     // Remember that you can get the transformation matrix from this entity to its parent from "localTransform"
     // To get the local to world matrix, you need to combine this entities matrix with its parent's matrix and
     // its parent's parent's matrix and so on till you reach the root.
-    glm::mat4 Entity::getLocalToWorldMatrix() const {
+    const glm::mat4& Entity::getLocalToWorldMatrix() const {
         //TODO: (Req 7) Write this function
-        glm::mat4 All_T=  localTransform.toMat4(); // All transfromation matrices from child to the root 
-        Entity * next =parent;
-        while (next!=nullptr)
-        {
-            All_T= next->localTransform.toMat4()*All_T; // multiply transfromation matrices till the root
-            next =next->parent;
-            
+        updateMatrices();
+        return worldMatrix;
+    }
+
+    const glm::mat4& Entity::getLocalToWorldInverseTranspose() const {
+        updateMatrices();
+        // The inverse is only computed when it is requested (not every entity needs it)
+        if(!inverseTransposeValid){
+            worldInverseTranspose = glm::transpose(glm::inverse(worldMatrix));
+            inverseTransposeValid = true;
         }
-        
-        return All_T;
+        return worldInverseTranspose;
+    }
+
+    void Entity::updateMatrices() const {
+        // If the world already composed the local matrix in a batch, only the world matrix has to be recomputed
+        bool changed = localMatrixUpdated;
+        // Nothing is written when the matrices are up to date, so after "World::updateTransforms" the matrices
+        // can be read from multiple threads (e.g. by the jobs that build the render commands)
+        if(localMatrixUpdated) localMatrixUpdated = false;
+        // Recompute the local matrix if it was never computed or if the transform was modified since the last time
+        // (which includes a transform modified after the batch)
+        if((!matricesValid && !changed) || localTransform != cachedTransform){
+            localMatrix = localTransform.toMat4();
+            cachedTransform = localTransform;
+            changed = true;
+        }
+        // The parent is brought up to date first, then we check if its world matrix changed (or if the parent itself changed)
+        if(parent){
+            parent->updateMatrices();
+            if(parent != cachedParent || parent->worldVersion != cachedParentVersion) changed = true;
+        } else if(cachedParent) {
+            changed = true;
+        }
+        if(!changed) return;
+        // multiply the local matrix by the parent's world matrix (which already combines all the matrices till the root)
+        worldMatrix = parent ? parent->worldMatrix * localMatrix : localMatrix;
+        cachedParent = parent;
+        cachedParentVersion = parent ? parent->worldVersion : 0;
+        worldVersion++;
+        matricesValid = true;
+        inverseTransposeValid = false;
+    }
+
+    void Entity::setName(std::string_view name){
+        NameId id = names::intern(name);
+        if(id == nameId) return;
+        world->unindexName(this);
+        nameId = id;
+        world->indexName(this);
     }
 
     // Deserializes the entity data and components from a json object
     void Entity::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
-        name = data.value("name", name);
-        // in case gas/obstacle we send it's type to random it's position on x-axis
-        localTransform.deserialize(data,name.substr(0,3)=="gas" || name.substr(0,3)=="can" ? 'g': (name.substr(0,4)=="wall" || name.substr(0,4)=="bump")?'o':' ');
+        if(data.contains("name")) setName(data["name"].get<std::string>());
+        // The tags are given as an array of strings (e.g. "tags": ["obstacle", "wall"])
+        if(auto it = data.find("tags"); it != data.end() && it->is_array()){
+            for(const auto& tag : *it) tags |= tags::get(tag.get<std::string>());
+        }
+        localTransform.deserialize(data);
 
         if(data.contains("components")){
             if(const auto& components = data["components"]; components.is_array()){
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "component.hpp"
+#include "component-pool.hpp"
+#include "names.hpp"
 #include "transform.hpp"
-#include <unordered_map>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <type_traits>
 #include <glm/glm.hpp>
 
@@ -11,60 +14,156 @@ namespace our {
 
     class World; // A forward declaration of the World Class
 
+    // A handle is a 32-bit reference to an entity that can be checked for validity in O(1) (see "World::get")
+    // It packs the index of the entity's slot in the world's entity pool and the generation of that slot.
+    // The generation of a slot is incremented whenever its entity is destroyed, so the handles of a destroyed entity
+    // stop resolving even if its slot is reused. Unlike a raw pointer, a handle can be safely kept across frames.
+    struct EntityHandle {
+        static constexpr std::uint32_t INDEX_BITS = 20;
+        static constexpr std::uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+        static constexpr std::uint32_t MAX_INDEX = (1u << INDEX_BITS) - 1;
+        static constexpr std::uint32_t MAX_GENERATION = (1u << GENERATION_BITS) - 1;
+
+        std::uint32_t value = 0; // 0 is the null handle (generations start from 1)
+
+        EntityHandle() = default;
+        EntityHandle(std::uint32_t index, std::uint32_t generation) : value((generation << INDEX_BITS) | index) {}
+
+        std::uint32_t getIndex() const { return value & MAX_INDEX; }
+        std::uint32_t getGeneration() const { return value >> INDEX_BITS; }
+        bool isNull() const { return value == 0; }
+
+        bool operator==(const EntityHandle& other) const { return value == other.value; }
+        bool operator!=(const EntityHandle& other) const { return value != other.value; }
+    };
+
     class Entity{
         World *world; // This defines what world own this entity
-        std::unordered_map<std::string, Component*> components; // A map of components that are owned by this entity
-                                                                // The key is the ID of the component so an entity can only have one component of each type
+        ComponentPools *pools; // The pools of the world in which the components of this entity are stored
+        EntityHandle handle;   // The handle that refers to this entity
+        std::uint32_t listIndex; // The index of this entity in the world's list of entities
+        bool markedForRemoval = false; // Whether this entity will be destroyed when the world applies the pending removals
+        bool enabled = true; // Whether the systems should process this entity (see "setEnabled")
+
+        // The transform at the start of the last simulation step and the simulated transform that is saved while
+        // "localTransform" holds the interpolated one for drawing (see "World::beginInterpolation")
+        Transform previousTransform;
+        Transform simulatedTransform;
+        bool hasPreviousTransform = false;
+        NameId nameId = names::EMPTY; // The interned name of this entity (the world indexes the entities by it)
+        TagMask tags = 0; // The tags of this entity (see "tags::get")
+        // The components owned by this entity indexed by their type index (see "ComponentType")
+        // An entity can only have one component of each type and the slots of the missing types are null
+        Component* components[COMPONENT_TYPE_COUNT] = {};
+        ComponentMask componentMask = 0; // Has the bit of each component type that this entity holds
+
+        // The cached matrices of this entity. Since "localTransform" is modified directly by the systems,
+        // a change is detected by comparing it with the transform from which "localMatrix" was computed.
+        // The world matrix is recomputed only if the local matrix changed or the parent's world matrix changed
+        // (which is detected by comparing the parent's "worldVersion" with the one it had when the world matrix was computed).
+        // They are mutable since they are a cache that is updated on demand by the const getters.
+        mutable Transform cachedTransform;
+        mutable glm::mat4 localMatrix = glm::mat4(1.0f);
+        mutable glm::mat4 worldMatrix = glm::mat4(1.0f);
+        mutable glm::mat4 worldInverseTranspose = glm::mat4(1.0f);
+        mutable const Entity* cachedParent = nullptr;
+        mutable std::uint32_t cachedParentVersion = 0;
+        mutable std::uint32_t worldVersion = 0; // Incremented whenever the world matrix changes
+        mutable bool matricesValid = false;
+        mutable bool localMatrixUpdated = false; // Set when the world composed the local matrix in a batch (see "World::updateTransforms")
+        mutable bool inverseTransposeValid = false;
+
+        // Recomputes the cached matrices of this entity (and its ancestors) if they are out of date
+        void updateMatrices() const;
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
     public:
-        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
         Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
                           // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
 
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
+        EntityHandle getHandle() const { return handle; } // Returns a handle that refers to this entity (see "EntityHandle")
 
-        glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
+        // The name of the entity. It could be useful to refer to an entity by its name (see "World::findByName")
+        // The name is interned, so it is changed via "setName" which also keeps the world's name index up to date
+        const std::string& getName() const { return names::get(nameId); }
+        NameId getNameId() const { return nameId; }
+        void setName(std::string_view name);
+
+        // The tags are a bitset so checking whether an entity belongs to a category is a single bitwise test
+        TagMask getTags() const { return tags; }
+        // Returns true if this entity has all the tags in the mask
+        bool hasTags(TagMask mask) const { return (tags & mask) == mask; }
+        // Returns true if this entity has at least one of the tags in the mask
+        bool hasAnyTag(TagMask mask) const { return (tags & mask) != 0; }
+        void addTags(TagMask mask) { tags |= mask; }
+        void removeTags(TagMask mask) { tags &= ~mask; }
+
+        // Returns the transformation from the entities local space to the world space
+        // The matrix is cached and only recomputed when the transform of this entity or one of its ancestors changes
+        const glm::mat4& getLocalToWorldMatrix() const;
+        // Returns the inverse transpose of the local to world matrix (used to transform the normals)
+        const glm::mat4& getLocalToWorldInverseTranspose() const;
+        // Returns a number that changes whenever the world matrix changes (so a cached copy of the matrix can be checked cheaply)
+        // It is only up to date after the matrix is requested or after "World::updateTransforms"
+        std::uint32_t getWorldVersion() const { return worldVersion; }
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
         
+        // A disabled entity stays in the world but it is skipped by the views, so the systems ignore it (it is not drawn, moved, etc.)
+        // This is used to keep inactive entities in a pool instead of destroying and creating them again (see "SpawnerSystem")
+        // Note that disabling an entity doesn't disable its children
+        bool isEnabled() const { return enabled; }
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+
+        // Call this after teleporting an entity so that it is not drawn sliding from its old place during the next frame
+        void resetInterpolation() { hasPreviousTransform = false; }
+
+        // Returns the mask of the component types held by this entity
+        ComponentMask getComponentMask() const { return componentMask; }
+
+        // Returns true if this entity holds all the components in the given mask
+        bool hasComponents(ComponentMask mask) const { return (componentMask & mask) == mask; }
+
         // This template method create a component of type T,
-        // adds it to the components map and returns a pointer to it 
+        // adds it to the components table and returns a pointer to it
+        // If the entity already has a component of type T, it is replaced
         template<typename T>
         T* addComponent(){
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            T* component = new T();
+            constexpr std::size_t index = static_cast<std::size_t>(T::getTypeIndex());
+            if(components[index]) pools->destroy(index, components[index]);
+            T* component = pools->get<T>().create();
             component->owner = this;
-            components[T::getID()] = component;
+            components[index] = component;
+            componentMask |= componentBit(T::getTypeIndex());
             return component;
         }
 
         // This template method searhes for a component of type T and returns a pointer to it
-        // If no component of type T was found, it returns a nullptr 
+        // If no component of type T was found, it returns a nullptr
+        // Since each slot only holds components of its own type, the cast needs no runtime check
         template<typename T>
-        T* getComponent(){
+        T* getComponent() const {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            if(auto it = components.find(static_cast<std::string>(T::getID())); it != components.end()){
-                return dynamic_cast<T*>(it->second);
-            }
-            return nullptr;
+            return static_cast<T*>(components[static_cast<std::size_t>(T::getTypeIndex())]);
         }
 
         // This template method searhes for a component of type T and deletes it
         template<typename T>
         void deleteComponent(){
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            if(auto it = components.find(static_cast<std::string>(T::getID())); it != components.end()){
-                delete it->second;
-                components.erase(it);
-            }
+            constexpr std::size_t index = static_cast<std::size_t>(T::getTypeIndex());
+            if(components[index]) pools->destroy(index, components[index]);
+            components[index] = nullptr;
+            componentMask &= ~componentBit(T::getTypeIndex());
         }
 
-        // Since the entity owns its components, they should be deleted alongside the entity
+        // Since the entity owns its components, they should be released to their pools alongside the entity
         ~Entity(){
-            for(auto& it : components){
-                delete it.second;
+            for(std::size_t index = 0; index < COMPONENT_TYPE_COUNT; index++){
+                if(components[index]) pools->destroy(index, components[index]);
             }
         }
 
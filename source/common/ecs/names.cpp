@@ -0,0 +1,66 @@
+#include "names.hpp"
+
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+
+namespace our {
+
+    namespace {
+        // The interned strings are stored in a deque since it never moves its elements when it grows.
+        // This allows the map keys to be views into the stored strings.
+        struct NameTable {
+            std::deque<std::string> strings;
+            std::unordered_map<std::string_view, NameId> ids;
+
+            NameTable() {
+                strings.emplace_back();
+                ids[strings.back()] = names::EMPTY;
+            }
+        };
+
+        NameTable& getNameTable() {
+            static NameTable table;
+            return table;
+        }
+
+        // The tags are indexed by their interned name id
+        std::unordered_map<NameId, TagMask>& getTagTable() {
+            static std::unordered_map<NameId, TagMask> table;
+            return table;
+        }
+    }
+
+    NameId names::intern(std::string_view name) {
+        NameTable& table = getNameTable();
+        if(auto it = table.ids.find(name); it != table.ids.end()) return it->second;
+        NameId id = (NameId)table.strings.size();
+        table.strings.emplace_back(name);
+        table.ids[table.strings.back()] = id;
+        return id;
+    }
+
+    NameId names::find(std::string_view name) {
+        NameTable& table = getNameTable();
+        if(auto it = table.ids.find(name); it != table.ids.end()) return it->second;
+        return INVALID;
+    }
+
+    const std::string& names::get(NameId id) {
+        return getNameTable().strings[id];
+    }
+
+    TagMask tags::get(std::string_view tag) {
+        auto& table = getTagTable();
+        NameId id = names::intern(tag);
+        if(auto it = table.find(id); it != table.end()) return it->second;
+        if(table.size() >= MAX_TAGS) {
+            std::cerr << "Can't add the tag \"" << tag << "\" since there are already " << MAX_TAGS << " tags" << std::endl;
+            return 0;
+        }
+        TagMask mask = TagMask(1) << table.size();
+        table[id] = mask;
+        return mask;
+    }
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace our {
+
+    // The id of an interned string. Each distinct string is stored once and is given a unique id,
+    // so comparing two interned names is an integer comparison instead of a string comparison.
+    using NameId = std::uint32_t;
+
+    // A bitset where each bit represents a tag (see "tags::get")
+    using TagMask = std::uint64_t;
+
+    namespace names {
+
+        // The id of the empty string (it is always interned)
+        constexpr NameId EMPTY = 0;
+        // The id returned by "find" if the name was never interned
+        constexpr NameId INVALID = ~NameId(0);
+
+        // Returns the id of the name (the name is added to the table if it wasn't already there)
+        NameId intern(std::string_view name);
+
+        // Returns the id of the name if it was interned before, otherwise, it returns INVALID
+        // Unlike "intern", it never allocates so it can be used for lookups every frame
+        NameId find(std::string_view name);
+
+        // Returns the string of an interned name (the reference stays valid for the rest of the program)
+        const std::string& get(NameId id);
+
+    }
+
+    namespace tags {
+
+        // The maximum number of distinct tags (one bit per tag)
+        constexpr std::uint32_t MAX_TAGS = 64;
+
+        // Returns the bit of the given tag. The bits are assigned in the order in which the tags are first requested.
+        // If more than MAX_TAGS tags are requested, the extra tags get an empty mask (and an error is printed).
+        TagMask get(std::string_view tag);
+
+    }
+
+}
@@ -0,0 +1,56 @@
+// This file is compiled with AVX2 & FMA enabled (see CMakeLists.txt) and its functions are only called
+// if the CPU supports them (see "transform-batch.cpp"). It must only include the kernels and the intrinsics
+// (see the note at the top of "transform-batch-kernels.hpp").
+#include "transform-batch-kernels.hpp"
+
+#if defined(__AVX2__)
+#define TRANSFORM_BATCH_AVX2
+#include <immintrin.h>
+#endif
+
+namespace our::transform_batch {
+
+#if defined(TRANSFORM_BATCH_AVX2)
+    namespace {
+        // The vector operations used by the kernels on 8 lanes using AVX2 & FMA
+        struct AVX2Ops {
+            using Float = __m256;
+            using Int = __m256i;
+            static constexpr size_t WIDTH = 8;
+
+            static Float set(float value) { return _mm256_set1_ps(value); }
+            static Int setInt(int value) { return _mm256_set1_epi32(value); }
+            static Float load(const float* address) { return _mm256_loadu_ps(address); }
+            static void store(float* address, Float value) { _mm256_storeu_ps(address, value); }
+            static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+            static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+            static Float fmadd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+            static Float negate(Float value) { return _mm256_xor_ps(value, _mm256_set1_ps(-0.0f)); }
+            static Int round(Float value) { return _mm256_cvtps_epi32(value); } // Rounds to the nearest (the default rounding mode)
+            static Float toFloat(Int value) { return _mm256_cvtepi32_ps(value); }
+            static Int andInt(Int a, Int b) { return _mm256_and_si256(a, b); }
+            static Int addInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+            static Float equal(Int a, Int b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+            static Float shiftToSign(Int bit1) { return _mm256_castsi256_ps(_mm256_slli_epi32(bit1, 30)); }
+            static Float bitXor(Float a, Float b) { return _mm256_xor_ps(a, b); }
+            static Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+        };
+    }
+
+    bool isAVX2Compiled() { return true; }
+
+    size_t integrateAVX2(float* values, const float* rates, float deltaTime, size_t count) {
+        return integrateKernel<AVX2Ops>(values, rates, deltaTime, count);
+    }
+
+    size_t composeAVX2(const Channels& channels, float* matrices, size_t count) {
+        return composeKernel<AVX2Ops>(channels, matrices, count);
+    }
+#else
+    // AVX2 is not enabled for this build (e.g. the target is not x86), so the other kernels are used instead
+    bool isAVX2Compiled() { return false; }
+    size_t integrateAVX2(float*, const float*, float, size_t) { return 0; }
+    size_t composeAVX2(const Channels&, float*, size_t) { return 0; }
+#endif
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// This header is internal to the transform batch kernels (see "transform-batch.hpp").
+// The kernels are written once as templates over a set of vector operations ("Ops") and each file instantiates them
+// with the operations of its instruction set. Since the AVX2 file is compiled with AVX2 enabled, this header must not include
+// anything that defines non-template inline functions (e.g. glm), otherwise the linker could pick an AVX2 copy of such a function
+// for the code that runs on CPUs without AVX2. For the same reason, everything here has internal linkage.
+
+#include <cstddef>
+
+namespace our::transform_batch {
+
+    // The channels of a transform list in the order: position xyz, rotation xyz, scale xyz
+    struct Channels {
+        const float* values[9];
+    };
+
+    // The AVX2 entry points (defined in "transform-batch-avx2.cpp"). Each returns the number of entities it processed
+    // (a multiple of the vector width) and the caller processes the rest. They process nothing if AVX2 was not enabled in the build.
+    bool isAVX2Compiled();
+    size_t integrateAVX2(float* values, const float* rates, float deltaTime, size_t count);
+    size_t composeAVX2(const Channels& channels, float* matrices, size_t count);
+
+    namespace {
+
+        // The Cody-Waite split of pi/2 into 3 floats. The first two have few significant bits
+        // so that multiplying them by the quadrant index is exact, which keeps the reduced angle accurate for large angles.
+        constexpr float HALF_PI_1 = 1.5703125f;
+        constexpr float HALF_PI_2 = 4.837512969970703125e-4f;
+        constexpr float HALF_PI_3 = 7.54978995489188216e-8f;
+        constexpr float TWO_OVER_PI = 0.636619772367581343f;
+
+        // Computes the sine & cosine of each lane (the minimax polynomials are the ones used by Cephes for [-pi/4, pi/4])
+        template<typename Ops>
+        inline void sinCos(typename Ops::Float angle, typename Ops::Float& sine, typename Ops::Float& cosine) {
+            using Float = typename Ops::Float;
+            using Int = typename Ops::Int;
+            // Find the nearest multiple of pi/2 (the quadrant) and reduce the angle to [-pi/4, pi/4]
+            Int quadrant = Ops::round(Ops::mul(angle, Ops::set(TWO_OVER_PI)));
+            Float k = Ops::toFloat(quadrant);
+            Float x = Ops::fmadd(k, Ops::set(-HALF_PI_1), angle);
+            x = Ops::fmadd(k, Ops::set(-HALF_PI_2), x);
+            x = Ops::fmadd(k, Ops::set(-HALF_PI_3), x);
+
+            Float x2 = Ops::mul(x, x);
+            Float s = Ops::fmadd(x2, Ops::set(-1.9515295891e-4f), Ops::set(8.3321608736e-3f));
+            s = Ops::fmadd(s, x2, Ops::set(-1.6666654611e-1f));
+            s = Ops::fmadd(Ops::mul(s, x2), x, x);
+            Float c = Ops::fmadd(x2, Ops::set(2.443315711809948e-5f), Ops::set(-1.388731625493765e-3f));
+            c = Ops::fmadd(c, x2, Ops::set(4.166664568298827e-2f));
+            c = Ops::fmadd(Ops::mul(c, x2), x2, Ops::fmadd(x2, Ops::set(-0.5f), Ops::set(1.0f)));
+
+            // For the quadrants 1 & 3, the sine & cosine are swapped. The sine is negated in the quadrants 2 & 3
+            // and the cosine is negated in the quadrants 1 & 2 (the bit 1 of quadrant + 1), so the bit is moved to the sign bit.
+            Float swap = Ops::equal(Ops::andInt(quadrant, Ops::setInt(1)), Ops::setInt(1));
+            Float sineSign = Ops::shiftToSign(Ops::andInt(quadrant, Ops::setInt(2)));
+            Float cosineSign = Ops::shiftToSign(Ops::andInt(Ops::addInt(quadrant, Ops::setInt(1)), Ops::setInt(2)));
+            sine = Ops::bitXor(Ops::select(swap, c, s), sineSign);
+            cosine = Ops::bitXor(Ops::select(swap, s, c), cosineSign);
+        }
+
+        // The integration is a multiply followed by an add on every path (never a fused multiply add), so the positions
+        // are bitwise the same whichever instruction set is chosen at runtime and whether an entity falls in the vector body
+        // or in the scalar tail (which keeps the fixed step simulation deterministic across CPUs).
+        // The fused multiply add is only used by "sinCos" & "composeKernel" whose results are only used for rendering.
+        template<typename Ops>
+        inline size_t integrateKernel(float* values, const float* rates, float deltaTime, size_t count) {
+            typename Ops::Float step = Ops::set(deltaTime);
+            size_t index = 0;
+            for(; index + Ops::WIDTH <= count; index += Ops::WIDTH)
+                Ops::store(values + index, Ops::add(Ops::mul(Ops::load(rates + index), step), Ops::load(values + index)));
+            return index;
+        }
+
+        template<typename Ops>
+        inline size_t composeKernel(const Channels& channels, float* matrices, size_t count) {
+            using Float = typename Ops::Float;
+            // The elements of WIDTH matrices are computed as 16 vectors (one per element), then they are written
+            // to the column major matrices one lane at a time
+            alignas(32) float elements[16][Ops::WIDTH];
+            size_t index = 0;
+            for(; index + Ops::WIDTH <= count; index += Ops::WIDTH) {
+                Float sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+                sinCos<Ops>(Ops::load(channels.values[3] + index), sinPitch, cosPitch);
+                sinCos<Ops>(Ops::load(channels.values[4] + index), sinYaw, cosYaw);
+                sinCos<Ops>(Ops::load(channels.values[5] + index), sinRoll, cosRoll);
+                Float scaleX = Ops::load(channels.values[6] + index);
+                Float scaleY = Ops::load(channels.values[7] + index);
+                Float scaleZ = Ops::load(channels.values[8] + index);
+
+                // The rotation is the same as "glm::yawPitchRoll(yaw, pitch, roll)" and each column is multiplied by its scale
+                Float sinYawSinPitch = Ops::mul(sinYaw, sinPitch);
+                Float cosYawSinPitch = Ops::mul(cosYaw, sinPitch);
+                Ops::store(elements[0], Ops::mul(Ops::fmadd(sinYawSinPitch, sinRoll, Ops::mul(cosYaw, cosRoll)), scaleX));
+                Ops::store(elements[1], Ops::mul(Ops::mul(sinRoll, cosPitch), scaleX));
+                Ops::store(elements[2], Ops::mul(Ops::fmadd(cosYawSinPitch, sinRoll, Ops::negate(Ops::mul(sinYaw, cosRoll))), scaleX));
+                Ops::store(elements[4], Ops::mul(Ops::fmadd(sinYawSinPitch, cosRoll, Ops::negate(Ops::mul(cosYaw, sinRoll))), scaleY));
+                Ops::store(elements[5], Ops::mul(Ops::mul(cosRoll, cosPitch), scaleY));
+                Ops::store(elements[6], Ops::mul(Ops::fmadd(cosYawSinPitch, cosRoll, Ops::mul(sinRoll, sinYaw)), scaleY));
+                Ops::store(elements[8], Ops::mul(Ops::mul(sinYaw, cosPitch), scaleZ));
+                Ops::store(elements[9], Ops::mul(Ops::negate(sinPitch), scaleZ));
+                Ops::store(elements[10], Ops::mul(Ops::mul(cosYaw, cosPitch), scaleZ));
+
+                for(size_t lane = 0; lane < Ops::WIDTH; lane++) {
+                    float* matrix = matrices + 16 * (index + lane);
+                    matrix[0] = elements[0][lane]; matrix[1] = elements[1][lane]; matrix[2] = elements[2][lane]; matrix[3] = 0.0f;
+                    matrix[4] = elements[4][lane]; matrix[5] = elements[5][lane]; matrix[6] = elements[6][lane]; matrix[7] = 0.0f;
+                    matrix[8] = elements[8][lane]; matrix[9] = elements[9][lane]; matrix[10] = elements[10][lane]; matrix[11] = 0.0f;
+                    matrix[12] = channels.values[0][index + lane];
+                    matrix[13] = channels.values[1][index + lane];
+                    matrix[14] = channels.values[2][index + lane];
+                    matrix[15] = 1.0f;
+                }
+            }
+            return index;
+        }
+
+    }
+
+}
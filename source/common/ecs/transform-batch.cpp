@@ -0,0 +1,164 @@
+#include "transform-batch.hpp"
+#include "transform-batch-kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace our::transform_batch {
+
+#if defined(TRANSFORM_BATCH_SSE2)
+    namespace {
+        // The vector operations used by the kernels (see "transform-batch-kernels.hpp") on 4 lanes using SSE2
+        struct SSE2Ops {
+            using Float = __m128;
+            using Int = __m128i;
+            static constexpr size_t WIDTH = 4;
+
+            static Float set(float value) { return _mm_set1_ps(value); }
+            static Int setInt(int value) { return _mm_set1_epi32(value); }
+            static Float load(const float* address) { return _mm_loadu_ps(address); }
+            static void store(float* address, Float value) { _mm_storeu_ps(address, value); }
+            static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+            static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+            // SSE2 has no fused multiply add, so it is a multiply followed by an add
+            static Float fmadd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+            static Float negate(Float value) { return _mm_xor_ps(value, _mm_set1_ps(-0.0f)); }
+            static Int round(Float value) { return _mm_cvtps_epi32(value); } // Rounds to the nearest (the default rounding mode)
+            static Float toFloat(Int value) { return _mm_cvtepi32_ps(value); }
+            static Int andInt(Int a, Int b) { return _mm_and_si128(a, b); }
+            static Int addInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+            static Float equal(Int a, Int b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+            static Float shiftToSign(Int bit1) { return _mm_castsi128_ps(_mm_slli_epi32(bit1, 30)); }
+            static Float bitXor(Float a, Float b) { return _mm_xor_ps(a, b); }
+            static Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        };
+    }
+#endif
+
+    namespace {
+        bool isAVX2Supported() {
+            if(!isAVX2Compiled()) return false;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+            // This also checks that the OS saves the AVX registers
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            int info[4];
+            __cpuid(info, 1);
+            bool hasFMA = (info[2] & (1 << 12)) != 0;
+            bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+            if(!hasFMA || !hasOSXSAVE) return false;
+            // The OS must save the SSE & AVX registers (bits 1 & 2 of XCR0)
+            if((_xgetbv(0) & 6) != 6) return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return false;
+#endif
+        }
+
+        InstructionSet detectInstructionSet() {
+            if(isAVX2Supported()) return InstructionSet::AVX2;
+#if defined(TRANSFORM_BATCH_SSE2)
+            return InstructionSet::SSE2;
+#else
+            return InstructionSet::SCALAR;
+#endif
+        }
+
+        // The detection runs once (on the first use)
+        InstructionSet& getSelectedInstructionSet() {
+            static InstructionSet instructionSet = getSupportedInstructionSet();
+            return instructionSet;
+        }
+    }
+
+    InstructionSet getSupportedInstructionSet() {
+        static InstructionSet supported = detectInstructionSet();
+        return supported;
+    }
+
+    InstructionSet getInstructionSet() {
+        return getSelectedInstructionSet();
+    }
+
+    void setInstructionSet(InstructionSet instructionSet) {
+        // The instruction sets are ordered so that each one implies the ones before it
+        getSelectedInstructionSet() = std::min(instructionSet, getSupportedInstructionSet());
+    }
+
+    const char* getInstructionSetName(InstructionSet instructionSet) {
+        switch(instructionSet) {
+            case InstructionSet::AVX2: return "AVX2";
+            case InstructionSet::SSE2: return "SSE2";
+            default: return "Scalar";
+        }
+    }
+
+    float getError(const glm::mat4& matrix, const Transform& transform) {
+        glm::mat4 expected = transform.toMat4();
+        float error = 0.0f;
+        for(int column = 0; column < 4; column++) {
+            float unit = column < 3 ? std::max(1.0f, std::abs(transform.scale[column])) : 1.0f;
+            for(int row = 0; row < 4; row++)
+                error = std::max(error, std::abs(matrix[column][row] - expected[column][row]) / unit);
+        }
+        return error;
+    }
+
+    namespace {
+        size_t integrateChannel(float* values, const float* rates, float deltaTime, size_t count) {
+            size_t index = 0;
+            switch(getInstructionSet()) {
+                case InstructionSet::AVX2: index = integrateAVX2(values, rates, deltaTime, count); break;
+#if defined(TRANSFORM_BATCH_SSE2)
+                case InstructionSet::SSE2: index = integrateKernel<SSE2Ops>(values, rates, deltaTime, count); break;
+#endif
+                default: break;
+            }
+            for(; index < count; index++) values[index] += deltaTime * rates[index];
+            return count;
+        }
+    }
+
+    void integrate(TransformList& transforms, const VelocityList& velocities, float deltaTime, size_t begin, size_t end) {
+        if(begin >= end) return;
+        size_t count = end - begin;
+        for(int axis = 0; axis < 3; axis++) {
+            integrateChannel(transforms.position[axis].data() + begin, velocities.linear[axis].data() + begin, deltaTime, count);
+            integrateChannel(transforms.rotation[axis].data() + begin, velocities.angular[axis].data() + begin, deltaTime, count);
+        }
+    }
+
+    void compose(const TransformList& transforms, glm::mat4* matrices) {
+        size_t count = transforms.size();
+        Channels channels;
+        for(int axis = 0; axis < 3; axis++) {
+            channels.values[axis] = transforms.position[axis].data();
+            channels.values[3 + axis] = transforms.rotation[axis].data();
+            channels.values[6 + axis] = transforms.scale[axis].data();
+        }
+        // A glm::mat4 is 16 floats stored column by column
+        float* elements = &matrices[0][0][0];
+
+        size_t index = 0;
+        switch(getInstructionSet()) {
+            case InstructionSet::AVX2: index = composeAVX2(channels, elements, count); break;
+#if defined(TRANSFORM_BATCH_SSE2)
+            case InstructionSet::SSE2: index = composeKernel<SSE2Ops>(channels, elements, count); break;
+#endif
+            default: break;
+        }
+        // The remaining transforms (or all of them if there is no SIMD) use the scalar function
+        for(; index < count; index++) matrices[index] = transforms.get(index).toMat4();
+    }
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "transform.hpp"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // This namespace contains the batched versions of the per entity transform math: integrating the velocities
+    // and composing the local matrices (the same as "Transform::toMat4") for many entities at once.
+    // The data is stored as a structure of arrays so that the kernels can process 4 (SSE2) or 8 (AVX2) entities at a time.
+    // The instruction set is chosen at runtime: the AVX2 kernels are compiled in their own file (see "transform-batch-avx2.cpp")
+    // and they are only called if the CPU supports AVX2 & FMA, otherwise the SSE2 kernels (or the scalar code on other CPUs) are used.
+    namespace transform_batch {
+
+        enum class InstructionSet {
+            SCALAR,
+            SSE2,
+            AVX2
+        };
+
+        // Returns the best instruction set supported by both the build and the CPU
+        InstructionSet getSupportedInstructionSet();
+        // Returns the instruction set used by the kernels (the supported one unless it was changed by "setInstructionSet")
+        InstructionSet getInstructionSet();
+        // Forces the kernels to use an instruction set (e.g. to compare them). An unsupported one is replaced by the supported one.
+        void setInstructionSet(InstructionSet instructionSet);
+        const char* getInstructionSetName(InstructionSet instructionSet);
+
+        // The SIMD kernels compute the sines & cosines using polynomials instead of calling std::sin & std::cos,
+        // so their matrices are not bitwise equal to the ones from "Transform::toMat4". For angles within [-ANGLE_RANGE, ANGLE_RANGE],
+        // each element of the first 3 columns differs by at most TOLERANCE * max(1, |scale|) where scale is the scale of its column.
+        // The translation column is copied so it is exact.
+        constexpr float TOLERANCE = 1e-6f;
+        constexpr float ANGLE_RANGE = 1e4f;
+
+        // Returns the largest difference between a composed matrix and the matrix of the transform in the unit used by TOLERANCE
+        float getError(const glm::mat4& matrix, const Transform& transform);
+
+        // A list of transforms stored as a structure of arrays (one array per component of each vector)
+        struct TransformList {
+            std::vector<float> position[3], rotation[3], scale[3];
+
+            void clear() {
+                for(int axis = 0; axis < 3; axis++) { position[axis].clear(); rotation[axis].clear(); scale[axis].clear(); }
+            }
+            size_t size() const { return position[0].size(); }
+            void push(const Transform& transform) {
+                for(int axis = 0; axis < 3; axis++) {
+                    position[axis].push_back(transform.position[axis]);
+                    rotation[axis].push_back(transform.rotation[axis]);
+                    scale[axis].push_back(transform.scale[axis]);
+                }
+            }
+            Transform get(size_t index) const {
+                Transform transform;
+                for(int axis = 0; axis < 3; axis++) {
+                    transform.position[axis] = position[axis][index];
+                    transform.rotation[axis] = rotation[axis][index];
+                    transform.scale[axis] = scale[axis][index];
+                }
+                return transform;
+            }
+        };
+
+        // A list of linear & angular velocities stored as a structure of arrays (matching the transforms of a TransformList)
+        struct VelocityList {
+            std::vector<float> linear[3], angular[3];
+
+            void clear() {
+                for(int axis = 0; axis < 3; axis++) { linear[axis].clear(); angular[axis].clear(); }
+            }
+            size_t size() const { return linear[0].size(); }
+            void push(glm::vec3 linearVelocity, glm::vec3 angularVelocity) {
+                for(int axis = 0; axis < 3; axis++) {
+                    linear[axis].push_back(linearVelocity[axis]);
+                    angular[axis].push_back(angularVelocity[axis]);
+                }
+            }
+        };
+
+        // Moves each transform in [begin, end) by its velocities: position += deltaTime * linear and rotation += deltaTime * angular
+        // Since the ranges are independent, different ranges of the same lists can be integrated on different threads.
+        void integrate(TransformList& transforms, const VelocityList& velocities, float deltaTime, size_t begin, size_t end);
+        // Moves all the transforms by their velocities (both lists must have the same size)
+        inline void integrate(TransformList& transforms, const VelocityList& velocities, float deltaTime) {
+            integrate(transforms, velocities, deltaTime, 0, transforms.size());
+        }
+
+        // Computes the matrix of each transform (T * R * S like "Transform::toMat4") and writes it to "matrices"
+        // which must have room for "transforms.size()" matrices.
+        void compose(const TransformList& transforms, glm::mat4* matrices);
+
+    }
+
+}
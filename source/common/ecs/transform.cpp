@@ -3,9 +3,6 @@
 
 #include <glm/gtx/euler_angles.hpp>
 
-#include<iostream>
-#include<ctime>
-
 namespace our {
 
     // This function computes and returns a matrix that represents this transform
@@ -14,37 +11,22 @@ namespace our {
     glm::mat4 Transform::toMat4() const {
         //TODO: (Req 2) Write this function
 
-       
-        glm::mat4 T= glm::translate(
-            glm::mat4(1.0f),
-            position
-        );
-
-
-        glm::mat4 S=glm::scale(
-            glm::mat4(1.0f),
-            scale
-        );
-
-       glm::mat4 R= glm::yawPitchRoll( rotation[1],rotation[0],rotation[2] );
-       glm::mat4 SRT =T * R * S;
-     
-
+        // T * R * S is composed directly instead of multiplying 3 matrices: scaling multiplies each column of the rotation
+        // by the scale on its axis, then the translation is the last column (the result is the same)
+        glm::mat4 SRT = glm::yawPitchRoll(rotation[1], rotation[0], rotation[2]);
+        SRT[0] *= scale[0];
+        SRT[1] *= scale[1];
+        SRT[2] *= scale[2];
+        SRT[3] = glm::vec4(position, 1.0f);
 
         return SRT;
     }
 
-     // Deserializes the entity data and components from a json object
-    void Transform::deserialize(const nlohmann::json& data,char type){
+     // Deserializes the transform data from a json object
+    void Transform::deserialize(const nlohmann::json& data){
         position = data.value("position", position);
         rotation = glm::radians(data.value("rotation", glm::degrees(rotation)));
         scale    = data.value("scale", scale);
-        // giving x-axis a random number to show at
-        if(type=='g'){// change the x-axis of energy objects
-            position.x=(rand()%51)-25;
-        }else if (type=='o'){
-            position.x=(rand()%26)-12.5;
-        }
     }
 
 }
\ No newline at end of file
@@ -14,9 +14,14 @@ namespace our {
 
         // This function computes and returns a matrix that represents this transform
         glm::mat4 toMat4() const;
-         // Deserializes the entity data and components from a json object
-         // sending type of entity to random pos for certain types gas/obstacle
-        void deserialize(const nlohmann::json&,char type=' ');
+
+        // These are used to detect whether a transform changed since its matrix was computed
+        bool operator==(const Transform& other) const {
+            return position == other.position && rotation == other.rotation && scale == other.scale;
+        }
+        bool operator!=(const Transform& other) const { return !(*this == other); }
+        // Deserializes the transform data from a json object
+        void deserialize(const nlohmann::json&);
     };
 
 }
\ No newline at end of file
@@ -1,7 +1,33 @@
 #include "world.hpp"
 
+#include <cassert>
+#include <new>
+#include <glm/gtc/constants.hpp>
+
 namespace our {
 
+    void World::updateTransforms() {
+        // Gather the transforms that changed since their local matrices were computed
+        changedEntities.clear();
+        changedTransforms.clear();
+        for(auto entity : entities) {
+            if(entity->matricesValid && entity->localTransform == entity->cachedTransform) continue;
+            changedEntities.push_back(entity);
+            changedTransforms.push(entity->localTransform);
+        }
+        // Compose their local matrices at once, then store them in the entities as if "updateMatrices" computed them
+        changedMatrices.resize(changedEntities.size());
+        if(!changedEntities.empty()) transform_batch::compose(changedTransforms, changedMatrices.data());
+        for(size_t index = 0; index < changedEntities.size(); index++) {
+            Entity* entity = changedEntities[index];
+            entity->localMatrix = changedMatrices[index];
+            entity->cachedTransform = entity->localTransform;
+            entity->localMatrixUpdated = true;
+        }
+        // Then combine them with the matrices of their parents
+        for(auto entity : entities) entity->updateMatrices();
+    }
+
     // This will deserialize a json array of entities and add the new entities to the current world
     // If parent pointer is not null, the new entities will be have their parent set to that given pointer
     // If any of the entities has children, this function will be called recursively for these children
@@ -16,4 +42,113 @@ namespace our {
         }
     }
 
-}
\ No newline at end of file
+    Entity* World::add() {
+        std::uint32_t index;
+        if(!freeSlots.empty()){
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = slotCount++;
+            assert(index <= EntityHandle::MAX_INDEX && "Too many entities for the entity handle");
+            if(index / CHUNK_SIZE >= chunks.size()) chunks.push_back(std::make_unique<EntityChunk>());
+            // The generation of a slot is kept after "clear" so the handles from before it stay invalid
+            if(index >= generations.size()){
+                generations.push_back(1);
+                aliveSlots.push_back(0);
+            }
+        }
+        Entity* entity = new (slot(index)) Entity();
+        entity->world = this;
+        entity->pools = &pools;
+        entity->handle = EntityHandle(index, generations[index]);
+        entity->listIndex = (std::uint32_t)entities.size();
+        entities.push_back(entity);
+        aliveSlots[index] = 1;
+        return entity;
+    }
+
+    void World::indexName(Entity* entity) {
+        if(entity->nameId != names::EMPTY) nameIndex[entity->nameId].push_back(entity);
+    }
+
+    void World::unindexName(Entity* entity) {
+        if(entity->nameId == names::EMPTY) return;
+        auto it = nameIndex.find(entity->nameId);
+        if(it == nameIndex.end()) return;
+        auto& list = it->second;
+        for(size_t index = 0; index < list.size(); index++){
+            if(list[index] == entity){
+                list[index] = list.back();
+                list.pop_back();
+                break;
+            }
+        }
+        if(list.empty()) nameIndex.erase(it);
+    }
+
+    void World::destroy(Entity* entity) {
+        unindexName(entity);
+        // Remove the entity from the list by moving the last entity into its place
+        Entity* last = entities.back();
+        entities[entity->listIndex] = last;
+        last->listIndex = entity->listIndex;
+        entities.pop_back();
+        // Then destroy it and release its slot after moving the slot to the next generation
+        std::uint32_t index = entity->handle.getIndex();
+        entity->~Entity();
+        aliveSlots[index] = 0;
+        generations[index] = generations[index] == EntityHandle::MAX_GENERATION ? 1 : generations[index] + 1;
+        freeSlots.push_back(index);
+    }
+
+    void World::beginInterpolation(float alpha) {
+        interpolatedEntities.clear();
+        for(auto entity : entities){
+            if(!entity->hasPreviousTransform || entity->previousTransform == entity->localTransform) continue;
+            entity->simulatedTransform = entity->localTransform;
+            entity->localTransform.position = glm::mix(entity->previousTransform.position, entity->simulatedTransform.position, alpha);
+            // The angles could have been wrapped (e.g. from 2*PI to 0) so each angle is blended along the shorter direction
+            glm::vec3 rotationChange = entity->simulatedTransform.rotation - entity->previousTransform.rotation;
+            rotationChange -= glm::two_pi<float>() * glm::round(rotationChange / glm::two_pi<float>());
+            entity->localTransform.rotation = entity->previousTransform.rotation + alpha * rotationChange;
+            entity->localTransform.scale = glm::mix(entity->previousTransform.scale, entity->simulatedTransform.scale, alpha);
+            interpolatedEntities.push_back(entity);
+        }
+    }
+
+    void World::endInterpolation() {
+        for(auto entity : interpolatedEntities) entity->localTransform = entity->simulatedTransform;
+        interpolatedEntities.clear();
+    }
+
+    void World::deleteMarkedEntities() {
+        if(pendingRemovals.empty()) return;
+        // Mark the entities first (a handle could be queued more than once or be invalidated by an earlier removal)
+        for(auto handle : pendingRemovals)
+            if(Entity* entity = get(handle)) entity->markedForRemoval = true;
+        // Detach the children of the removed entities so that they don't point to destroyed parents
+        for(auto entity : entities)
+            if(entity->parent && entity->parent->markedForRemoval && !entity->markedForRemoval) entity->parent = nullptr;
+        for(auto handle : pendingRemovals)
+            if(Entity* entity = get(handle)) destroy(entity);
+        pendingRemovals.clear();
+    }
+
+    void World::clear() {
+        for(auto entity : entities){
+            std::uint32_t index = entity->handle.getIndex();
+            entity->~Entity();
+            aliveSlots[index] = 0;
+            generations[index] = generations[index] == EntityHandle::MAX_GENERATION ? 1 : generations[index] + 1;
+        }
+        entities.clear();
+        pendingRemovals.clear();
+        interpolatedEntities.clear();
+        nameIndex.clear();
+        // All the slots are free now, so the chunks are freed at once and the slots will be used again from the start
+        chunks.clear();
+        freeSlots.clear();
+        slotCount = 0;
+    }
+
+}
@@ -1,15 +1,84 @@
 #pragma once
 
-#include <unordered_set>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <string_view>
+#include <unordered_map>
 #include "entity.hpp"
+#include "transform-batch.hpp"
 
 namespace our {
 
+    // A view iterates over the entities that hold all the given component types
+    // It walks the pool of the first component type linearly, so the rarest component type should be given first
+    // The disabled entities are skipped (see "Entity::setEnabled")
+    // Use it as follows: world->view<MovementComponent>().each([](Entity* entity, MovementComponent& movement){ ... });
+    template<typename First, typename... Rest>
+    class View {
+        const ComponentPool<First>* pool; // The pool of the first component type (null if it was never created)
+        ComponentMask mask;               // The mask of all the component types of this view
+    public:
+        View(const ComponentPool<First>* pool) : pool(pool),
+            mask((componentBit(First::getTypeIndex()) | ... | componentBit(Rest::getTypeIndex()))) {}
+
+        // Calls "function(entity, first, rest...)" for every entity that holds all the component types
+        template<typename Function>
+        void each(Function&& function) const {
+            if(!pool) return;
+            pool->forEach([&](First& first){
+                Entity* entity = first.getOwner();
+                if(entity->isEnabled() && entity->hasComponents(mask)) function(entity, first, *entity->template getComponent<Rest>()...);
+            });
+        }
+    };
+
     // This class holds a set of entities
+    // The entities are allocated from a pool of fixed size chunks (so they are never moved and their pointers stay valid)
+    // and each one can be referred to by a generational handle which becomes invalid once the entity is destroyed.
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
-        std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
-                                                      // when deleteMarkedEntities is called
+    public:
+        // The number of entities in each chunk of the entity pool
+        static constexpr std::uint32_t CHUNK_SIZE = 256;
+
+    private:
+        struct EntityChunk {
+            alignas(Entity) unsigned char storage[CHUNK_SIZE * sizeof(Entity)];
+        };
+
+        ComponentPools pools; // The components of all the entities are stored in these pools (one per component type)
+        std::vector<std::unique_ptr<EntityChunk>> chunks; // The memory of the entity pool
+        std::vector<std::uint32_t> generations; // The current generation of each slot (kept even when the chunks are freed)
+        std::vector<std::uint8_t> aliveSlots;   // Whether each slot holds an entity
+        std::vector<std::uint32_t> freeSlots;   // The slots that were released and can be reused
+        std::uint32_t slotCount = 0;            // The number of slots used so far (alive or free)
+
+        std::vector<Entity*> entities; // These are the entities held by this world (in no particular order)
+        std::vector<EntityHandle> pendingRemovals; // The handles of the entities awaiting to be destroyed
+                                                   // when deleteMarkedEntities is called
+        // The named entities indexed by their interned name (the unnamed entities are not indexed)
+        // Since multiple entities can share a name, each name maps to a list of entities
+        std::unordered_map<NameId, std::vector<Entity*>> nameIndex;
+        std::vector<Entity*> interpolatedEntities; // The entities whose transform is replaced between begin & endInterpolation
+        // The entities whose local matrices are composed in a batch by "updateTransforms" with their transforms & matrices
+        std::vector<Entity*> changedEntities;
+        transform_batch::TransformList changedTransforms;
+        std::vector<glm::mat4> changedMatrices;
+
+        Entity* slot(std::uint32_t index) const {
+            return reinterpret_cast<Entity*>(chunks[index / CHUNK_SIZE]->storage) + (index % CHUNK_SIZE);
+        }
+
+        // Destroys the entity immediately and releases its slot (any handle to it becomes invalid)
+        void destroy(Entity* entity);
+
+        // Adds or removes an entity from the name index (called by "Entity::setName" and when an entity is destroyed)
+        void indexName(Entity* entity);
+        void unindexName(Entity* entity);
+
+        friend Entity;
+
     public:
 
         World() = default;
@@ -19,48 +88,81 @@ namespace our {
         // If any of the entities has children, this function will be called recursively for these children
         void deserialize(const nlohmann::json& data, Entity* parent = nullptr);
 
-        // This adds an entity to the entities set and returns a pointer to that entity
+        // This creates an entity in the entity pool and returns a pointer to that entity
         // WARNING The entity is owned by this world so don't use "delete" to delete it, instead, call "markForRemoval"
-        // to put it in the "markedForRemoval" set. The elements in the "markedForRemoval" set will be removed and
-        // deleted when "deleteMarkedEntities" is called.
-        Entity* add() {
-            Entity* entity = new Entity();
-            entity->world = this;
-            entities.insert(entity);
-            return entity;
-        }
+        // to queue its removal. The queued entities will be destroyed when "deleteMarkedEntities" is called.
+        Entity* add();
 
-        // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
-            return entities;
+        // Returns the entity referred to by the handle or nullptr if that entity was destroyed (or the handle is null)
+        Entity* get(EntityHandle handle) const {
+            std::uint32_t index = handle.getIndex();
+            if(handle.isNull() || index >= slotCount || !aliveSlots[index] || generations[index] != handle.getGeneration()) return nullptr;
+            return slot(index);
         }
 
-        // This marks an entity for removal by adding it to the "markedForRemoval" set.
-        // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
-        void markForRemoval(Entity* entity){
-            if(entities.find(entity) != entities.end())
-                markedForRemoval.insert(entity);
+        // Returns true if the handle refers to an entity that still exists
+        bool isValid(EntityHandle handle) const { return get(handle) != nullptr; }
+
+        // Returns an entity with the given name or nullptr if there is none (if many entities share the name, any of them is returned)
+        // The lookup is a hash map access, and the overload that takes a string doesn't allocate.
+        Entity* findByName(NameId name) const {
+            if(auto it = nameIndex.find(name); it != nameIndex.end()) return it->second.front();
+            return nullptr;
+        }
+        Entity* findByName(std::string_view name) const {
+            NameId id = names::find(name);
+            return id == names::INVALID ? nullptr : findByName(id);
         }
 
-        // This removes the elements in "markedForRemoval" from the "entities" set.
-        // Then each of these elements are deleted.
-        void deleteMarkedEntities(){
-            for(auto entity: markedForRemoval){
-                entities.erase(entity);
-                delete entity;
+        // This brings the cached matrices of all the entities up to date in one pass (parents are updated before their children).
+        // Only the entities whose transform or ancestors' transforms changed are recomputed.
+        // The local matrices of the changed transforms are composed together using the SIMD kernels (see "transform_batch").
+        // It should be called once per frame after the systems move the entities (the renderer calls it before drawing).
+        void updateTransforms();
+
+        // This records the current transforms as the previous ones. It should be called at the start of each simulation step
+        // so that the transforms can be interpolated between the last two steps when drawing.
+        void beginSimulationStep() {
+            for(auto entity : entities) {
+                entity->previousTransform = entity->localTransform;
+                entity->hasPreviousTransform = true;
             }
-            markedForRemoval.clear();
         }
 
-        //This deletes all entities in the world
-        void clear(){
-            for(auto entity: entities){
-                delete entity;
-            }
-            entities.clear();
-            markedForRemoval.clear();
+        // Since the simulation runs at a fixed rate, a frame is usually drawn between two simulation steps.
+        // This replaces the transform of each entity that moved in the last step with a blend of its previous & current transforms
+        // where alpha is the fraction of the step (see "Application::getInterpolationAlpha"), so the motion looks smooth at any frame rate.
+        // The simulated transforms are restored by "endInterpolation" which should be called once the frame is drawn.
+        void beginInterpolation(float alpha);
+        void endInterpolation();
+
+        // Returns a view over the entities holding all the given component types (see "View")
+        template<typename... Components>
+        View<Components...> view() const {
+            return View<Components...>(pools.find<typename std::tuple_element<0, std::tuple<Components...>>::type>());
+        }
+
+        // This returns and immutable reference to the list of all entites in the world.
+        const std::vector<Entity*>& getEntities() const {
+            return entities;
+        }
+
+        // This queues the removal of an entity. The removals are deferred (the entity stays usable for the rest of the frame)
+        // and are applied when "deleteMarkedEntities" is called which the states do once at the end of their "onDraw".
+        void markForRemoval(Entity* entity){
+            if(entity && entity->world == this) markForRemoval(entity->getHandle());
+        }
+        void markForRemoval(EntityHandle handle){
+            if(isValid(handle)) pendingRemovals.push_back(handle);
         }
 
+        // This applies the queued removals: each queued entity is destroyed and its handles become invalid.
+        // The children of the destroyed entities become root entities (their parent is set to null).
+        void deleteMarkedEntities();
+
+        //This deletes all entities in the world and frees the memory of the entity pool
+        void clear();
+
         //Since the world owns all of its entities, they should be deleted alongside it.
         ~World(){
             clear();
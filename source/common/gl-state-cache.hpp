@@ -0,0 +1,175 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+namespace our {
+
+    // This static class keeps a shadow copy of the OpenGL state that is changed while drawing
+    // (capabilities, masks, blending, culling, the used program and the bound textures, samplers & vertex arrays).
+    // Every call goes through this class which skips it if the requested value is already set.
+    // For the shadow copy to stay correct:
+    // - The state should only be changed via this class (otherwise, call "invalidate" after changing it directly).
+    // - "invalidate" should be called after any code that we don't control touches the state (e.g. ImGui).
+    // - The "forget*" functions should be called before deleting an object (since OpenGL may reuse its name).
+    class GLStateCache {
+    public:
+        // The number of texture units that are tracked (binds to other units are always sent to OpenGL)
+        static constexpr GLuint MAX_TEXTURE_UNITS = 16;
+
+        // The number of state calls that were sent to OpenGL and that were skipped since the last "resetStatistics"
+        // (The members have no default initializers since the static storage below is zero-initialized anyway)
+        struct Statistics {
+            int issuedCalls;
+            int elidedCalls;
+        };
+
+    private:
+        // A cached value is valid when we know that OpenGL currently holds it
+        template<typename T>
+        struct Cached {
+            T value;
+            bool valid;
+        };
+
+        // The capabilities that are tracked (any other capability is always sent to OpenGL)
+        enum Capability { BLEND = 0, DEPTH_TEST, CULL_FACE, CAPABILITY_COUNT };
+
+        static inline Cached<bool> capabilities[CAPABILITY_COUNT];
+        static inline Cached<bool> depthMaskValue;
+        static inline Cached<glm::bvec4> colorMaskValue;
+        static inline Cached<GLenum> depthFuncValue;
+        static inline Cached<GLenum> cullFaceValue;
+        static inline Cached<GLenum> frontFaceValue;
+        static inline Cached<GLenum> blendEquationValue;
+        static inline Cached<glm::uvec2> blendFuncValue;
+        static inline Cached<glm::vec4> blendColorValue;
+        static inline Cached<GLuint> program;
+        static inline Cached<GLuint> activeUnit;
+        static inline Cached<GLuint> textures[MAX_TEXTURE_UNITS];
+        static inline Cached<GLuint> samplers[MAX_TEXTURE_UNITS];
+        static inline Cached<GLuint> vertexArray;
+
+        static inline Statistics statistics;
+
+        // Returns true if the call has to be sent to OpenGL (and records the new value), false if it can be skipped
+        template<typename T>
+        static bool change(Cached<T>& cached, const T& value) {
+            if(cached.valid && cached.value == value) {
+                statistics.elidedCalls++;
+                return false;
+            }
+            cached.value = value;
+            cached.valid = true;
+            statistics.issuedCalls++;
+            return true;
+        }
+
+        static int capabilityIndex(GLenum capability) {
+            switch(capability) {
+                case GL_BLEND: return BLEND;
+                case GL_DEPTH_TEST: return DEPTH_TEST;
+                case GL_CULL_FACE: return CULL_FACE;
+                default: return -1;
+            }
+        }
+
+    public:
+        // Enables or disables an OpenGL capability (glEnable/glDisable)
+        static void setEnabled(GLenum capability, bool enabled) {
+            int index = capabilityIndex(capability);
+            if(index >= 0 && !change(capabilities[index], enabled)) return;
+            if(enabled) glEnable(capability); else glDisable(capability);
+        }
+
+        static void depthMask(bool mask) {
+            if(change(depthMaskValue, mask)) glDepthMask(mask);
+        }
+
+        static void colorMask(glm::bvec4 mask) {
+            if(change(colorMaskValue, mask)) glColorMask(mask.r, mask.g, mask.b, mask.a);
+        }
+
+        static void depthFunc(GLenum function) {
+            if(change(depthFuncValue, function)) glDepthFunc(function);
+        }
+
+        static void cullFace(GLenum face) {
+            if(change(cullFaceValue, face)) glCullFace(face);
+        }
+
+        static void frontFace(GLenum face) {
+            if(change(frontFaceValue, face)) glFrontFace(face);
+        }
+
+        static void blendEquation(GLenum equation) {
+            if(change(blendEquationValue, equation)) glBlendEquation(equation);
+        }
+
+        static void blendFunc(GLenum sourceFactor, GLenum destinationFactor) {
+            if(change(blendFuncValue, glm::uvec2(sourceFactor, destinationFactor))) glBlendFunc(sourceFactor, destinationFactor);
+        }
+
+        static void blendColor(glm::vec4 color) {
+            if(change(blendColorValue, color)) glBlendColor(color.r, color.g, color.b, color.a);
+        }
+
+        static void useProgram(GLuint name) {
+            if(change(program, name)) glUseProgram(name);
+        }
+
+        // Selects the active texture unit (the unit is given as a number, not as GL_TEXTUREi)
+        static void activeTexture(GLuint unit) {
+            if(change(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        // Binds a texture to GL_TEXTURE_2D of the active texture unit
+        static void bindTexture(GLuint name) {
+            GLuint unit = activeUnit.value;
+            if(activeUnit.valid && unit < MAX_TEXTURE_UNITS) {
+                if(change(textures[unit], name)) glBindTexture(GL_TEXTURE_2D, name);
+            } else {
+                glBindTexture(GL_TEXTURE_2D, name);
+                statistics.issuedCalls++;
+            }
+        }
+
+        static void bindSampler(GLuint unit, GLuint name) {
+            if(unit >= MAX_TEXTURE_UNITS || change(samplers[unit], name)) glBindSampler(unit, name);
+        }
+
+        static void bindVertexArray(GLuint name) {
+            if(change(vertexArray, name)) glBindVertexArray(name);
+        }
+
+        // Deleting a bound object makes OpenGL unbind it, so the cache must forget it before the name is reused
+        static void forgetTexture(GLuint name) {
+            for(auto& texture : textures) if(texture.value == name) texture.valid = false;
+        }
+        static void forgetSampler(GLuint name) {
+            for(auto& sampler : samplers) if(sampler.value == name) sampler.valid = false;
+        }
+        static void forgetProgram(GLuint name) {
+            if(program.value == name) program.valid = false;
+        }
+        static void forgetVertexArray(GLuint name) {
+            if(vertexArray.value == name) vertexArray.valid = false;
+        }
+
+        // Marks the whole shadow state as unknown so that the next call of every kind is sent to OpenGL
+        static void invalidate() {
+            for(auto& capability : capabilities) capability.valid = false;
+            depthMaskValue.valid = colorMaskValue.valid = false;
+            depthFuncValue.valid = cullFaceValue.valid = frontFaceValue.valid = false;
+            blendEquationValue.valid = blendFuncValue.valid = blendColorValue.valid = false;
+            program.valid = activeUnit.valid = vertexArray.valid = false;
+            for(auto& texture : textures) texture.valid = false;
+            for(auto& sampler : samplers) sampler.valid = false;
+        }
+
+        static const Statistics& getStatistics() { return statistics; }
+        static void resetStatistics() { statistics = Statistics{}; }
+    };
+
+}
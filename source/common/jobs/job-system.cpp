@@ -0,0 +1,200 @@
+#include "job-system.hpp"
+
+#include <chrono>
+
+namespace our {
+
+    namespace {
+        // The system that owns the calling thread (if it is a worker) and the index of its queue
+        thread_local const JobSystem* currentSystem = nullptr;
+        thread_local size_t currentQueueIndex = 0;
+
+        std::uint64_t getNanoseconds(std::chrono::steady_clock::duration duration) {
+            return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        }
+    }
+
+    void JobSystem::start(int workerCount) {
+        stop();
+        if(workerCount < 0) workerCount = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+        stopping = false;
+        for(int index = 0; index <= workerCount; index++) workers.push_back(std::make_unique<Worker>());
+        // The threads are started after all the queues exist since they steal from each other
+        for(size_t index = 1; index < workers.size(); index++) {
+            workers[index]->thread = std::thread([this, index](){
+                currentSystem = this;
+                currentQueueIndex = index;
+                workerLoop(index);
+            });
+        }
+    }
+
+    void JobSystem::stop() {
+        if(workers.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for(size_t index = 1; index < workers.size(); index++) workers[index]->thread.join();
+        // If there are no workers, the remaining jobs are run by the calling thread
+        Job job;
+        while(pop(0, job)) execute(0, job);
+        workers.clear();
+    }
+
+    size_t JobSystem::getQueueIndex() const {
+        return currentSystem == this ? currentQueueIndex : 0;
+    }
+
+    void JobSystem::run(std::function<void()> function, JobCounter* counter) {
+        if(counter) counter->pending++;
+        push({ std::move(function), counter });
+    }
+
+    void JobSystem::run(std::function<void()> function, JobCounter* counter, JobCounter& dependency) {
+        if(counter) counter->pending++;
+        {
+            std::lock_guard<std::mutex> lock(dependency.mutex);
+            if(dependency.pending.load() > 0) {
+                dependency.dependents.emplace_back(std::move(function), counter);
+                return;
+            }
+        }
+        push({ std::move(function), counter });
+    }
+
+    void JobSystem::push(Job job) {
+        // If the system is not started, the job runs immediately
+        if(workers.empty()) {
+            job.function();
+            if(job.counter) finish(job.counter);
+            return;
+        }
+        Worker& worker = *workers[getQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.queue.push_back(std::move(job));
+            int depth = (int)worker.queue.size();
+            if(depth > worker.maxQueueDepth.load(std::memory_order_relaxed)) worker.maxQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+        queuedJobs++;
+        // A worker increments "sleepingWorkers" (under the sleep mutex) before checking "queuedJobs" and going to sleep,
+        // so if it is zero here, no worker can go to sleep without seeing this job
+        if(sleepingWorkers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            wakeCondition.notify_one();
+        }
+    }
+
+    bool JobSystem::pop(size_t queueIndex, Job& job) {
+        if(queuedJobs.load() == 0) return false;
+        // The owner takes the newest job from the back of its queue
+        Worker& own = *workers[queueIndex];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.queue.empty()) {
+                job = std::move(own.queue.back());
+                own.queue.pop_back();
+                queuedJobs--;
+                return true;
+            }
+        }
+        // Otherwise, it steals the oldest job from the front of another queue (starting from the next one so that the thieves spread out)
+        for(size_t offset = 1; offset < workers.size(); offset++) {
+            Worker& victim = *workers[(queueIndex + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.queue.empty()) {
+                job = std::move(victim.queue.front());
+                victim.queue.pop_front();
+                queuedJobs--;
+                own.stolenJobs.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void JobSystem::execute(size_t queueIndex, Job& job) {
+        job.function();
+        job.function = nullptr; // Release the captured data now instead of when the job object is reused
+        workers[queueIndex]->executedJobs.fetch_add(1, std::memory_order_relaxed);
+        if(job.counter) finish(job.counter);
+    }
+
+    void JobSystem::finish(JobCounter* counter) {
+        // The count is decremented under the mutex so that a waiter (which locks it after seeing zero) can't destroy the counter
+        // while it is still in use here
+        std::vector<std::pair<std::function<void()>, JobCounter*>> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if(--counter->pending == 0) ready.swap(counter->dependents);
+        }
+        for(auto& [function, dependentCounter] : ready) push({ std::move(function), dependentCounter });
+    }
+
+    void JobSystem::workerLoop(size_t queueIndex) {
+        Worker& worker = *workers[queueIndex];
+        Job job;
+        while(true) {
+            if(pop(queueIndex, job)) {
+                execute(queueIndex, job);
+                continue;
+            }
+            // The queued jobs are finished before stopping
+            if(stopping.load()) break;
+            auto idleStart = std::chrono::steady_clock::now();
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleepingWorkers++;
+                wakeCondition.wait(lock, [this](){ return stopping.load() || queuedJobs.load() > 0; });
+                sleepingWorkers--;
+            }
+            worker.idleNanoseconds.fetch_add(getNanoseconds(std::chrono::steady_clock::now() - idleStart), std::memory_order_relaxed);
+        }
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        if(!workers.empty()) {
+            size_t queueIndex = getQueueIndex();
+            Worker& worker = *workers[queueIndex];
+            Job job;
+            while(!counter.isDone()) {
+                if(pop(queueIndex, job)) {
+                    execute(queueIndex, job);
+                    continue;
+                }
+                // The remaining jobs are running on other threads
+                auto idleStart = std::chrono::steady_clock::now();
+                std::this_thread::yield();
+                worker.idleNanoseconds.fetch_add(getNanoseconds(std::chrono::steady_clock::now() - idleStart), std::memory_order_relaxed);
+            }
+        }
+        // Wait for the thread that finished the last job to release the counter
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    JobStatistics JobSystem::getStatistics() const {
+        JobStatistics statistics;
+        for(const auto& worker : workers) {
+            WorkerStatistics& result = statistics.workers.emplace_back();
+            result.executedJobs = worker->executedJobs.load(std::memory_order_relaxed);
+            result.stolenJobs = worker->stolenJobs.load(std::memory_order_relaxed);
+            result.idleTime = 1e-9 * (double)worker->idleNanoseconds.load(std::memory_order_relaxed);
+            result.maxQueueDepth = worker->maxQueueDepth.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            result.queueDepth = (int)worker->queue.size();
+        }
+        return statistics;
+    }
+
+    void JobSystem::resetStatistics() {
+        for(auto& worker : workers) {
+            worker->executedJobs = 0;
+            worker->stolenJobs = 0;
+            worker->idleNanoseconds = 0;
+            worker->maxQueueDepth = 0;
+        }
+    }
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    class JobSystem;
+
+    // A counter tracks a group of jobs: it is incremented when a job of the group is submitted and decremented when it finishes.
+    // A thread can wait for the group to finish (see "JobSystem::wait") and jobs can depend on it (see "JobSystem::run"),
+    // in which case they are only queued once the counter reaches zero.
+    // A counter must outlive the jobs that use it, so it is usually waited for before it goes out of scope.
+    class JobCounter {
+        std::atomic<int> pending{0};
+        std::mutex mutex; // Protects the dependent jobs (the count is also decremented under it, see "JobSystem::finish")
+        std::vector<std::pair<std::function<void()>, JobCounter*>> dependents; // The jobs waiting for the counter to reach zero (with their own counters)
+        friend JobSystem;
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        // Returns true if all the jobs of the group finished
+        bool isDone() const { return pending.load() == 0; }
+    };
+
+    // The activity of a queue (the queue 0 belongs to the main thread and the others belong to the workers)
+    struct WorkerStatistics {
+        std::uint64_t executedJobs = 0; // The jobs executed by this thread
+        std::uint64_t stolenJobs = 0;   // The jobs that this thread took from the queues of other threads
+        double idleTime = 0;            // The seconds this thread spent waiting for work (for the main thread, while waiting for a counter)
+        int queueDepth = 0;             // The number of jobs in the queue when the statistics were read
+        int maxQueueDepth = 0;          // The largest number of jobs that were in the queue at once
+    };
+
+    struct JobStatistics {
+        std::vector<WorkerStatistics> workers;
+
+        // Returns the sum of the statistics of all the threads (the max queue depth is the largest one)
+        WorkerStatistics getTotal() const {
+            WorkerStatistics total;
+            for(const auto& worker : workers) {
+                total.executedJobs += worker.executedJobs;
+                total.stolenJobs += worker.stolenJobs;
+                total.idleTime += worker.idleTime;
+                total.queueDepth += worker.queueDepth;
+                total.maxQueueDepth = std::max(total.maxQueueDepth, worker.maxQueueDepth);
+            }
+            return total;
+        }
+    };
+
+    // The job system runs small functions (jobs) on a pool of worker threads.
+    // Each thread has its own double ended queue: a thread pushes & pops the jobs it submits at the back of its queue
+    // (so it runs the most recent ones first while their data is still in the cache), and a thread that runs out of work
+    // steals the oldest job from the front of another thread's queue. So the threads rarely contend on the same queue.
+    // The main thread (or any thread that isn't a worker) uses the queue 0 and it helps running the jobs while it waits for a counter,
+    // so the work still progresses if the system has no workers (e.g. on a single core machine).
+    // The idle workers sleep until a job is submitted.
+    class JobSystem {
+        struct Job {
+            std::function<void()> function;
+            JobCounter* counter; // Decremented when the job finishes (could be null)
+        };
+
+        // The statistics are atomic since the main thread can read them while the workers update them
+        struct Worker {
+            std::mutex mutex; // Protects the queue
+            std::deque<Job> queue;
+            std::thread thread;
+            std::atomic<std::uint64_t> executedJobs{0}, stolenJobs{0}, idleNanoseconds{0};
+            std::atomic<int> maxQueueDepth{0};
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers; // The queue 0 is for the main thread & the others are for the worker threads
+        std::atomic<int> queuedJobs{0};      // The number of jobs in all the queues
+        std::atomic<int> sleepingWorkers{0};
+        std::atomic<bool> stopping{false};
+        std::mutex sleepMutex;
+        std::condition_variable wakeCondition;
+
+        // Returns the index of the queue used by the calling thread
+        size_t getQueueIndex() const;
+        // Adds a job to the queue of the calling thread and wakes a sleeping worker
+        void push(Job job);
+        // Takes a job from the queue of the given thread or steals one from the other queues. Returns false if all the queues are empty.
+        bool pop(size_t queueIndex, Job& job);
+        // Runs a job then decrements its counter
+        void execute(size_t queueIndex, Job& job);
+        // Decrements a counter and queues the jobs that depended on it if it reached zero
+        void finish(JobCounter* counter);
+        void workerLoop(size_t queueIndex);
+
+    public:
+        JobSystem() = default;
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        ~JobSystem() { stop(); }
+
+        // Starts the worker threads. If the count is negative, one worker is started per hardware thread except the main one.
+        // With zero workers, the jobs are run by the threads that wait for them.
+        void start(int workerCount = -1);
+        // Runs the queued jobs then stops the worker threads
+        void stop();
+
+        // Returns the number of worker threads (not counting the main thread)
+        int getWorkerCount() const { return workers.empty() ? 0 : (int)workers.size() - 1; }
+        // Returns the index of the calling thread: 0 for the main thread (or any thread that isn't a worker) and 1 to "getWorkerCount()" for the workers.
+        // It could be used to give each thread its own data (e.g. an array with "getWorkerCount() + 1" elements).
+        int getThreadIndex() const { return (int)getQueueIndex(); }
+
+        // Submits a job. If a counter is given, it is incremented now and decremented when the job finishes.
+        void run(std::function<void()> function, JobCounter* counter = nullptr);
+        // Submits a job that is only queued after all the jobs of the dependency counter finish
+        void run(std::function<void()> function, JobCounter* counter, JobCounter& dependency);
+
+        // Blocks till all the jobs of the counter finish. Meanwhile, the calling thread runs the queued jobs.
+        void wait(JobCounter& counter);
+
+        // Calls function(begin, end) on consecutive ranges of [0, count) in parallel and returns after all of them finish.
+        // The ranges have "batchSize" elements (except the last one). If it is zero, the range is split into a few batches per thread.
+        template<typename Function>
+        void parallelFor(size_t count, size_t batchSize, Function&& function) {
+            if(count == 0) return;
+            if(batchSize == 0) batchSize = std::max<size_t>(1, count / (4 * (getWorkerCount() + 1)));
+            JobCounter counter;
+            // The calling thread runs the first batch itself after submitting the others
+            for(size_t begin = batchSize; begin < count; begin += batchSize) {
+                size_t end = std::min(count, begin + batchSize);
+                run([&function, begin, end](){ function(begin, end); }, &counter);
+            }
+            function((size_t)0, std::min(count, batchSize));
+            wait(counter);
+        }
+
+        // Returns the activity of each thread since the system started (or since the statistics were reset)
+        JobStatistics getStatistics() const;
+        void resetStatistics();
+    };
+
+}
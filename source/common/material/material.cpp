@@ -5,14 +5,30 @@
 
 namespace our {
 
+    // The handles of the uniforms set by the materials
+    // They are resolved once and work with any shader program (see "UniformHandle" in "shader.hpp")
+    namespace {
+        const UniformHandle TINT_UNIFORM = ShaderProgram::getUniformHandle("tint");
+        const UniformHandle ALPHA_THRESHOLD_UNIFORM = ShaderProgram::getUniformHandle("alphaThreshold");
+        const UniformHandle TEX_UNIFORM = ShaderProgram::getUniformHandle("tex");
+        const UniformHandle MATERIAL_ALBEDO_UNIFORM = ShaderProgram::getUniformHandle("material.albedo");
+        const UniformHandle MATERIAL_SPECULAR_UNIFORM = ShaderProgram::getUniformHandle("material.specular");
+        const UniformHandle MATERIAL_ROUGHNESS_UNIFORM = ShaderProgram::getUniformHandle("material.roughness");
+        const UniformHandle MATERIAL_AMBIENT_OCCLUSION_UNIFORM = ShaderProgram::getUniformHandle("material.ambient_occlusion");
+        const UniformHandle MATERIAL_AMBIENT_OCCLUSION_ENABLE_UNIFORM = ShaderProgram::getUniformHandle("material.ambientOcclusionEnable");
+        const UniformHandle MATERIAL_EMISSIVE_UNIFORM = ShaderProgram::getUniformHandle("material.emissive");
+        const UniformHandle MATERIAL_ALPHA_UNIFORM = ShaderProgram::getUniformHandle("material.alpha");
+        const UniformHandle MATERIAL_ALPHA_TEXTURE_ENABLE_UNIFORM = ShaderProgram::getUniformHandle("material.alphaTextureEnable");
+    }
+
     // This function should setup the pipeline state and set the shader to be used
-    void Material::setup() const {
+    void Material::setup(ShaderProgram* program) const {
         //TODO: (Req 6) Write this function
         pipelineState.setup();
 
 
         //set the shder to be used 
-        shader->use();
+        (program ? program : shader)->use();
     }
 
     // This function read the material data from a json object
@@ -28,12 +44,13 @@ namespace our {
 
     // This function should call the setup of its parent and
     // set the "tint" uniform to the value in the member variable tint 
-    void TintedMaterial::setup() const {
+    void TintedMaterial::setup(ShaderProgram* program) const {
         //TODO: (Req 6) Write this function
-        Material::setup() ;
+        Material::setup(program);
+        if(!program) program = shader;
 
         //set the uniform value of the tint
-        shader->set("tint",tint);
+        program->set(TINT_UNIFORM, tint);
 
     }
 
@@ -47,21 +64,23 @@ namespace our {
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex" 
-    void TexturedMaterial::setup() const {
+    void TexturedMaterial::setup(ShaderProgram* program) const {
         //TODO: (Req 6) Write this function
-        TintedMaterial::setup() ;
+        TintedMaterial::setup(program);
+        if(!program) program = shader;
         
         //set the uniform value of the alphaThreshold
-        shader->set("alphaThreshold",alphaThreshold);
+        program->set(ALPHA_THRESHOLD_UNIFORM, alphaThreshold);
 
-        // bind the texture 
+        // bind the texture to unit 0
+        GLStateCache::activeTexture(0);
         texture->bind();
 
         //bind the sampler
         sampler->bind(0);
 
         //send the uniform value of the textiure unit 
-        shader->set("tex",0);
+        program->set(TEX_UNIFORM, 0);
     }
 
     // This function read the material data from a json object
@@ -77,56 +96,70 @@ namespace our {
 
 
 
-    void LightedMaterial::setup() const {
+    void LightedMaterial::setup(ShaderProgram* program) const {
         
-        Material::setup();
+        Material::setup(program);
+        if(!program) program = shader;
 
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::activeTexture(0);
         if (albedoTexture)
             albedoTexture->bind();
         albedoSampler->bind(0);
-        shader->set("material.albedo", 0);
+        program->set(MATERIAL_ALBEDO_UNIFORM, 0);
 
-        glActiveTexture(GL_TEXTURE1);
+        GLStateCache::activeTexture(1);
         if (specularTexture)
             specularTexture->bind();
         specularSampler->bind(1);
-        shader->set("material.specular", 1);
+        program->set(MATERIAL_SPECULAR_UNIFORM, 1);
 
-        glActiveTexture(GL_TEXTURE2);
+        GLStateCache::activeTexture(2);
         if (roughnessTexture)
             roughnessTexture->bind();
         roughnessSampler->bind(2);
-        shader->set("material.roughness", 2);
+        program->set(MATERIAL_ROUGHNESS_UNIFORM, 2);
 
-        glActiveTexture(GL_TEXTURE3);
+        GLStateCache::activeTexture(3);
         if (ambientOcclusionTexture)
         {
             ambientOcclusionTexture->bind();
-            shader->set("material.ambientOcclusionEnable", true);
+            program->set(MATERIAL_AMBIENT_OCCLUSION_ENABLE_UNIFORM, true);
         }else
-            shader->set("material.ambientOcclusionEnable", false);
+            program->set(MATERIAL_AMBIENT_OCCLUSION_ENABLE_UNIFORM, false);
         ambientOcclusionSampler->bind(3);
-        shader->set("material.ambient_occlusion", 3);
+        program->set(MATERIAL_AMBIENT_OCCLUSION_UNIFORM, 3);
 
-        glActiveTexture(GL_TEXTURE4);
+        GLStateCache::activeTexture(4);
         if (emissiveTexture)
             emissiveTexture->bind();
         emissiveSampler->bind(4);
-        shader->set("material.emissive", 4);
+        program->set(MATERIAL_EMISSIVE_UNIFORM, 4);
 
-        glActiveTexture(GL_TEXTURE5);
+        GLStateCache::activeTexture(5);
         if (alphaTexture)
         {
             alphaTexture->bind();
-            shader->set("material.alphaTextureEnable", true);
+            program->set(MATERIAL_ALPHA_TEXTURE_ENABLE_UNIFORM, true);
         }
         else
-            shader->set("material.alphaTextureEnable", false);
+            program->set(MATERIAL_ALPHA_TEXTURE_ENABLE_UNIFORM, false);
         alphaSampler->bind(5);
-        shader->set("material.alpha", 5);
+        program->set(MATERIAL_ALPHA_UNIFORM, 5);
 
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::activeTexture(0);
+    }
+
+    // Returns the texture bound to each unit by "LightedMaterial::setup"
+    Texture2D* LightedMaterial::getTexture(GLuint unit) const {
+        switch(unit){
+            case 0: return albedoTexture;
+            case 1: return specularTexture;
+            case 2: return roughnessTexture;
+            case 3: return ambientOcclusionTexture;
+            case 4: return emissiveTexture;
+            case 5: return alphaTexture;
+            default: return nullptr;
+        }
     }
 
     // This function read the material data from a json object
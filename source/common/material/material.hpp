@@ -7,6 +7,7 @@
 
 #include <glm/vec4.hpp>
 #include <json/json.hpp>
+#include <cstdint>
 
 namespace our {
 
@@ -17,15 +18,29 @@ namespace our {
     // 3- Whether this material is transparent or not
     // Materials that send uniforms to the shader should inherit from the is material and add the required uniforms
     class Material {
+        // A counter used to give each material a unique id
+        inline static std::uint32_t nextId = 0;
+        std::uint32_t id = nextId++;
     public:
+        // The maximum number of texture units that a material binds in "setup"
+        static constexpr GLuint MAX_TEXTURE_UNITS = 6;
+
         PipelineState pipelineState;
         ShaderProgram* shader;
         bool transparent;
         
         // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        // If "program" is given (e.g. the instanced variant of "shader"), it is used and receives the uniforms instead of "shader"
+        virtual void setup(ShaderProgram* program = nullptr) const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
+        // Returns the texture that "setup" binds to the given texture unit (or nullptr if it binds none)
+        virtual Texture2D* getTexture(GLuint unit) const { return nullptr; }
+
+        // Returns a number that uniquely identifies this material (useful for sorting draws by material)
+        std::uint32_t getId() const { return id; }
+
+        virtual ~Material() = default;
     };
 
     // This material adds a uniform for a tint (a color that will be sent to the shader)
@@ -34,7 +49,7 @@ namespace our {
     public:
         glm::vec4 tint;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -49,8 +64,9 @@ namespace our {
         Sampler* sampler;
         float alphaThreshold;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json& data) override;
+        Texture2D* getTexture(GLuint unit) const override { return unit == 0 ? texture : nullptr; }
     };
 
 
@@ -76,8 +92,9 @@ namespace our {
         Texture2D *alphaTexture;
         Sampler *alphaSampler;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json &data) override;
+        Texture2D* getTexture(GLuint unit) const override;
     };
 
 
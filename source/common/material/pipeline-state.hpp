@@ -3,6 +3,7 @@
 #include <glad/gl.h>
 #include <glm/vec4.hpp>
 #include <json/json.hpp>
+#include "../gl-state-cache.hpp"
 
 namespace our {
     // There are some options in the render pipeline that we cannot control via shaders
@@ -40,12 +41,13 @@ namespace our {
 
         // This function should set the OpenGL options to the values specified by this structure
         // For example, if faceCulling.enabled is true, you should call glEnable(GL_CULL_FACE), otherwise, you should call glDisable(GL_CULL_FACE)
+        // All the calls go through the GLStateCache so the options that are already set are not sent again to OpenGL
         void setup() const {
             //TODO: (Req 3) Write this function
 
 
-            glDepthMask(depthMask);
-            glColorMask(colorMask[0],colorMask[1],colorMask[2],colorMask[3]);
+            GLStateCache::depthMask(depthMask);
+            GLStateCache::colorMask(colorMask);
             // checking blending
             // blending gives us the ability to render semi-transparent images with different levels of transparency
             /*
@@ -59,37 +61,37 @@ namespace our {
             F_destination: the destination factor value. Sets the impact of the alpha value on the destination color
             */
             if(blending.enabled){
-                glEnable(GL_BLEND); // not sure if disabled by default
+                GLStateCache::setEnabled(GL_BLEND, true); // not sure if disabled by default
                 // glBlendEquation is used to pass the equation we want to use between the source & destination
-                glBlendEquation(blending.equation);
+                GLStateCache::blendEquation(blending.equation);
                 // glBlendFunc we pass the alpha of the source & the destination
-                glBlendFunc(blending.sourceFactor, blending.destinationFactor);
+                GLStateCache::blendFunc(blending.sourceFactor, blending.destinationFactor);
                 // glBendColor must be set using this func
-                glBlendColor(blending.constantColor[0],blending.constantColor[1],blending.constantColor[2],blending.constantColor[3]);
+                GLStateCache::blendColor(blending.constantColor);
             }else{
-                glDisable(GL_BLEND);
+                GLStateCache::setEnabled(GL_BLEND, false);
             }
 
             // checking depth_testing 
             if(depthTesting.enabled){
-                glEnable(GL_DEPTH_TEST); // disabled by default
+                GLStateCache::setEnabled(GL_DEPTH_TEST, true); // disabled by default
                 
                 // setting the comparison operator of the depth test func
-                glDepthFunc(depthTesting.function); 
+                GLStateCache::depthFunc(depthTesting.function); 
             }else{
-                glDisable(GL_DEPTH_TEST);
+                GLStateCache::setEnabled(GL_DEPTH_TEST, false);
             }
 
             // checking face_cull 
             if(faceCulling.enabled){
-                glEnable(GL_CULL_FACE); // disabled by default
+                GLStateCache::setEnabled(GL_CULL_FACE, true); // disabled by default
                 // from now on all faces that aren't front faces are discarded which increase 50% of performance
                 // in func glCullFace we choose which face to cull'discard' Front/Back or both "default value GL_BACK"
-                glCullFace(faceCulling.culledFace);
+                GLStateCache::cullFace(faceCulling.culledFace);
                 // in func glFrontFace we choose that we would prefer clockwise faces than counter-clockwise faces "default value GL_CCW"
-                glFrontFace(faceCulling.frontFace);
+                GLStateCache::frontFace(faceCulling.frontFace);
             }else{
-                glDisable(GL_CULL_FACE);
+                GLStateCache::setEnabled(GL_CULL_FACE, false);
             }
 
             //
@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "../gl-state-cache.hpp"
 
 namespace our {
 
@@ -8,6 +9,17 @@ namespace our {
     #define ATTRIB_LOC_COLOR    1
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
+    // The per-instance attributes read by the instanced shader variants (a mat4 takes 4 locations, one per column)
+    #define ATTRIB_LOC_INSTANCE_M   4
+    #define ATTRIB_LOC_INSTANCE_MIT 8
+    #define ATTRIB_LOC_INSTANCE_LIGHTS 12
+
+    // The data of one instance in an instance buffer (see "Mesh::drawInstanced")
+    struct InstanceData {
+        glm::mat4 M;    // The model (local to world) matrix
+        glm::mat4 MIT;  // The inverse transpose of the model matrix (used to transform the normals)
+        glm::uvec2 lights; // The packed indices of the lights that reach the instance (see "LightSelection")
+    };
 
     class Mesh {
         // Here, we store the object names of the 3 main components of a mesh:
@@ -16,6 +28,13 @@ namespace our {
         unsigned int VAO;
         // We need to remember the number of elements that will be draw by glDrawElements 
         GLsizei elementCount;
+        // The bounding volumes of the vertices in the local space (computed once by the constructor)
+        // These are used to skip drawing the meshes that are outside the camera frustum
+        glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+        glm::vec3 boundingSphereCenter = glm::vec3(0.0f);
+        float boundingSphereRadius = 0.0f;
+        // Whether the per-instance attributes were enabled on the vertex array (done once on the first instanced draw)
+        bool instanceAttributesEnabled = false;
     public:
 
         // The constructor takes two vectors:
@@ -34,6 +53,22 @@ namespace our {
             //Setting elementCount that will be used later with size of elements vector.
             this->elementCount =(int) elements.size();
 
+            // Compute the local bounding box, then the bounding sphere around its center
+            if(!vertices.empty()){
+                boundsMin = boundsMax = vertices[0].position;
+                for(const Vertex& vertex : vertices){
+                    boundsMin = glm::min(boundsMin, vertex.position);
+                    boundsMax = glm::max(boundsMax, vertex.position);
+                }
+                boundingSphereCenter = 0.5f * (boundsMin + boundsMax);
+                float radiusSquared = 0.0f;
+                for(const Vertex& vertex : vertices){
+                    glm::vec3 offset = vertex.position - boundingSphereCenter;
+                    radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+                }
+                boundingSphereRadius = glm::sqrt(radiusSquared);
+            }
+
             
             //Create arrays instead of vectors to be able to pass it to gl functions .
             Vertex * VertArr = new Vertex[vertices.size()];
@@ -55,7 +90,7 @@ namespace our {
             //Firstly, Positions of float values in the created array (VerArr) which are not normalized.
 
             glGenVertexArrays(1,&VAO);
-            glBindVertexArray(VAO);
+            GLStateCache::bindVertexArray(VAO);
             glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
             glVertexAttribPointer(ATTRIB_LOC_POSITION,3,GL_FLOAT,false,sizeof(Vertex),(void*) 0);
     
@@ -88,13 +123,62 @@ namespace our {
         void draw() 
         {
             // //TODO: (Req 1) Write this function
-            glBindVertexArray(VAO);
+            GLStateCache::bindVertexArray(VAO);
             glDrawElements(GL_TRIANGLES, this->elementCount, GL_UNSIGNED_INT, (void*)0);
         }
 
+        // This function renders "instanceCount" copies of the mesh in one draw call
+        // The data of the instances is read from "instanceBuffer" as an array of "InstanceData" starting at the byte "offset"
+        void drawInstanced(GLsizei instanceCount, GLuint instanceBuffer, GLintptr offset)
+        {
+            GLStateCache::bindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            for(GLuint column = 0; column < 4; column++){
+                if(!instanceAttributesEnabled){
+                    glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_M + column);
+                    glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_M + column, 1);
+                    glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_MIT + column);
+                    glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_MIT + column, 1);
+                }
+                // The pointers depend on the offset so they are set on every draw
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_M + column, 4, GL_FLOAT, false, sizeof(InstanceData),
+                    (void*)(offset + offsetof(InstanceData, M) + column * sizeof(glm::vec4)));
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_MIT + column, 4, GL_FLOAT, false, sizeof(InstanceData),
+                    (void*)(offset + offsetof(InstanceData, MIT) + column * sizeof(glm::vec4)));
+            }
+            if(!instanceAttributesEnabled){
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_LIGHTS);
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_LIGHTS, 1);
+            }
+            glVertexAttribIPointer(ATTRIB_LOC_INSTANCE_LIGHTS, 2, GL_UNSIGNED_INT, sizeof(InstanceData),
+                (void*)(offset + offsetof(InstanceData, lights)));
+            instanceAttributesEnabled = true;
+            glDrawElementsInstanced(GL_TRIANGLES, this->elementCount, GL_UNSIGNED_INT, (void*)0, instanceCount);
+        }
+
+        // This function renders "instanceCount" copies of the mesh without any instance data (the shader tells them apart by gl_InstanceID)
+        void drawCopies(GLsizei instanceCount)
+        {
+            GLStateCache::bindVertexArray(VAO);
+            glDrawElementsInstanced(GL_TRIANGLES, this->elementCount, GL_UNSIGNED_INT, (void*)0, instanceCount);
+        }
+
+        // Get the local axis aligned bounding box of the mesh
+        glm::vec3 getBoundsMin() const { return boundsMin; }
+        glm::vec3 getBoundsMax() const { return boundsMax; }
+        // Get the local bounding sphere of the mesh
+        glm::vec3 getBoundingSphereCenter() const { return boundingSphereCenter; }
+        float getBoundingSphereRadius() const { return boundingSphereRadius; }
+
+        // Get the OpenGL name of the vertex array object (useful to identify the mesh, e.g. in render sort keys)
+        GLuint getVertexArray() const {
+            return VAO;
+        }
+
         // this function should delete the vertex & element buffers and the vertex array object
         ~Mesh(){
             //TODO: (Req 1) Write this function
+            GLStateCache::forgetVertexArray(VAO);
             glDeleteVertexArrays(1,&VAO);
             glDeleteBuffers(1,&VBO);
             glDeleteBuffers(1,&EBO);
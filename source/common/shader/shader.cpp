@@ -4,12 +4,13 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <unordered_map>
 
 //Forward definition for error checking functions
 std::string checkForShaderCompilationErrors(GLuint shader);
 std::string checkForLinkingErrors(GLuint program);
 
-bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const {
+bool our::ShaderProgram::attach(const std::string &filename, GLenum type) {
     // Here, we open the file and read a string from it containing the GLSL code of our shader
     std::ifstream file(filename);
     if(!file){
@@ -17,6 +18,13 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
         return false;
     }
     std::string sourceString = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    // The defines must come after the "#version" line (which has to be the first line of the shader)
+    if(!defines.empty()){
+        size_t versionLine = sourceString.find("#version");
+        size_t insertAt = versionLine == std::string::npos ? 0 : sourceString.find('\n', versionLine);
+        insertAt = insertAt == std::string::npos ? sourceString.size() : insertAt + 1;
+        sourceString.insert(insertAt, defines);
+    }
     const char* sourceCStr = sourceString.c_str();
     file.close();
 
@@ -38,13 +46,16 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
     glAttachShader(program, shaderID);
     glDeleteShader(shaderID);
 
+    // Remember the file to be able to compile the variants of this program later
+    stages.emplace_back(filename, type);
+
     //We return true since the compilation succeeded
     return true;
 }
 
 
 
-bool our::ShaderProgram::link() const {
+bool our::ShaderProgram::link() {
     // call opengl to link the program identified by this->program 
     glLinkProgram(program);
 
@@ -53,9 +64,89 @@ bool our::ShaderProgram::link() const {
         std::cerr << error << std::endl;
         return false;
     }
+
+    // Build the uniform table: for every active uniform, we register its name and store its location under the name's handle
+    uniformLocations.clear();
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::string name(maxNameLength, '\0');
+    auto addUniform = [this](const std::string& uniformName){
+        GLint location = glGetUniformLocation(program, uniformName.c_str());
+        if(location < 0) return; // Uniforms inside uniform blocks have no location
+        UniformHandle handle = getUniformHandle(uniformName);
+        if(handle.index >= uniformLocations.size()) uniformLocations.resize(handle.index + 1, -1);
+        uniformLocations[handle.index] = location;
+    };
+    for(GLint index = 0; index < uniformCount; ++index){
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, (GLuint)index, maxNameLength, &length, &size, &type, name.data());
+        std::string uniformName = name.substr(0, length);
+        addUniform(uniformName);
+        // Arrays of basic types are listed once as "name[0]", so we add the array name itself and each of the other elements
+        if(auto bracket = uniformName.rfind("[0]"); bracket != std::string::npos && bracket + 3 == uniformName.size()){
+            std::string arrayName = uniformName.substr(0, bracket);
+            addUniform(arrayName);
+            for(GLint element = 1; element < size; ++element)
+                addUniform(arrayName + "[" + std::to_string(element) + "]");
+        }
+    }
+
+    // Connect the shared uniform blocks (if the program declares any of them) to their fixed binding points
+    const std::pair<const char*, GLuint> sharedBlocks[] = {
+        {"Camera", UNIFORM_BLOCK_CAMERA},
+        {"Lights", UNIFORM_BLOCK_LIGHTS},
+        {"Sky", UNIFORM_BLOCK_SKY},
+        {"Clusters", UNIFORM_BLOCK_CLUSTERS}
+    };
+    for(auto& [blockName, bindingPoint] : sharedBlocks){
+        GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+        if(blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, bindingPoint);
+    }
+    lit = glGetUniformBlockIndex(program, "Lights") != GL_INVALID_INDEX;
     return true;
 }
 
+our::ShaderProgram* our::ShaderProgram::getVariant(const std::string& define) {
+    for(auto& [variantDefine, variant] : variants)
+        if(variantDefine == define) return variant;
+    auto variant = new ShaderProgram();
+    variant->defines = defines + "#define " + define + "\n";
+    bool success = !stages.empty();
+    for(auto& [filename, type] : stages) success = success && variant->attach(filename, type);
+    if(!success || !variant->link()){
+        // The caller will draw with this program instead
+        std::cerr << "WARNING: Couldn't build the " << define << " variant of a shader program" << std::endl;
+        delete variant;
+        variant = nullptr;
+    }
+    variants.emplace_back(define, variant);
+    return variant;
+}
+
+// The registry that gives each uniform name a unique handle index
+static std::unordered_map<std::string, GLuint>& uniformHandleRegistry(){
+    static std::unordered_map<std::string, GLuint> registry;
+    return registry;
+}
+
+our::UniformHandle our::ShaderProgram::getUniformHandle(const std::string &name) {
+    auto& registry = uniformHandleRegistry();
+    auto it = registry.try_emplace(name, (GLuint)registry.size()).first;
+    return UniformHandle{it->second};
+}
+
+bool our::ShaderProgram::findUniformHandle(const std::string &name, UniformHandle& handle) {
+    auto& registry = uniformHandleRegistry();
+    if(auto it = registry.find(name); it != registry.end()){
+        handle.index = it->second;
+        return true;
+    }
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function to check for compilation and linking error in shaders //
 ////////////////////////////////////////////////////////////////////
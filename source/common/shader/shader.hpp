@@ -2,35 +2,136 @@
 #define SHADER_HPP
 
 #include <string>
+#include <vector>
+#include <utility>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "../gl-state-cache.hpp"
+
 namespace our {
 
+    // The binding points of the uniform blocks that hold per-frame data shared by all the programs
+    // When a program declares a uniform block with one of the names below, "link" connects it to the matching binding point
+    #define UNIFORM_BLOCK_CAMERA 0  // uniform Camera { mat4 VP; vec3 eye; }
+    #define UNIFORM_BLOCK_LIGHTS 1  // uniform Lights { int light_count; Light lights[MAX_LIGHTS]; }
+    #define UNIFORM_BLOCK_SKY    2  // uniform Sky { vec3 top, middle, bottom; }
+    #define UNIFORM_BLOCK_CLUSTERS 3 // uniform Clusters { mat4 cluster_view; uvec4 cluster_counts; vec4 cluster_depth; vec4 cluster_screen; }
+
+    // A uniform handle is a process-wide integer id given to a uniform name (e.g. "tint" or "lights[3].diffuse").
+    // It is resolved once using "ShaderProgram::getUniformHandle" (e.g. into a static variable) and can then be used with any program.
+    // Each program maps the handles to its own uniform locations at link time, so setting a uniform by handle
+    // needs neither a string nor a call to "glGetUniformLocation".
+    struct UniformHandle {
+        GLuint index;
+    };
+
     class ShaderProgram {
 
     private:
         //Shader Program Handle (OpenGL object name)
         GLuint program;
+        // The location of each active uniform in this program indexed by the uniform handle index (filled by "link")
+        // Handles of names that are not used by this program are either outside the vector or map to -1
+        std::vector<GLint> uniformLocations;
+
+        // The files attached to this program (kept to compile its variants, see "getVariant")
+        std::vector<std::pair<std::string, GLenum>> stages;
+        // The lines inserted right after the "#version" line of every attached file (e.g. "#define INSTANCED\n")
+        std::string defines;
+        // The variants of this program by their define (created on first request and owned by this program)
+        // A variant that failed to compile is kept as nullptr so that it is not compiled again
+        std::vector<std::pair<std::string, ShaderProgram*>> variants;
+        // Whether the program declares the "Lights" uniform block (found by "link")
+        bool lit = false;
+
+        // Finds the handle of the given name (if any) without registering it
+        static bool findUniformHandle(const std::string &name, UniformHandle& handle);
 
     public:
         ShaderProgram(){ program = glCreateProgram(); }
-        ~ShaderProgram(){ if(program != 0) glDeleteProgram(program); }
+        ~ShaderProgram(){
+            for(auto& [define, variant] : variants) delete variant;
+            if(program != 0) { GLStateCache::forgetProgram(program); glDeleteProgram(program); }
+        }
 
-        bool attach(const std::string &filename, GLenum type) const;
+        bool attach(const std::string &filename, GLenum type);
 
-        bool link() const;
+        // Links the program, builds its uniform table from the list of active uniforms
+        // and connects the shared uniform blocks to their binding points
+        bool link();
 
         void use() { 
-            glUseProgram(program);
+            GLStateCache::useProgram(program);
+        }
+
+        // Returns a variant of this program compiled from the same files with the given name defined (e.g. "CLUSTERED")
+        // The variant is compiled on the first call and nullptr is returned if it fails to compile or link
+        ShaderProgram* getVariant(const std::string& define);
+
+        // Returns a variant of this program compiled from the same files with "INSTANCED" defined
+        // In that variant, the model matrices are read from per-instance vertex attributes (see "ATTRIB_LOC_INSTANCE_M" in "mesh.hpp")
+        ShaderProgram* getInstancedVariant() { return getVariant("INSTANCED"); }
+
+        // Returns true if the program reads the lights (declares the "Lights" uniform block)
+        bool usesLights() const { return lit; }
+
+        // Get the internal OpenGL name of the program (useful to identify it, e.g. in render sort keys)
+        GLuint getOpenGLName() const {
+            return program;
         }
 
-        GLuint getUniformLocation(const std::string &name) {
-            return glGetUniformLocation(program, name.c_str());
+        // Returns the handle of the given uniform name (the name is registered if it was never seen before)
+        static UniformHandle getUniformHandle(const std::string &name);
+
+        // Returns the location of the given uniform in this program (or -1 if the program does not use it)
+        GLint getUniformLocation(UniformHandle uniform) const {
+            return uniform.index < uniformLocations.size() ? uniformLocations[uniform.index] : -1;
+        }
+
+        GLint getUniformLocation(const std::string &name) const {
+            UniformHandle uniform;
+            return findUniformHandle(name, uniform) ? getUniformLocation(uniform) : -1;
+        }
+
+        // The following "set" functions send a value to a uniform of this program
+        // NOTE: the program must be in use (see "use") since they modify the current program
+        void set(UniformHandle uniform, GLfloat value) {
+            glUniform1f(getUniformLocation(uniform), value);
+        }
+
+        void set(UniformHandle uniform, GLuint value) {
+            glUniform1ui(getUniformLocation(uniform), value);
+        }
+
+        void set(UniformHandle uniform, GLint value) {
+            glUniform1i(getUniformLocation(uniform), value);
+        }
+
+        void set(UniformHandle uniform, glm::vec2 value) {
+            glUniform2f(getUniformLocation(uniform), value.x, value.y);
+        }
+
+        void set(UniformHandle uniform, glm::vec3 value) {
+            glUniform3f(getUniformLocation(uniform), value.x, value.y, value.z);
+        }
+
+        void set(UniformHandle uniform, glm::vec4 value) {
+            glUniform4f(getUniformLocation(uniform), value.x, value.y, value.z, value.w);
+        }
+
+        void set(UniformHandle uniform, glm::uvec2 value) {
+            glUniform2ui(getUniformLocation(uniform), value.x, value.y);
+        }
+
+        void set(UniformHandle uniform, const glm::mat4& matrix) {
+            glUniformMatrix4fv(getUniformLocation(uniform), 1, false, glm::value_ptr(matrix));
         }
 
+        // These overloads are convenient for code that is not performance critical
+        // For per-draw code, prefer resolving the handle once and using the overloads above
         void set(const std::string &uniform, GLfloat value) {
             glUniform1f(getUniformLocation(uniform), value);
         }
@@ -65,4 +166,4 @@ namespace our {
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/gl.h>
+
+namespace our
+{
+
+    // This class defines an OpenGL uniform buffer which holds the data of a uniform block
+    // It is used to send data that is shared by many draws (e.g. camera & lights) once instead of sending it to every program
+    class UniformBuffer
+    {
+        // The OpenGL object name of this buffer
+        GLuint name = 0;
+        // The size of the buffer storage in bytes
+        GLsizeiptr size = 0;
+
+    public:
+        // This constructor creates an OpenGL buffer and allocates "size" bytes of storage for it
+        UniformBuffer(GLsizeiptr size) : size(size)
+        {
+            glGenBuffers(1, &name);
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // This deconstructor deletes the underlying OpenGL buffer
+        ~UniformBuffer()
+        {
+            glDeleteBuffers(1, &name);
+        }
+
+        // This method replaces the content of the buffer with the given data
+        // The old storage is orphaned first so that we don't wait for the draws from the previous frame that may still read it
+        void update(const void *data, GLsizeiptr dataSize) const
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // A helper to upload a struct that mirrors the layout of the uniform block
+        template <typename T>
+        void update(const T &data) const
+        {
+            update(&data, sizeof(T));
+        }
+
+        // This method binds this buffer to the given uniform block binding point
+        void bind(GLuint bindingPoint) const
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, name);
+        }
+
+        UniformBuffer(const UniformBuffer &) = delete;
+        UniformBuffer &operator=(const UniformBuffer &) = delete;
+    };
+
+}
@@ -0,0 +1,207 @@
+#include "collision.hpp"
+#include "../components/mesh-renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace our {
+
+    collision::AABB collision::transformBox(const glm::mat4& M, glm::vec3 center, glm::vec3 extents) {
+        // The world half size on each axis is the sum of the absolute projections of the local axes (Arvo's method)
+        glm::vec3 worldCenter = glm::vec3(M * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtents =
+            glm::abs(glm::vec3(M[0])) * extents.x +
+            glm::abs(glm::vec3(M[1])) * extents.y +
+            glm::abs(glm::vec3(M[2])) * extents.z;
+        return { worldCenter - worldExtents, worldCenter + worldExtents };
+    }
+
+    bool collision::sweep(const AABB& a, glm::vec3 motionA, const AABB& b, glm::vec3 motionB, float& time) {
+        // In the frame of "b", only "a" moves. Growing "b" by the half size of "a" reduces "a" to its center point,
+        // so the test becomes the intersection of a segment with a box (the slab test).
+        glm::vec3 halfSize = 0.5f * (a.max - a.min);
+        glm::vec3 origin = 0.5f * (a.min + a.max);
+        glm::vec3 motion = motionA - motionB;
+        glm::vec3 boxMin = b.min - halfSize, boxMax = b.max + halfSize;
+        float first = 0.0f, last = 1.0f;
+        for(int axis = 0; axis < 3; axis++) {
+            if(std::abs(motion[axis]) < 1e-8f) {
+                // If it doesn't move on this axis, it must already be within the slab
+                if(origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return false;
+            } else {
+                float inverse = 1.0f / motion[axis];
+                float enter = (boxMin[axis] - origin[axis]) * inverse;
+                float exit = (boxMax[axis] - origin[axis]) * inverse;
+                if(enter > exit) std::swap(enter, exit);
+                first = std::max(first, enter);
+                last = std::min(last, exit);
+                if(first > last) return false;
+            }
+        }
+        time = first;
+        return true;
+    }
+
+    void CollisionSystem::initialize(const nlohmann::json& config) {
+        if(!config.is_object()) return;
+        cellSize = config.value("cell-size", cellSize);
+        maxCellsPerCollider = config.value("max-cells-per-collider", maxCellsPerCollider);
+    }
+
+    void CollisionSystem::getCellRange(const collision::AABB& box, glm::ivec3& first, glm::ivec3& last) const {
+        first = glm::ivec3(glm::floor(box.min / cellSize));
+        last = glm::ivec3(glm::floor(box.max / cellSize));
+    }
+
+    std::uint32_t CollisionSystem::getBucket(glm::ivec3 cell) const {
+        // The bucket count is a power of 2 so the hash is masked instead of using a modulo
+        std::uint32_t hash = ((std::uint32_t)cell.x * 73856093u) ^ ((std::uint32_t)cell.y * 19349663u) ^ ((std::uint32_t)cell.z * 83492791u);
+        return hash & (std::uint32_t)(bucketStart.size() - 2);
+    }
+
+    void CollisionSystem::buildGrid() {
+        // The number of buckets is the smallest power of 2 that is at least twice the number of colliders
+        std::uint32_t bucketCount = 64;
+        while(bucketCount < 2 * proxies.size()) bucketCount <<= 1;
+        bucketStart.assign(bucketCount + 1, 0);
+        oversized.clear();
+
+        // Count the entries of each bucket (bucketStart[bucket + 1] holds the count of "bucket" till the prefix sum)
+        // The colliders that cover too many cells are kept aside (e.g. a huge floor would be stored in every cell)
+        std::uint32_t entryCount = 0;
+        for(std::uint32_t index = 0; index < proxies.size(); index++) {
+            glm::ivec3 first, last;
+            const collision::AABB& bounds = proxies[index].bounds;
+            glm::vec3 cells = glm::floor(bounds.max / cellSize) - glm::floor(bounds.min / cellSize) + 1.0f;
+            proxies[index].oversized = cells.x * cells.y * cells.z > (float)maxCellsPerCollider;
+            if(proxies[index].oversized) {
+                oversized.push_back(index);
+                continue;
+            }
+            getCellRange(bounds, first, last);
+            for(int z = first.z; z <= last.z; z++)
+                for(int y = first.y; y <= last.y; y++)
+                    for(int x = first.x; x <= last.x; x++) {
+                        bucketStart[getBucket({x, y, z}) + 1]++;
+                        entryCount++;
+                    }
+        }
+        for(std::uint32_t bucket = 0; bucket < bucketCount; bucket++) bucketStart[bucket + 1] += bucketStart[bucket];
+
+        // Then fill each bucket from its end (the proxies are visited backwards so each bucket ends up in ascending order)
+        bucketEntries.resize(entryCount);
+        for(std::uint32_t index = (std::uint32_t)proxies.size(); index-- > 0;) {
+            if(proxies[index].oversized) continue;
+            glm::ivec3 first, last;
+            getCellRange(proxies[index].bounds, first, last);
+            for(int z = first.z; z <= last.z; z++)
+                for(int y = first.y; y <= last.y; y++)
+                    for(int x = first.x; x <= last.x; x++)
+                        bucketEntries[--bucketStart[getBucket({x, y, z}) + 1]] = index;
+        }
+        // Each "bucketStart[bucket + 1]" was decremented down to the start of "bucket", so shift them back by one bucket
+        for(std::uint32_t bucket = 0; bucket < bucketCount; bucket++) bucketStart[bucket] = bucketStart[bucket + 1];
+        bucketStart[bucketCount] = entryCount;
+    }
+
+    void CollisionSystem::testPair(std::uint32_t first, std::uint32_t second) {
+        const Proxy& a = proxies[first];
+        const Proxy& b = proxies[second];
+        statistics.testedPairs++;
+        float time;
+        if(!collision::sweep(a.start, a.motion, b.start, b.motion, time)) return;
+        std::uint64_t key = a.handle.value < b.handle.value ?
+            ((std::uint64_t)a.handle.value << 32) | b.handle.value :
+            ((std::uint64_t)b.handle.value << 32) | a.handle.value;
+        bool entered = !std::binary_search(previousContacts.begin(), previousContacts.end(), key);
+        contacts.push_back(key);
+        // The static collider is given second so that the consumers can assume that the first one is the mover
+        if(a.isStatic && !b.isStatic) events.push_back({b.handle, a.handle, time, entered});
+        else events.push_back({a.handle, b.handle, time, entered});
+    }
+
+    void CollisionSystem::update(World* world) {
+        proxies.clear();
+        events.clear();
+        contacts.clear();
+        statistics = CollisionStatistics();
+
+        // Compute the world space box of each collider and its motion since the last update
+        world->view<ColliderComponent>().each([this](Entity* entity, ColliderComponent& collider){
+            glm::vec3 center = collider.center, extents = collider.extents;
+            if(collider.useMeshBounds) {
+                if(auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer && meshRenderer->mesh) {
+                    center = 0.5f * (meshRenderer->mesh->getBoundsMax() + meshRenderer->mesh->getBoundsMin());
+                    extents = 0.5f * (meshRenderer->mesh->getBoundsMax() - meshRenderer->mesh->getBoundsMin());
+                }
+            }
+            collision::AABB current = collision::transformBox(entity->getLocalToWorldMatrix(), center, extents);
+            current.min -= collider.padding;
+            current.max += collider.padding;
+
+            Proxy proxy;
+            proxy.handle = entity->getHandle();
+            proxy.isStatic = collider.isStatic;
+            if(collider.swept && collider.hasPrevious) {
+                proxy.start = { collider.previousMin, collider.previousMax };
+                proxy.motion = 0.5f * (current.min + current.max) - 0.5f * (proxy.start.min + proxy.start.max);
+                proxy.bounds = collision::merge(proxy.start, current);
+            } else {
+                proxy.start = proxy.bounds = current;
+                proxy.motion = glm::vec3(0.0f);
+            }
+            collider.previousMin = current.min;
+            collider.previousMax = current.max;
+            collider.hasPrevious = true;
+            proxies.push_back(proxy);
+        });
+        statistics.colliders = (int)proxies.size();
+
+        buildGrid();
+        statistics.oversizedColliders = (int)oversized.size();
+        visited.assign(proxies.size(), 0);
+        query = 0;
+
+        // Each non-static collider in the grid queries the buckets of its cells
+        for(std::uint32_t index = 0; index < proxies.size(); index++) {
+            const Proxy& proxy = proxies[index];
+            if(proxy.isStatic || proxy.oversized) continue;
+            query++;
+            visited[index] = query;
+            glm::ivec3 first, last;
+            getCellRange(proxy.bounds, first, last);
+            for(int z = first.z; z <= last.z; z++)
+                for(int y = first.y; y <= last.y; y++)
+                    for(int x = first.x; x <= last.x; x++) {
+                        std::uint32_t bucket = getBucket({x, y, z});
+                        for(std::uint32_t entry = bucketStart[bucket]; entry < bucketStart[bucket + 1]; entry++) {
+                            std::uint32_t other = bucketEntries[entry];
+                            // A collider can be found in many cells (and buckets are shared by the cells with the same hash)
+                            if(visited[other] == query) continue;
+                            visited[other] = query;
+                            // A pair of non-static colliders is found by both of them, so it is only tested by the first one
+                            if(!proxies[other].isStatic && other < index) continue;
+                            if(collision::overlaps(proxy.bounds, proxies[other].bounds)) testPair(index, other);
+                        }
+                    }
+        }
+
+        // The oversized colliders are tested against all the other colliders (skipping the pairs of static colliders)
+        for(std::uint32_t oversizedIndex = 0; oversizedIndex < oversized.size(); oversizedIndex++) {
+            std::uint32_t index = oversized[oversizedIndex];
+            const Proxy& proxy = proxies[index];
+            for(std::uint32_t other = 0; other < proxies.size(); other++) {
+                if(other == index || (proxy.isStatic && proxies[other].isStatic)) continue;
+                // A pair of oversized colliders is only tested once
+                if(other < index && proxies[other].oversized) continue;
+                if(collision::overlaps(proxy.bounds, proxies[other].bounds)) testPair(index, other);
+            }
+        }
+
+        // Keep the touching pairs to tell which events are new in the next update
+        std::sort(contacts.begin(), contacts.end());
+        std::swap(contacts, previousContacts);
+        statistics.contacts = (int)events.size();
+    }
+
+}
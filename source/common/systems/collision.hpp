@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/collider.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+
+namespace our {
+
+    // This namespace contains the geometric tests used by the collision system
+    namespace collision {
+
+        // An axis aligned bounding box
+        struct AABB {
+            glm::vec3 min, max;
+        };
+
+        // Returns true if the two boxes intersect (touching boxes are considered intersecting)
+        inline bool overlaps(const AABB& a, const AABB& b) {
+            return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+                   a.min.y <= b.max.y && b.min.y <= a.max.y &&
+                   a.min.z <= b.max.z && b.min.z <= a.max.z;
+        }
+
+        // Returns the smallest box that contains both boxes
+        inline AABB merge(const AABB& a, const AABB& b) {
+            return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+        }
+
+        // Returns the world space box that bounds the local box (center, extents) after transforming it by M
+        AABB transformBox(const glm::mat4& M, glm::vec3 center, glm::vec3 extents);
+
+        // Moves box "a" by "motionA" and box "b" by "motionB" (both linearly during the same interval) and checks if they touch.
+        // If they do, it returns true and "time" is set to the fraction of the interval [0, 1] at which they first touched.
+        // Since it tests the whole motion, it detects the collisions that happen between the start and the end of the interval.
+        bool sweep(const AABB& a, glm::vec3 motionA, const AABB& b, glm::vec3 motionB, float& time);
+
+    }
+
+    // An event generated by the collision system for each pair of colliders that touched during an update
+    struct CollisionEvent {
+        EntityHandle first, second; // The first entity is never static unless both entities are static
+        float time;   // The fraction of the last motion at which they touched (0 if they were already touching at its start)
+        bool entered; // True if the pair was not touching during the previous update
+
+        // Returns true if one of the two entities is the given one
+        bool involves(EntityHandle entity) const { return first == entity || second == entity; }
+        // Returns the entity that collided with the given one
+        EntityHandle getOther(EntityHandle entity) const { return first == entity ? second : first; }
+    };
+
+    // The number of colliders and pairs that were processed by the last update
+    struct CollisionStatistics {
+        int colliders = 0;
+        int oversizedColliders = 0; // The colliders that cover too many cells to be stored in the grid
+        int testedPairs = 0;        // The pairs that passed the broadphase and were tested by the sweep test
+        int contacts = 0;
+    };
+
+    // The collision system finds the colliding pairs of entities holding a ColliderComponent and reports them as events.
+    // The broadphase is a spatial hash: space is divided into a uniform grid of cubic cells and each collider is stored
+    // in the hash buckets of the cells that its box overlaps. Each non-static collider is then only tested against
+    // the colliders in its cells, so the cost grows with the number of nearby colliders instead of the total number.
+    // The hash table is rebuilt every update (the colliders are allowed to move freely) using a counting sort,
+    // so it needs no allocation once its arrays have grown to their steady size.
+    class CollisionSystem {
+        float cellSize = 8.0f; // The size of a grid cell (it should be close to the size of the common colliders)
+        int maxCellsPerCollider = 64; // The colliders covering more cells than this are tested against everything instead
+
+        // The data of each collider used during an update
+        struct Proxy {
+            collision::AABB start;  // The box at the start of the motion
+            glm::vec3 motion;       // The translation since the last update (zero if the collider is not swept)
+            collision::AABB bounds; // The box enclosing the whole motion
+            EntityHandle handle;
+            bool isStatic;
+            bool oversized; // True if it covers too many cells to be stored in the grid
+        };
+
+        std::vector<Proxy> proxies;
+        std::vector<std::uint32_t> bucketStart;   // The start of each bucket in "bucketEntries" (has an extra element at the end)
+        std::vector<std::uint32_t> bucketEntries; // The proxy indices sorted by bucket
+        std::vector<std::uint32_t> oversized;     // The proxies that were not stored in the grid
+        std::vector<std::uint32_t> visited;       // The last query in which each proxy was tested (to skip duplicates)
+        std::uint32_t query = 0;
+
+        std::vector<CollisionEvent> events;
+        std::vector<std::uint64_t> contacts, previousContacts; // The sorted keys of the touching pairs
+
+        CollisionStatistics statistics;
+
+        // Returns the range of cells overlapped by a box
+        void getCellRange(const collision::AABB& box, glm::ivec3& first, glm::ivec3& last) const;
+        // Returns the bucket of a cell
+        std::uint32_t getBucket(glm::ivec3 cell) const;
+        // Tests a pair of proxies and records an event if they collide
+        void testPair(std::uint32_t first, std::uint32_t second);
+        // Stores the proxies in the hash grid
+        void buildGrid();
+
+    public:
+        // Reads the grid parameters from the given json object ("cell-size" & "max-cells-per-collider")
+        void initialize(const nlohmann::json& config);
+
+        // This should be called every frame after the entities are moved to find the colliding pairs
+        void update(World* world);
+
+        // Returns the events generated by the last update
+        const std::vector<CollisionEvent>& getEvents() const { return events; }
+
+        const CollisionStatistics& getStatistics() const { return statistics; }
+    };
+
+}
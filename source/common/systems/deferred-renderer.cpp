@@ -0,0 +1,245 @@
+#include "deferred-renderer.hpp"
+#include "../mesh/mesh-utils.hpp"
+#include "../texture/texture-utils.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+namespace our {
+
+    // The handles of the uniforms of the light programs (see "deferred/light.frag")
+    namespace {
+        const UniformHandle GBUFFER_ALBEDO_UNIFORM = ShaderProgram::getUniformHandle("gbuffer_albedo");
+        const UniformHandle GBUFFER_SPECULAR_UNIFORM = ShaderProgram::getUniformHandle("gbuffer_specular");
+        const UniformHandle GBUFFER_NORMAL_UNIFORM = ShaderProgram::getUniformHandle("gbuffer_normal");
+        const UniformHandle GBUFFER_DEPTH_UNIFORM = ShaderProgram::getUniformHandle("gbuffer_depth");
+        const UniformHandle INVERSE_VP_UNIFORM = ShaderProgram::getUniformHandle("inverse_VP");
+        const UniformHandle VOLUME_LIGHTS_START_UNIFORM = ShaderProgram::getUniformHandle("volume_lights_start");
+    }
+
+    void DeferredRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json& config){
+        ForwardRenderer::initialize(windowSize, config);
+        nlohmann::json lighting = config.value("lighting", nlohmann::json::object());
+        threshold = lighting.value("threshold", threshold);
+
+        // The lights are added to the color target of the postprocessing (if there is one) so that it is applied to the lit image
+        // and the G-buffer depth is its depth target (so the postprocess passes can read it as "depth")
+        if(postprocess){
+            lightTarget = colorTarget;
+            gbufferDepthTarget = depthTarget;
+        } else {
+            lightTarget = texture_utils::empty(GL_RGBA8, windowSize);
+            gbufferDepthTarget = texture_utils::empty(GL_DEPTH_COMPONENT24, windowSize);
+            ownsTargets = true;
+        }
+
+        // Create the G-buffer: the albedo & the roughness, the specular & the ambient occlusion, the normal and the depth (created above)
+        // The 4th color attachment is the light target which receives the emissive & ambient light of the surfaces
+        albedoTarget = texture_utils::empty(GL_RGBA8, windowSize);
+        specularTarget = texture_utils::empty(GL_RGBA8, windowSize);
+        normalTarget = texture_utils::empty(GL_RGB10_A2, windowSize);
+        glGenFramebuffers(1, &gbufferFrameBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gbufferFrameBuffer);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTarget->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, specularTarget->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, normalTarget->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, lightTarget->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gbufferDepthTarget->getOpenGLName(), 0);
+        GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
+        glDrawBuffers(4, drawBuffers);
+
+        // The lighting pass draws to the light target and tests the light volumes against the depth of the G-buffer
+        glGenFramebuffers(1, &lightFrameBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, lightFrameBuffer);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightTarget->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gbufferDepthTarget->getOpenGLName(), 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        // The volume program is a variant of the directional program (so it is deleted with it)
+        directionalProgram = new ShaderProgram();
+        directionalProgram->attach("assets/shaders/deferred/light.vert", GL_VERTEX_SHADER);
+        directionalProgram->attach("assets/shaders/deferred/light.frag", GL_FRAGMENT_SHADER);
+        directionalProgram->link();
+        volumeProgram = directionalProgram->getVariant("VOLUME");
+        volumeMesh = mesh_utils::sphere(glm::ivec2(16, 16));
+        glGenVertexArrays(1, &fullscreenVertexArray);
+        volumeLightsBuffer = new UniformBuffer(sizeof(LightsBlock));
+    }
+
+    void DeferredRenderer::destroy(){
+        delete volumeLightsBuffer;
+        delete volumeMesh;
+        GLStateCache::forgetVertexArray(fullscreenVertexArray);
+        glDeleteVertexArrays(1, &fullscreenVertexArray);
+        delete directionalProgram;
+        // The variants are owned by their shaders (which may be deleted after the renderer)
+        gbufferVariants.clear();
+        glDeleteFramebuffers(1, &gbufferFrameBuffer);
+        glDeleteFramebuffers(1, &lightFrameBuffer);
+        delete albedoTarget;
+        delete specularTarget;
+        delete normalTarget;
+        if(ownsTargets){
+            delete lightTarget;
+            delete gbufferDepthTarget;
+        }
+        ForwardRenderer::destroy();
+    }
+
+    ShaderProgram* DeferredRenderer::getProgram(const Material* material) const {
+        if(geometryPass && material->shader->usesLights()){
+            if(ShaderProgram* variant = getGBufferVariant(material->shader)) return variant;
+        }
+        return ForwardRenderer::getProgram(material);
+    }
+
+    ShaderProgram* DeferredRenderer::getGBufferVariant(ShaderProgram* shader) const {
+        auto it = gbufferVariants.find(shader);
+        if(it == gbufferVariants.end()) it = gbufferVariants.emplace(shader, shader->getVariant("GBUFFER")).first;
+        return it->second;
+    }
+
+    void DeferredRenderer::drawLights(World* world, CameraComponent* camera, const glm::mat4& VP){
+        glm::mat4 inverseVP = glm::inverse(VP);
+        glm::vec3 eye = glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1));
+        frustum_culling::Frustum frustum = frustum_culling::extractFrustum(VP);
+
+        // The directional lights come first in the light table, then the point & spot lights that can reach the camera frustum
+        LightsBlock block{};
+        std::vector<Entity*> entities = lightedEntities(world);
+        for(Entity* entity : entities){
+            LightComponent* light = entity->getComponent<LightComponent>();
+            if(light->lightType != LightType::DIRECTIONAL || block.light_count == LightSelection::MAX_LIGHTS) continue;
+            block.lights[block.light_count++] = makeLightElement(entity, light);
+        }
+        GLint volumeLightsStart = block.light_count;
+        for(Entity* entity : entities){
+            LightComponent* light = entity->getComponent<LightComponent>();
+            if(light->lightType == LightType::DIRECTIONAL) continue;
+            LightBlockElement element = makeLightElement(entity, light);
+            float range = light->getInfluenceRadius(threshold);
+            // A light that is too weak to reach anything is skipped
+            if(!(range > 0.0f)) continue;
+            // A light whose range is infinite only has to cover the camera frustum
+            if(std::isinf(range)) range = glm::distance(eye, element.position) + camera->far;
+            if(!frustum_culling::intersects(frustum, element.position, range)) continue;
+            // The lights beyond the size of the table are not drawn
+            if(block.light_count == LightSelection::MAX_LIGHTS) break;
+            element.range = range;
+            block.lights[block.light_count++] = element;
+        }
+        GLsizei volumeCount = block.light_count - volumeLightsStart;
+        statistics.lightVolumes = volumeCount;
+        volumeLightsBuffer->update(&block, (GLsizeiptr)(offsetof(LightsBlock, lights) + block.light_count * sizeof(LightBlockElement)));
+        volumeLightsBuffer->bind(UNIFORM_BLOCK_LIGHTS);
+
+        // The G-buffer is read with texelFetch, so no sampler is bound
+        Texture2D* gbuffer[] = {albedoTarget, specularTarget, normalTarget, gbufferDepthTarget};
+        for(GLuint unit = 0; unit < 4; unit++){
+            GLStateCache::activeTexture(unit);
+            gbuffer[unit]->bind();
+            GLStateCache::bindSampler(unit, 0);
+        }
+
+        // The lights are added to the light target and don't change the depth
+        PipelineState lightState{};
+        lightState.blending.enabled = true;
+        lightState.blending.sourceFactor = GL_ONE;
+        lightState.blending.destinationFactor = GL_ONE;
+        lightState.depthMask = false;
+        auto setupProgram = [&](ShaderProgram* program){
+            program->use();
+            program->set(GBUFFER_ALBEDO_UNIFORM, (GLint)0);
+            program->set(GBUFFER_SPECULAR_UNIFORM, (GLint)1);
+            program->set(GBUFFER_NORMAL_UNIFORM, (GLint)2);
+            program->set(GBUFFER_DEPTH_UNIFORM, (GLint)3);
+            program->set(INVERSE_VP_UNIFORM, inverseVP);
+            program->set(VOLUME_LIGHTS_START_UNIFORM, volumeLightsStart);
+        };
+
+        // The directional lights cover every pixel, so they are drawn with one fullscreen triangle
+        if(volumeLightsStart > 0){
+            lightState.setup();
+            setupProgram(directionalProgram);
+            GLStateCache::bindVertexArray(fullscreenVertexArray);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            statistics.drawCalls++;
+        }
+
+        // Each point & spot light is drawn as a sphere around its influence volume (one instance per light).
+        // Only the back faces that are behind the surface are drawn, so the pixels in front of the volume are skipped and
+        // the volume still works if the camera is inside it. Depth clamping keeps the back faces beyond the far plane.
+        if(volumeCount > 0 && volumeProgram){
+            lightState.depthTesting.enabled = true;
+            lightState.depthTesting.function = GL_GEQUAL;
+            lightState.faceCulling.enabled = true;
+            lightState.faceCulling.culledFace = GL_FRONT;
+            lightState.setup();
+            GLStateCache::setEnabled(GL_DEPTH_CLAMP, true);
+            setupProgram(volumeProgram);
+            volumeMesh->drawCopies(volumeCount);
+            GLStateCache::setEnabled(GL_DEPTH_CLAMP, false);
+            statistics.drawCalls++;
+            statistics.instancedDrawCalls++;
+        }
+    }
+
+    void DeferredRenderer::render(World* world, JobSystem* jobs){
+        // First, we find the camera and prepare the commands (if there is no camera, we cannot render)
+        glm::mat4 VP;
+        CameraComponent* camera = prepareFrame(world, jobs, VP);
+        if(camera == nullptr) return;
+        glViewport(0, 0, windowSize[0], windowSize[1]);
+
+        // Remember the framebuffer we should output to (the default framebuffer or the offscreen one in headless mode)
+        GLint outputFrameBuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFrameBuffer);
+
+        uploadFrameData(world, camera, VP, jobs);
+
+        // The lit opaque commands go to the G-buffer (if their shader has a "GBUFFER" variant), the others are drawn forward
+        // Both lists keep the sorted order of the commands
+        deferredCommands.clear();
+        forwardCommands.clear();
+        for(const auto& command : opaqueCommands){
+            ShaderProgram* shader = command.material->shader;
+            if(shader->usesLights() && getGBufferVariant(shader))
+                deferredCommands.push_back(command);
+            else
+                forwardCommands.push_back(command);
+        }
+        statistics.deferredCommands = (int)deferredCommands.size();
+
+        // The geometry pass: the G-buffer & the light target are cleared to black (so the empty pixels get no light)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gbufferFrameBuffer);
+        GLStateCache::depthMask(true);
+        GLStateCache::colorMask(glm::bvec4(true, true, true, true));
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClearDepth(1.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // (with the depth pre-pass first if it is enabled)
+        geometryPass = true;
+        drawOpaqueCommands(deferredCommands, VP);
+        geometryPass = false;
+
+        // The lighting pass
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, lightFrameBuffer);
+        drawLights(world, camera, VP);
+
+        // Then the other opaque commands, the sky and the transparent commands are drawn forward on top of the lit surfaces
+        lightsBuffer->bind(UNIFORM_BLOCK_LIGHTS);
+        executeCommands(forwardCommands, VP);
+        drawSky(camera, VP);
+        executeCommands(transparentCommands, VP);
+
+        // Without postprocessing, the light target is copied to the output framebuffer
+        if(!postprocess){
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, lightFrameBuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFrameBuffer);
+            glBlitFramebuffer(0, 0, windowSize.x, windowSize.y, 0, 0, windowSize.x, windowSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFrameBuffer);
+        }
+        finishFrame(outputFrameBuffer);
+    }
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "forward-renderer.hpp"
+
+#include <string>
+#include <unordered_map>
+
+namespace our
+{
+
+    // A deferred renderer draws the opaque lit objects in two passes:
+    // - The geometry pass draws their surface data (albedo, specular, roughness, normal & depth) to the G-buffer using the
+    //   "GBUFFER" variant of their shader (see "lighting.frag"). That variant also writes their emissive & ambient light
+    //   to the light accumulation target.
+    // - The lighting pass adds the light of each light to the accumulation target: the directional lights are drawn with one
+    //   fullscreen triangle and each point & spot light is drawn as a sphere around its influence volume (see "deferred/light.*").
+    // So the cost of the lights depends on the pixels they cover instead of the number of lit objects times the number of lights.
+    // The other commands (unlit or transparent) and the sky are then drawn forward on top using the depth of the G-buffer.
+    //
+    // The config is the same as the forward renderer. "threshold" in the "lighting" object sets the light contribution below
+    // which a light is ignored, which gives the radius of the light volumes (see "LightComponent::getInfluenceRadius") (default: 1/256)
+    class DeferredRenderer : public ForwardRenderer {
+        // The G-buffer targets and the framebuffer of the geometry pass
+        Texture2D *albedoTarget = nullptr, *specularTarget = nullptr, *normalTarget = nullptr, *gbufferDepthTarget = nullptr;
+        GLuint gbufferFrameBuffer = 0;
+        // The target to which the lights are added and the framebuffer of the lighting pass (which uses the depth of the G-buffer)
+        // If there is postprocessing, the light target & the G-buffer depth are the targets of the forward renderer (not owned here)
+        Texture2D* lightTarget = nullptr;
+        bool ownsTargets = false;
+        GLuint lightFrameBuffer = 0;
+        // The programs that draw the directional lights (fullscreen) and the point & spot lights (volumes)
+        ShaderProgram *directionalProgram = nullptr, *volumeProgram = nullptr;
+        Mesh* volumeMesh = nullptr;
+        GLuint fullscreenVertexArray = 0;
+        // The light table of the lighting pass: the directional lights, then the lights drawn as volumes
+        UniformBuffer* volumeLightsBuffer = nullptr;
+        float threshold = 1.0f / 256.0f;
+        // The opaque commands that are drawn to the G-buffer and the ones drawn forward (kept here to reuse their memory)
+        std::vector<RenderCommand> deferredCommands, forwardCommands;
+        // True while the G-buffer is drawn (then "getProgram" returns the "GBUFFER" variants)
+        bool geometryPass = false;
+        // The "GBUFFER" variant of each lit shader (nullptr if it failed to compile), resolved once instead of searching
+        // the variants of the shader by name for every command
+        mutable std::unordered_map<const ShaderProgram*, ShaderProgram*> gbufferVariants;
+
+        // Returns the "GBUFFER" variant of the given lit shader (or nullptr if it has none)
+        ShaderProgram* getGBufferVariant(ShaderProgram* shader) const;
+
+        // Fills the light table with the lights that can reach the camera frustum and adds their light to the accumulation target
+        void drawLights(World* world, CameraComponent* camera, const glm::mat4& VP);
+
+    public:
+        void initialize(glm::ivec2 windowSize, const nlohmann::json& config) override;
+        void destroy() override;
+        void render(World* world, JobSystem* jobs = nullptr) override;
+        // During the geometry pass, returns the "GBUFFER" variant of the lit shaders
+        ShaderProgram* getProgram(const Material* material) const override;
+    };
+
+    // This function returns a new renderer of the type given by "type" in the renderer config
+    // ("forward" which is the default or "deferred")
+    inline ForwardRenderer* createRendererFromConfig(const nlohmann::json& config){
+        std::string type = config.is_object() ? config.value("type", std::string("forward")) : std::string("forward");
+        if(type == "deferred") return new DeferredRenderer();
+        return new ForwardRenderer();
+    }
+
+}
@@ -6,15 +6,62 @@
 #include <vector>
 #include <glm/gtx/euler_angles.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <string>
 #include <iostream>
+#include <imgui.h>
 using namespace std;
 
 namespace our {
 
+    // The handles of the uniforms set by the renderer
+    // They are resolved once and work with any shader program (see "UniformHandle" in "shader.hpp")
+    namespace {
+        const UniformHandle M_UNIFORM = ShaderProgram::getUniformHandle("M");
+        const UniformHandle MIT_UNIFORM = ShaderProgram::getUniformHandle("MIT");
+        const UniformHandle TRANSFORM_UNIFORM = ShaderProgram::getUniformHandle("transform");
+        const UniformHandle DRAW_LIGHTS_UNIFORM = ShaderProgram::getUniformHandle("draw_lights");
+    }
+
     void ForwardRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json& config){
         // First, we store the window size for later use
         this->windowSize = windowSize;
+        // Check if the statistics should be shown
+        this->showStatistics = config.value("statistics", false);
+        // Check if the commands that share the mesh and the material should be drawn with instancing
+        this->instancing = config.value("instancing", true);
+        // Check if the commands outside the camera frustum should be skipped
+        this->culling = config.value("culling", true);
+        // Check if the commands should be built on the workers of the job system
+        this->parallel = config.value("parallel", true);
+        glGenBuffers(1, &instanceBuffer);
+        // Check if the depth of the lit opaque objects should be drawn first (so the lighting only runs for the visible fragments)
+        if(config.value("depth-prepass", false)){
+            depthProgram = new ShaderProgram();
+            depthProgram->attach("assets/shaders/depth.vert", GL_VERTEX_SHADER);
+            depthProgram->attach("assets/shaders/depth.frag", GL_FRAGMENT_SHADER);
+            depthProgram->link();
+        }
+        // The GPU time of the opaque pass (and of the depth pre-pass) is measured when the statistics are shown
+        prepassTimer.initialize();
+        opaqueTimer.initialize();
+
+        // Create the uniform buffers that will hold the per-frame data
+        cameraBuffer = new UniformBuffer(sizeof(CameraBlock));
+        lightsBuffer = new UniformBuffer(sizeof(LightsBlock));
+        skyBuffer = new UniformBuffer(sizeof(SkyBlock));
+
+        // Check if the point & spot lights should be assigned to clusters (which lifts the limit of MAX_LIGHTS lights)
+        nlohmann::json lighting = config.value("lighting", nlohmann::json::object());
+        if(lighting.value("clustered", false)){
+            clusters = new LightClusters();
+            clusters->initialize(lighting);
+        } else if(lighting.contains("lights-per-draw")){
+            // Otherwise, check if each draw should only get the lights that matter the most to it
+            selection = new LightSelection();
+            selection->initialize(lighting);
+        }
 
         // Then we check if there is a sky texture in the configuration
         if(config.contains("sky")){
@@ -79,34 +126,33 @@ namespace our {
 
             // //TODO: (Req 10) Unbind the framebuffer just to be safe
             glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-            // // Create a vertex array to use for drawing the texture
-            glGenVertexArrays(1, &postProcessVertexArray);
-
-            // Create a sampler to use for sampling the scene texture in the post processing shader
-            Sampler* postprocessSampler = new Sampler();
-            postprocessSampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            postprocessSampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            // Create the post processing shader
-            ShaderProgram* postprocessShader = new ShaderProgram();
-            postprocessShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
-            postprocessShader->attach(config.value<std::string>("postprocess", ""), GL_FRAGMENT_SHADER);
-            postprocessShader->link();
-
-            // Create a post processing material
-            postprocessMaterial = new TexturedMaterial();
-            postprocessMaterial->shader = postprocessShader;
-            postprocessMaterial->texture = colorTarget;
-            postprocessMaterial->sampler = postprocessSampler;
-            // The default options are fine but we don't need to interact with the depth buffer
-            // so it is more performant to disable the depth mask
-            postprocessMaterial->pipelineState.depthMask = false;
+
+            // Create the pass graph which reads the scene targets (the config is either one shader or a list of passes)
+            postprocess = new PostprocessGraph();
+            postprocess->initialize(windowSize, config["postprocess"]);
         }
     }
 
     void ForwardRenderer::destroy(){
+        // Delete the per-frame uniform buffers
+        delete cameraBuffer;
+        delete lightsBuffer;
+        delete skyBuffer;
+        cameraBuffer = lightsBuffer = skyBuffer = nullptr;
+        if(clusters){
+            clusters->destroy();
+            delete clusters;
+            clusters = nullptr;
+        }
+        delete selection;
+        selection = nullptr;
+        // Delete the instance buffer
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+        delete depthProgram;
+        depthProgram = nullptr;
+        prepassTimer.destroy();
+        opaqueTimer.destroy();
         // Delete all objects related to the sky
         if(skyMaterial){
             delete skySphere;
@@ -116,29 +162,41 @@ namespace our {
             delete skyMaterial;
         }
         // Delete all objects related to post processing
-        if(postprocessMaterial){
+        if(postprocess){
             glDeleteFramebuffers(1, &postprocessFrameBuffer);
-            glDeleteVertexArrays(1, &postProcessVertexArray);
             delete colorTarget;
             delete depthTarget;
-            delete postprocessMaterial->sampler;
-            delete postprocessMaterial->shader;
-            delete postprocessMaterial;
+            postprocess->destroy();
+            delete postprocess;
+            postprocess = nullptr;
         }
     }
 
 
 
+    LightBlockElement ForwardRenderer::makeLightElement(Entity* entity, const LightComponent* light)
+    {
+        LightBlockElement element{};
+        element.type = (GLint)light->lightType;
+        element.diffuse = light->diffuse;
+        element.specular = light->specular;
+        element.attenuation = light->attenuation;
+        element.cone_angles = glm::vec2(glm::radians(light->cone_angles.x), glm::radians(light->cone_angles.y));
+        // The light is placed by the world matrix of its entity (so a light can be the child of another entity, e.g. a lamp post)
+        // "position" is an offset in world units and "direction" is a rotation relative to the entity
+        const glm::mat4& localToWorld = entity->getLocalToWorldMatrix();
+        element.position = glm::vec3(localToWorld[3]) + light->position;
+        glm::vec4 direction = glm::yawPitchRoll(light->direction[1], light->direction[0], light->direction[2]) * glm::vec4(0, -1, 0, 0);
+        element.direction = glm::normalize(glm::vec3(localToWorld * direction));
+        return element;
+    }
+
    std::vector<Entity *> ForwardRenderer::lightedEntities(World *world)
     {
         std::vector<Entity *> lEntities;
-        for (auto entity : world->getEntities())
-        {
-            if (auto lEntity = entity->getComponent<LightComponent>(); lEntity)
-            {
-                lEntities.push_back(entity);
-            }
-        }
+        world->view<LightComponent>().each([&](Entity* entity, LightComponent&){
+            lEntities.push_back(entity);
+        });
 
         return lEntities;
     }
@@ -146,55 +204,264 @@ namespace our {
 
 
 
-    void ForwardRenderer::lightSetup(std::vector<Entity *> entities, ShaderProgram *program)
+    void ForwardRenderer::lightSetup(const std::vector<Entity *>& entities, CameraComponent* camera, JobSystem* jobs)
     {
-        program->set("light_count", (int)entities.size());
-        for (int i = 0; i < (int)entities.size(); i++)
+        LightsBlock block{};
+        lightInfluences.clear();
+        for (Entity* entity : entities)
         {
-            LightComponent *light = entities[i]->getComponent<LightComponent>();
-            program->set("lights[" + std::to_string(i) + "].type", (int)light->lightType);
-            program->set("lights[" + std::to_string(i) + "].diffuse", light->diffuse);
-            program->set("lights[" + std::to_string(i) + "].specular", light->specular);
-            program->set("lights[" + std::to_string(i) + "].attenuation", light->attenuation);
-            program->set("lights[" + std::to_string(i) + "].cone_angles", glm::vec2(glm::radians(light->cone_angles.x), glm::radians(light->cone_angles.y)));
-            program->set("lights[" + std::to_string(i) + "].position", entities[i]->localTransform.position+light->position);
-            glm::vec3 rotation = entities[i]->localTransform.rotation;
-            program->set("lights[" + std::to_string(i) + "].direction", (glm::vec3)(glm::yawPitchRoll(rotation[1]+light->direction[1], rotation[0]+light->direction[0], rotation[2]+light->direction[2]) * (glm::vec4(0, -1, 0, 0))));
-
+            LightComponent *light = entity->getComponent<LightComponent>();
+            LightBlockElement element = makeLightElement(entity, light);
+            if (clusters && light->lightType != LightType::DIRECTIONAL)
+            {
+                lightInfluences.push_back({element, light->getInfluenceRadius(clusters->getThreshold())});
+            }
+            else if (selection)
+            {
+                lightInfluences.push_back({element, light->getInfluenceRadius(selection->getThreshold())});
+            }
+            else if (block.light_count < MAX_LIGHTS)
+            {
+                // The shader cannot receive more than MAX_LIGHTS lights in the uniform buffer
+                block.lights[block.light_count++] = element;
+            }
         }
+        if (selection && camera)
+        {
+            // Only the lights that can reach the camera frustum are kept in the uniform buffer
+            selection->setLights(lightInfluences, frustum_culling::extractFrustum(camera->getProjectionMatrix(windowSize) * camera->getViewMatrix()));
+            const std::vector<LightBlockElement>& table = selection->getLights();
+            block.light_count = (GLint)table.size();
+            std::copy(table.begin(), table.end(), block.lights);
+        }
+        // Only the used part of the block is uploaded
+        frameLightCount = block.light_count;
+        lightsBuffer->update(&block, (GLsizeiptr)(offsetof(LightsBlock, lights) + block.light_count * sizeof(LightBlockElement)));
+        if (!clusters || !camera) return;
+
+        // The slices end at the camera far plane and start at its near plane (which must not be 0 since the slices are logarithmic)
+        clusters->assign(lightInfluences, camera->getViewMatrix(), camera->getProjectionMatrix(windowSize),
+            std::max(camera->near, 1e-3f), camera->far, windowSize, jobs);
+        clusters->upload();
+        clusters->bind();
+        statistics.lightClusters = clusters->getStatistics();
     }
 
+    ShaderProgram* ForwardRenderer::getProgram(const Material* material) const
+    {
+        if (clusters && material->shader->usesLights())
+        {
+            // If the clustered variant fails to compile, the material is drawn with the directional lights only
+            if (ShaderProgram* variant = material->shader->getVariant("CLUSTERED")) return variant;
+        }
+        else if (selection && material->shader->usesLights())
+        {
+            // If the variant fails to compile, the material is drawn with the first MAX_LIGHTS lights of the light table
+            if (ShaderProgram* variant = material->shader->getVariant(selection->getDefine())) return variant;
+        }
+        return material->shader;
+    }
 
- void ForwardRenderer::executeCommands(std::vector<RenderCommand> commands,glm::mat4 VP,std::vector<Entity *> lightEntities,glm::vec3 eye)
+    void ForwardRenderer::buildCommands(size_t begin, size_t end, RenderCommandList& list, const frustum_culling::Frustum& frustum,
+                                        glm::vec3 eye, glm::vec3 forward, float farPlane) const
     {
-        for (RenderCommand command : commands)
+        list.opaque.clear();
+        list.transparent.clear();
+        // Skip the commands whose bounding sphere is outside the camera frustum
+        list.visibility.resize(end - begin);
+        if (culling)
+            frustum_culling::cull(frustum, renderList.getSpheres(), begin, end, list.visibility.data());
+        else
+            std::fill(list.visibility.begin(), list.visibility.end(), 1);
+        const std::vector<RenderCommand>& commands = renderList.getCommands();
+        for (size_t index = begin; index < end; index++)
         {
-            ShaderProgram *program = command.material->shader;
-            Mesh *mesh = command.mesh;
-            command.material->setup();
+            if (!list.visibility[index - begin]) continue;
+            RenderCommand command = commands[index];
+            // The opaque commands are grouped by state (then drawn front to back)
+            // and the transparent commands are drawn back to front (far should be drawn before near)
+            render_queue::Pass pass = command.material->transparent ? render_queue::Pass::TRANSPARENT_COMMANDS : render_queue::Pass::OPAQUE_COMMANDS;
+            float depth = glm::dot(command.center - eye, forward) / farPlane;
+            command.sortKey = render_queue::makeKey(pass, command.material->shader, command.material->pipelineState, command.material, command.mesh, depth);
+            if (command.material->transparent)
+                list.transparent.push_back(command);
+            else
+                list.opaque.push_back(command);
+        }
+    }
 
-            program->set("eye", eye);
-            program->set("M", command.localToWorld);
-            program->set("MIT", glm::transpose(glm::inverse(command.localToWorld)));
-            program->set("VP", VP);
+    void ForwardRenderer::prepareCommands(World* world, CameraComponent* camera, const glm::mat4& VP, JobSystem* jobs)
+    {
+        // Only the commands of the mesh renderers that changed since the last frame are rebuilt
+        JobSystem* workers = parallel ? jobs : nullptr;
+        renderList.update(world, workers);
+        statistics.renderList = renderList.getStatistics();
+        if (commandsPrepared && renderList.getVersion() == preparedVersion && VP == preparedVP) return;
 
-            ForwardRenderer::lightSetup(lightEntities, program);
+        //TODO: (Req 8) Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
+        // HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
+        our::Entity* cameraOwner= camera->getOwner();
+        glm::mat4 cameraMatrix = cameraOwner->getLocalToWorldMatrix();
+        glm::vec3 cameraPosition = glm::vec3(cameraMatrix * glm::vec4(0, 0, 0, 1));
+        glm::vec3 cameraForward = glm::normalize(glm::vec3(cameraMatrix * glm::vec4(0, 0, -1, 0)));
+        frustum_culling::Frustum frustum = frustum_culling::extractFrustum(VP);
+
+        // Each range of the render list is culled into its own list
+        size_t count = renderList.size();
+        size_t listCount = (count + COMMAND_BATCH_SIZE - 1) / COMMAND_BATCH_SIZE;
+        if (commandLists.size() < listCount) commandLists.resize(listCount);
+        auto build = [&](size_t begin, size_t end){
+            buildCommands(begin, end, commandLists[begin / COMMAND_BATCH_SIZE], frustum, cameraPosition, cameraForward, camera->far);
+        };
+        if (workers)
+        {
+            workers->parallelFor(count, COMMAND_BATCH_SIZE, build);
+        }
+        else
+        {
+            for (size_t begin = 0; begin < count; begin += COMMAND_BATCH_SIZE)
+                build(begin, std::min(count, begin + COMMAND_BATCH_SIZE));
+        }
 
+        // Merge the lists in the order of the ranges (so the commands are in the same order as if they were culled serially)
+        size_t opaqueCount = 0, transparentCount = 0;
+        for (size_t index = 0; index < listCount; index++)
+        {
+            opaqueCount += commandLists[index].opaque.size();
+            transparentCount += commandLists[index].transparent.size();
+        }
+        opaqueCommands.clear();
+        transparentCommands.clear();
+        opaqueCommands.reserve(opaqueCount);
+        transparentCommands.reserve(transparentCount);
+        for (size_t index = 0; index < listCount; index++)
+        {
+            const RenderCommandList& list = commandLists[index];
+            opaqueCommands.insert(opaqueCommands.end(), list.opaque.begin(), list.opaque.end());
+            transparentCommands.insert(transparentCommands.end(), list.transparent.begin(), list.transparent.end());
+        }
 
-            program->set("sky.top", this->sky_top);
-            program->set("sky.middle",  this->sky_middle);
-            program->set("sky.bottom",  this->sky_bottom);
+        sortCommands(opaqueCommands);
+        sortCommands(transparentCommands);
+        preparedVersion = renderList.getVersion();
+        preparedVP = VP;
+        commandsPrepared = true;
+    }
 
-            program->set("transform", VP * command.localToWorld);
-            mesh->draw();
-        }
+    void ForwardRenderer::sortCommands(std::vector<RenderCommand>& commands)
+    {
+        sortEntries.clear();
+        for (std::uint32_t index = 0; index < (std::uint32_t)commands.size(); index++)
+            sortEntries.push_back({commands[index].sortKey, index});
+        render_queue::sort(sortEntries, sortScratch);
+        // Reorder the commands to follow the sorted entries
+        sortedCommands.clear();
+        for (const auto& entry : sortEntries)
+            sortedCommands.push_back(commands[entry.index]);
+        commands.swap(sortedCommands);
     }
 
+    void ForwardRenderer::executeCommands(const std::vector<RenderCommand>& commands, const glm::mat4& VP)
+    {
+        // First, we split the commands into batches of consecutive commands that share the mesh and the material
+        // (since the commands are sorted by material then mesh, such commands are next to each other)
+        // The batches that can be instanced get their instance data packed into "instanceData"
+        batches.clear();
+        instanceData.clear();
+        for (size_t first = 0; first < commands.size();)
+        {
+            size_t last = first + 1;
+            while (last < commands.size() && commands[last].mesh == commands[first].mesh && commands[last].material == commands[first].material)
+                last++;
+            DrawBatch batch{first, last - first, nullptr, 0};
+            if (instancing && batch.count >= MIN_INSTANCED_BATCH)
+                batch.instancedProgram = getProgram(commands[first].material)->getInstancedVariant();
+            if (batch.instancedProgram)
+            {
+                batch.instanceOffset = instanceData.size();
+                for (size_t index = first; index < last; index++)
+                    instanceData.push_back({commands[index].localToWorld, commands[index].localToWorldInverseTranspose, commands[index].lights});
+            }
+            batches.push_back(batch);
+            first = last;
+        }
 
+        // Then, we stream the instance data to the instance buffer
+        uploadInstanceData();
 
+        // These track the state set by the previous batch to count the state switches
+        // and to skip setting up the material when consecutive batches share it
+        const Material* lastMaterial = nullptr;
+        const ShaderProgram* lastProgram = nullptr;
+        const Mesh* lastMesh = nullptr;
+        Texture2D* boundTextures[Material::MAX_TEXTURE_UNITS] = {};
 
+        // The camera, lights and sky data are read from the uniform buffers bound in "render"
+        // so we only send the per-object matrices here
+        for (const DrawBatch& batch : batches)
+        {
+            Material *material = commands[batch.first].material;
+            Mesh *mesh = commands[batch.first].mesh;
+            ShaderProgram *program = batch.instancedProgram ? batch.instancedProgram : getProgram(material);
+            if (material != lastMaterial || program != lastProgram)
+            {
+                if (program != lastProgram) statistics.programSwitches++;
+                for (GLuint unit = 0; unit < Material::MAX_TEXTURE_UNITS; unit++)
+                {
+                    Texture2D* texture = material->getTexture(unit);
+                    if (texture && texture != boundTextures[unit])
+                    {
+                        statistics.textureSwitches++;
+                        boundTextures[unit] = texture;
+                    }
+                }
+                material->setup(program);
+                if (depthEqualPass && isDepthPrepassed(material))
+                {
+                    // The depth pre-pass already wrote the depth of the visible fragments, so only these pass and the depth is kept
+                    GLStateCache::depthFunc(GL_EQUAL);
+                    GLStateCache::depthMask(false);
+                }
+                // The clustered programs read the lights from the buffer textures bound by "lightSetup"
+                if (clusters && program != lastProgram) LightClusters::setupProgram(program);
+                lastMaterial = material;
+                lastProgram = program;
+            }
+            if (mesh != lastMesh) statistics.vertexArraySwitches++;
+            lastMesh = mesh;
+            if (program->usesLights())
+            {
+                // Count the lights walked by each lit command (the selected ones or all the lights of the uniform buffer)
+                statistics.litCommands += (int)batch.count;
+                for (size_t index = batch.first; index < batch.first + batch.count; index++)
+                    statistics.commandLights += selection ? LightSelection::countLights(commands[index].lights) : std::min(frameLightCount, MAX_LIGHTS);
+            }
 
+            if (batch.instancedProgram)
+            {
+                // All the commands of the batch are drawn at once, each instance reading its matrices from the instance buffer
+                mesh->drawInstanced((GLsizei)batch.count, instanceBuffer, (GLintptr)(batch.instanceOffset * sizeof(InstanceData)));
+                statistics.drawCalls++;
+                statistics.instancedDrawCalls++;
+                continue;
+            }
 
+            for (size_t index = batch.first; index < batch.first + batch.count; index++)
+            {
+                const RenderCommand& command = commands[index];
+                if(program->getUniformLocation(M_UNIFORM) >= 0)
+                    program->set(M_UNIFORM, command.localToWorld);
+                if(program->getUniformLocation(MIT_UNIFORM) >= 0)
+                    program->set(MIT_UNIFORM, command.localToWorldInverseTranspose);
+                if(program->getUniformLocation(TRANSFORM_UNIFORM) >= 0)
+                    program->set(TRANSFORM_UNIFORM, VP * command.localToWorld);
+                if(program->getUniformLocation(DRAW_LIGHTS_UNIFORM) >= 0)
+                    program->set(DRAW_LIGHTS_UNIFORM, command.lights);
+                mesh->draw();
+                statistics.drawCalls++;
+            }
+        }
+    }
 
 
 
@@ -205,94 +472,207 @@ namespace our {
 
 
 
-    void ForwardRenderer::render(World* world){
-        // First of all, we search for a camera and for all the mesh renderers
-        CameraComponent* camera = nullptr;
-        opaqueCommands.clear();
-        transparentCommands.clear();
-        for(auto entity : world->getEntities()){
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if(!camera) camera = entity->getComponent<CameraComponent>();
-            // If this entity has a mesh renderer component
-            if(auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer){
-                // We construct a command from it
-                RenderCommand command;
-                command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
-                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-                command.mesh = meshRenderer->mesh;
-                command.material = meshRenderer->material;
-                // if it is transparent, we add it to the transparent commands list
-                if(command.material->transparent){
-                    transparentCommands.push_back(command);
-                } else {
-                // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
-                }
-            }
-        }
 
-        // If there is no camera, we return (we cannot render without a camera)
-        if(camera == nullptr) return;
 
-        //TODO: (Req 8) Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
-        // HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
-                our::Entity* cameraOwner= camera->getOwner();
-        glm::vec3 cameraForward = cameraOwner->getLocalToWorldMatrix()*glm::vec4(0,0,-1,1);
-        // glm::vec3 cameraForward = glm::vec3(camera->getViewMatrix()[0][2],camera->getViewMatrix()[1][2],camera->getViewMatrix()[2][2]);
 
-        std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand& first, const RenderCommand& second){
-            //TODO: (Req 8) Finish this function
-            // HINT: the following return should return true "first" should be drawn before "second". 
 
-            // what i did is measuring the distance from origin "cam pos" and see which is more far to be drawn first
-            // far should be drawn before near
-            return glm::dot(first.center, cameraForward)<glm::dot(second.center, cameraForward);
-        });
 
-        //TODO: (Req 8) Get the camera ViewProjection matrix and store it in VP
-        glm::mat4 VP =  camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
 
-        //TODO: (Req 8) Set the OpenGL viewport using windowSize
-        // making the x,y of glViewport equal to the width and height of the window to take
-        // the whole space of the window
-        glViewport(0,0,windowSize[0],windowSize[1]);
+    void ForwardRenderer::drawStatisticsGui() const {
+        if(!showStatistics) return;
+        ImGui::Begin("Renderer");
+        ImGui::Text("Commands (visible/culled): %d/%d", statistics.visibleCommands, statistics.culledCommands);
+        ImGui::Text("Command time: %.3f ms", 1000.0 * statistics.commandTime);
+        ImGui::Text("Retained commands: %d (added: %d, updated: %d, removed: %d)", statistics.renderList.entries,
+            statistics.renderList.addedEntries, statistics.renderList.updatedEntries, statistics.renderList.removedEntries);
+        if(clusters){
+            ImGui::Text("Clustered lights: %d (assigned: %d, max per cluster: %d, dropped: %d)", statistics.lightClusters.lights,
+                statistics.lightClusters.assignedLights, statistics.lightClusters.maxClusterLights, statistics.lightClusters.droppedLights);
+            ImGui::Text("Light assignment time: %.3f ms", 1000.0 * statistics.lightClusters.assignTime);
+        }
+        if(selection){
+            ImGui::Text("Light table: %d (dropped: %d), selection time: %.3f ms", statistics.lightSelection.lights,
+                statistics.lightSelection.droppedLights, 1000.0 * statistics.lightSelection.selectTime);
+        }
+        if(postprocess){
+            const PostprocessGraphStatistics& graph = postprocess->getStatistics();
+            ImGui::Text("Postprocess passes: %d (culled: %d), targets: %d for %d resources", graph.passes, graph.culledPasses,
+                graph.targets, graph.resources);
+        }
+        if(depthProgram){
+            ImGui::Text("Depth pre-pass commands: %d", statistics.prepassCommands);
+        }
+        ImGui::Text("Opaque GPU time: %.3f ms (depth pre-pass: %.3f ms, total: %.3f ms)", statistics.opaqueGpuTime,
+            statistics.prepassGpuTime, statistics.opaqueGpuTime + statistics.prepassGpuTime);
+        if(statistics.deferredCommands > 0 || statistics.lightVolumes > 0){
+            ImGui::Text("Deferred commands: %d, light volumes: %d", statistics.deferredCommands, statistics.lightVolumes);
+        }
+        ImGui::Text("Lights per lit command: %.2f (lit commands: %d)",
+            statistics.litCommands > 0 ? (double)statistics.commandLights / statistics.litCommands : 0.0, statistics.litCommands);
+        ImGui::Text("Draw calls: %d (instanced: %d)", statistics.drawCalls, statistics.instancedDrawCalls);
+        ImGui::Text("Program switches: %d", statistics.programSwitches);
+        ImGui::Text("Texture switches: %d", statistics.textureSwitches);
+        ImGui::Text("Vertex array switches: %d", statistics.vertexArraySwitches);
+        ImGui::Text("State calls (issued/elided): %d/%d", statistics.issuedStateCalls, statistics.elidedStateCalls);
+        ImGui::End();
+    }
 
-        //TODO: (Req 8) Set the clear color to black and the clear depth to 1
-        glClearColor(0.0,0.0,0.0,1.0);
-        glClearDepth(1.0);
-        //TODO: (Req 8) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
-        glDepthMask(true);
-        glColorMask(true,true,true,true);
-        
+    void ForwardRenderer::uploadInstanceData()
+    {
+        // Orphan the old storage of the instance buffer so we don't wait for the draws that use it
+        if (instanceData.empty()) return;
+        GLsizeiptr size = (GLsizeiptr)(instanceData.size() * sizeof(InstanceData));
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, instanceData.data());
+    }
 
-        // If there is a postprocess material, bind the framebuffer
-        if(postprocessMaterial){
-            //TODO: (Req 10) bind the framebuffer
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER,this->postprocessFrameBuffer);
-        }
+    bool ForwardRenderer::isDepthPrepassed(const Material* material) const
+    {
+        // Only the lit shaders are pre-passed since "depth.vert" computes the position exactly like "lighting.vert"
+        // (another vertex shader could compute a slightly different depth which would fail the GL_EQUAL test)
+        return depthProgram && !material->transparent && material->pipelineState.depthTesting.enabled && material->shader->usesLights();
+    }
 
-        //TODO: (Req 8) Clear the color and depth buffers
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    void ForwardRenderer::drawDepthPrepass(const std::vector<RenderCommand>& commands)
+    {
+        // The commands are batched like in "executeCommands" (but only the pre-passed ones are kept)
+        ShaderProgram* instancedProgram = instancing ? depthProgram->getInstancedVariant() : nullptr;
+        batches.clear();
+        instanceData.clear();
+        for (size_t first = 0; first < commands.size();)
+        {
+            size_t last = first + 1;
+            while (last < commands.size() && commands[last].mesh == commands[first].mesh && commands[last].material == commands[first].material)
+                last++;
+            if (isDepthPrepassed(commands[first].material))
+            {
+                DrawBatch batch{first, last - first, nullptr, 0};
+                if (instancedProgram && batch.count >= MIN_INSTANCED_BATCH)
+                {
+                    batch.instancedProgram = instancedProgram;
+                    batch.instanceOffset = instanceData.size();
+                    for (size_t index = first; index < last; index++)
+                        instanceData.push_back({commands[index].localToWorld, commands[index].localToWorldInverseTranspose, commands[index].lights});
+                }
+                batches.push_back(batch);
+                statistics.prepassCommands += (int)batch.count;
+            }
+            first = last;
+        }
+        uploadInstanceData();
 
+        const Material* lastMaterial = nullptr;
+        const ShaderProgram* lastProgram = nullptr;
+        const Mesh* lastMesh = nullptr;
+        for (const DrawBatch& batch : batches)
+        {
+            Material *material = commands[batch.first].material;
+            Mesh *mesh = commands[batch.first].mesh;
+            ShaderProgram *program = batch.instancedProgram ? batch.instancedProgram : depthProgram;
+            if (material != lastMaterial)
+            {
+                // Keep the depth test & the face culling of the material but only write the depth
+                PipelineState state = material->pipelineState;
+                state.blending.enabled = false;
+                state.colorMask = glm::bvec4(false, false, false, false);
+                state.depthMask = true;
+                state.setup();
+                lastMaterial = material;
+            }
+            if (program != lastProgram)
+            {
+                program->use();
+                statistics.programSwitches++;
+                lastProgram = program;
+            }
+            if (mesh != lastMesh) statistics.vertexArraySwitches++;
+            lastMesh = mesh;
 
+            if (batch.instancedProgram)
+            {
+                mesh->drawInstanced((GLsizei)batch.count, instanceBuffer, (GLintptr)(batch.instanceOffset * sizeof(InstanceData)));
+                statistics.drawCalls++;
+                statistics.instancedDrawCalls++;
+                continue;
+            }
+            for (size_t index = batch.first; index < batch.first + batch.count; index++)
+            {
+                program->set(M_UNIFORM, commands[index].localToWorld);
+                mesh->draw();
+                statistics.drawCalls++;
+            }
+        }
+    }
 
+    void ForwardRenderer::drawOpaqueCommands(const std::vector<RenderCommand>& commands, const glm::mat4& VP)
+    {
+        if (showStatistics && depthProgram) prepassTimer.begin();
+        if (depthProgram) drawDepthPrepass(commands);
+        if (showStatistics && depthProgram) prepassTimer.end();
+        if (showStatistics) opaqueTimer.begin();
+        depthEqualPass = depthProgram != nullptr;
+        executeCommands(commands, VP);
+        depthEqualPass = false;
+        if (showStatistics) opaqueTimer.end();
+        statistics.prepassGpuTime = depthProgram ? prepassTimer.getMilliseconds() : 0.0;
+        statistics.opaqueGpuTime = opaqueTimer.getMilliseconds();
+    }
 
+    CameraComponent* ForwardRenderer::prepareFrame(World* world, JobSystem* jobs, glm::mat4& VP){
+        // First of all, we search for a camera
+        CameraComponent* camera = nullptr;
+        statistics = RenderStatistics();
+        // Bring the cached matrices of the entities up to date (only the moved entities and their children are recomputed)
+        world->updateTransforms();
+        // We use the first camera we find
+        world->view<CameraComponent>().each([&](Entity*, CameraComponent& foundCamera){
+            if(!camera) camera = &foundCamera;
+        });
 
+        // If there is no camera, we return (we cannot render without a camera)
+        if(camera == nullptr) return nullptr;
 
-        
-        //TODO: (Req 8) Draw all the opaque commands
-        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
+        //TODO: (Req 8) Get the camera ViewProjection matrix and store it in VP
+        VP =  camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
+
+        // Then we construct, cull and sort the commands of the mesh renderers (on the workers of the job system if there is one)
+        auto commandStart = std::chrono::steady_clock::now();
+        prepareCommands(world, camera, VP, jobs);
+        statistics.visibleCommands = (int)(opaqueCommands.size() + transparentCommands.size());
+        statistics.culledCommands = (int)renderList.size() - statistics.visibleCommands;
+        statistics.commandTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - commandStart).count();
+        GLStateCache::resetStatistics();
+        return camera;
+    }
 
+    void ForwardRenderer::uploadFrameData(World* world, CameraComponent* camera, const glm::mat4& VP, JobSystem* jobs){
         std::vector<Entity *> lightEntities = lightedEntities(world);
         glm::vec3 eye = glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(glm::vec3(0, 0, 0), 1.0f)); 
 
+        // Fill the per-frame uniform buffers once and bind them for all the draws in this frame
+        CameraBlock cameraBlock{};
+        cameraBlock.VP = VP;
+        cameraBlock.eye = eye;
+        cameraBuffer->update(cameraBlock);
+        lightSetup(lightEntities, camera, parallel ? jobs : nullptr);
+        if(selection){
+            // The lights of the commands are selected again every frame since the lights may move even if the commands don't
+            selection->select(opaqueCommands, parallel ? jobs : nullptr);
+            selection->select(transparentCommands, parallel ? jobs : nullptr);
+            statistics.lightSelection = selection->getStatistics();
+        }
+        SkyBlock skyBlock{};
+        skyBlock.top = sky_top;
+        skyBlock.middle = sky_middle;
+        skyBlock.bottom = sky_bottom;
+        skyBuffer->update(skyBlock);
+        cameraBuffer->bind(UNIFORM_BLOCK_CAMERA);
+        lightsBuffer->bind(UNIFORM_BLOCK_LIGHTS);
+        skyBuffer->bind(UNIFORM_BLOCK_SKY);
+    }
 
-
-        executeCommands(opaqueCommands,VP,lightEntities,eye);
-
-
-
-        
+    void ForwardRenderer::drawSky(CameraComponent* camera, const glm::mat4& VP){
         // If there is a sky material, draw the sky
         if(this->skyMaterial){
             //TODO: (Req 9) setup the sky material
@@ -316,31 +696,66 @@ namespace our {
                 0.0f, 0.0f, 1.0f, 1.0f  // Column4
             );
             //TODO: (Req 9) set the "transform" uniform
-            this->skyMaterial->shader->set("transform",alwaysBehindTransform * VP * model);
+            this->skyMaterial->shader->set(TRANSFORM_UNIFORM, alwaysBehindTransform * VP * model);
             //TODO: (Req 9) draw the sky sphere
             this->skySphere->draw();
         }
+    }
 
+    void ForwardRenderer::finishFrame(GLint outputFrameBuffer){
+        // If there is a postprocess graph, run its passes (the last one draws to the output framebuffer)
+        if(postprocess){
+            postprocess->execute(colorTarget, depthTarget, postprocessFrameBuffer, outputFrameBuffer);
+        }
 
+        // Record how many state calls were sent to OpenGL and how many were skipped by the state cache in this frame
+        statistics.issuedStateCalls = GLStateCache::getStatistics().issuedCalls;
+        statistics.elidedStateCalls = GLStateCache::getStatistics().elidedCalls;
+    }
 
-        //TODO: (Req 8) Draw all the transparent commands
-        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-              
-              
-        executeCommands(transparentCommands,VP,lightEntities,eye);
+    void ForwardRenderer::render(World* world, JobSystem* jobs){
+        // First, we find the camera and prepare the commands (if there is no camera, we cannot render)
+        glm::mat4 VP;
+        CameraComponent* camera = prepareFrame(world, jobs, VP);
+        if(camera == nullptr) return;
 
+        //TODO: (Req 8) Set the OpenGL viewport using windowSize
+        // making the x,y of glViewport equal to the width and height of the window to take
+        // the whole space of the window
+        glViewport(0,0,windowSize[0],windowSize[1]);
 
+        //TODO: (Req 8) Set the clear color to black and the clear depth to 1
+        glClearColor(0.0,0.0,0.0,1.0);
+        glClearDepth(1.0);
+        //TODO: (Req 8) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
+        GLStateCache::depthMask(true);
+        GLStateCache::colorMask(glm::bvec4(true,true,true,true));
+        
+
+        // If there is a postprocess material, bind the framebuffer
+        // But first, remember the framebuffer we should output to (the default framebuffer or the offscreen one in headless mode)
+        GLint outputFrameBuffer = 0;
+        if(postprocess){
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFrameBuffer);
+            //TODO: (Req 10) bind the framebuffer
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER,this->postprocessFrameBuffer);
+        }
 
+        //TODO: (Req 8) Clear the color and depth buffers
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        //TODO: (Req 8) Draw all the opaque commands
+        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
+        uploadFrameData(world, camera, VP, jobs);
+        // (with the depth pre-pass first if it is enabled)
+        drawOpaqueCommands(opaqueCommands, VP);
 
-        // If there is a postprocess material, apply postprocessing
-        if(postprocessMaterial){
-            //TODO: (Req 10) Return to the default framebuffer
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-            //TODO: (Req 10) Setup the postprocess material and draw the fullscreen triangle
-            this->postprocessMaterial->setup();
-            glBindVertexArray(this->postProcessVertexArray);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
-        }
+        drawSky(camera, VP);
+
+        //TODO: (Req 8) Draw all the transparent commands
+        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
+        executeCommands(transparentCommands,VP);
+
+        finishFrame(outputFrameBuffer);
     }
-}
\ No newline at end of file
+}
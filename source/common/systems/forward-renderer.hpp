@@ -5,6 +5,15 @@
 #include "../components/mesh-renderer.hpp"
 #include "../asset-loader.hpp"
 #include "../components/light.hpp"
+#include "../shader/uniform-buffer.hpp"
+#include "render-queue.hpp"
+#include "frustum-culling.hpp"
+#include "render-list.hpp"
+#include "light-clusters.hpp"
+#include "light-selection.hpp"
+#include "gpu-timer.hpp"
+#include "postprocess-graph.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glad/gl.h>
 #include <vector>
@@ -13,39 +22,134 @@
 namespace our
 {
     
-    // The render command stores command that tells the renderer that it should draw
-    // the given mesh at the given localToWorld matrix using the given material
-    // The renderer will fill this struct using the mesh renderer components
-    struct RenderCommand {
-        glm::mat4 localToWorld;
-        glm::vec3 center;
-        Mesh* mesh;
-        Material* material;
+    // The visible commands of one range of the render list (see "ForwardRenderer::prepareCommands")
+    // Each range is culled by one job into its own list, so the jobs never write to the same memory
+    struct RenderCommandList {
+        std::vector<std::uint8_t> visibility;
+        std::vector<RenderCommand> opaque, transparent; // The visible commands with their sort keys
+    };
+
+    // The number of draws and GL state switches done by the renderer in one frame
+    // These are useful to measure the driver overhead and to see the effect of sorting the commands
+    struct RenderStatistics {
+        int visibleCommands = 0;     // How many commands passed the frustum culling
+        int culledCommands = 0;      // How many commands were skipped since they are outside the camera frustum
+        int drawCalls = 0;
+        int instancedDrawCalls = 0;  // How many of the draw calls drew multiple instances
+        int programSwitches = 0;     // How many times a different shader program was used
+        int textureSwitches = 0;     // How many times a different texture was bound to a texture unit
+        int vertexArraySwitches = 0; // How many times a different vertex array (mesh) was bound
+        int issuedStateCalls = 0;    // How many state calls were sent to OpenGL (see "gl-state-cache.hpp")
+        int elidedStateCalls = 0;    // How many state calls were skipped since the state was already set
+        double commandTime = 0;      // The time spent building, culling and sorting the commands (in seconds)
+        RenderListStatistics renderList; // How many retained commands were added, updated or removed (see "RenderList")
+        LightClusterStatistics lightClusters; // How the lights were assigned to the clusters (only if the lighting is clustered)
+        LightSelectionStatistics lightSelection; // How many lights were selected for the commands (only if "lights-per-draw" is set)
+        int deferredCommands = 0;    // How many opaque commands were drawn to the G-buffer (only in the deferred renderer)
+        int lightVolumes = 0;        // How many point & spot lights were drawn as light volumes (only in the deferred renderer)
+        int prepassCommands = 0;     // How many commands were drawn in the depth pre-pass (only if "depth-prepass" is enabled)
+        double prepassGpuTime = 0;   // The GPU time of the depth pre-pass (in milliseconds, measured a few frames ago)
+        double opaqueGpuTime = 0;    // The GPU time of the opaque commands after the pre-pass (in milliseconds, measured a few frames ago)
+        int litCommands = 0;         // How many drawn commands use a lit shader
+        long long commandLights = 0; // The sum of the numbers of lights that the lit commands walk (the clustered lights are not counted)
+    };
+
+    // The following structs hold the per-frame data that is shared by all the draws in a frame.
+    // Each one mirrors the std140 layout of a uniform block in the shaders (see "UNIFORM_BLOCK_*" in "shader.hpp")
+    // so it is uploaded as is to a uniform buffer. The padding members fill the gaps required by std140.
+
+    // Mirrors "uniform Camera { mat4 VP; vec3 eye; }"
+    struct CameraBlock {
+        glm::mat4 VP;
+        glm::vec3 eye; float padding0;
+    };
+
+    // Mirrors "uniform Sky { vec3 top, middle, bottom; }"
+    struct SkyBlock {
+        glm::vec3 top; float padding0;
+        glm::vec3 middle; float padding1;
+        glm::vec3 bottom; float padding2;
     };
 
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
     // In this project, we only need to implement a forward renderer
+    // The members and the steps of "render" are protected so that other renderers (see "DeferredRenderer") can reuse them
     class ForwardRenderer {
+    protected:
         // These window size will be used on multiple occasions (setting the viewport, computing the aspect ratio, etc.)
         glm::ivec2 windowSize;
         // These are two vectors in which we will store the opaque and the transparent commands.
         // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
         std::vector<RenderCommand> opaqueCommands;
         std::vector<RenderCommand> transparentCommands;
+        // The commands of the mesh renderers are kept between frames and only rebuilt when they change
+        RenderList renderList;
+        // The command list of each range of the render list (kept between frames to reuse their memory)
+        std::vector<RenderCommandList> commandLists;
+        // The sorted commands are reused if neither the render list nor the camera changed since they were prepared
+        std::uint64_t preparedVersion = 0;
+        glm::mat4 preparedVP = glm::mat4(0.0f);
+        bool commandsPrepared = false;
+        // If false, the commands are built on the calling thread even if a job system is given (can be disabled via "parallel" in the config)
+        bool parallel = true;
+        // If false, all the commands are drawn even if they are outside the frustum (can be disabled via "culling" in the config)
+        bool culling = true;
+        // These are used to sort the commands by their keys (kept here for the same reason as above)
+        std::vector<render_queue::SortEntry> sortEntries, sortScratch;
+        std::vector<RenderCommand> sortedCommands;
+        // A batch is a run of consecutive commands that share the mesh and the material
+        // If "instancedProgram" is not null, the batch is drawn in one instanced draw call using that program
+        // and the data of its instances starts at "instanceOffset" in "instanceData"
+        struct DrawBatch {
+            size_t first, count;
+            ShaderProgram* instancedProgram;
+            size_t instanceOffset;
+        };
+        std::vector<DrawBatch> batches;
+        // The instance data of the batches drawn by "executeCommands" and the buffer to which it is streamed
+        std::vector<InstanceData> instanceData;
+        GLuint instanceBuffer = 0;
+        // If false, every command is drawn in its own draw call (can be disabled via "instancing" in the config)
+        bool instancing = true;
+        // If not null, the depth of the lit opaque commands is drawn first with this position-only program, then their colors
+        // are drawn with GL_EQUAL and without depth writes so the lighting only runs for the visible fragments
+        // (enabled via "depth-prepass" in the config)
+        ShaderProgram* depthProgram = nullptr;
+        // True while the opaque commands are drawn after the depth pre-pass
+        bool depthEqualPass = false;
+        // The GPU time of the depth pre-pass and of the opaque commands (only measured when the statistics are shown)
+        GpuTimer prepassTimer, opaqueTimer;
+        // The statistics of the last rendered frame
+        RenderStatistics statistics;
+        // If true, the statistics are shown in an ImGui window (see "drawStatisticsGui")
+        bool showStatistics = false;
         // Objects used for rendering a skybox
         Mesh* skySphere;
         TexturedMaterial* skyMaterial;
-        // Objects used for Postprocessing
-        GLuint postprocessFrameBuffer;
-        GLuint postProcessVertexArray;
-        Texture2D *colorTarget, *depthTarget;
-        TexturedMaterial* postprocessMaterial;
+        // Objects used for Postprocessing: the scene is drawn to the color & depth targets, then the passes of the graph read them
+        GLuint postprocessFrameBuffer = 0;
+        Texture2D *colorTarget = nullptr, *depthTarget = nullptr;
+        PostprocessGraph* postprocess = nullptr;
 
 
         LightComponent * light;
 
+        // The uniform buffers that hold the per-frame data (camera, lights and sky colors)
+        // They are filled once per frame and bound to the binding points of their uniform blocks
+        UniformBuffer *cameraBuffer = nullptr, *lightsBuffer = nullptr, *skyBuffer = nullptr;
+        // If not null, the point & spot lights are assigned to the clusters of the camera frustum instead of being sent in "lightsBuffer"
+        // and the lit shaders are drawn with their "CLUSTERED" variant (enabled via "lighting": {"clustered": true} in the config)
+        LightClusters* clusters = nullptr;
+        // If not null (and the lighting is not clustered), each draw only gets the few lights that matter the most to it
+        // and the lit shaders are drawn with their "DRAW_LIGHTS K" variant (enabled via "lighting": {"lights-per-draw": K} in the config)
+        LightSelection* selection = nullptr;
+        // The lights given to the clusters or to the selection (kept here to reuse its memory)
+        std::vector<LightInfluence> lightInfluences;
+        // The number of lights in the "Lights" uniform block in this frame
+        int frameLightCount = 0;
+
 
          // for sky material
         glm::vec3 sky_top;
@@ -55,17 +159,83 @@ namespace our
 
 
     public:
+        // The number of mesh renderers whose commands are built by one job
+        static constexpr size_t COMMAND_BATCH_SIZE = 1024;
+        // The maximum number of lights that can be sent to a shader (must match "MAX_LIGHTS" in "lighting.frag")
+        // Only the "DRAW_LIGHTS" variants read more lights (see "LightSelection::MAX_LIGHTS")
+        static constexpr int MAX_LIGHTS = 16;
+        // Batches with fewer commands than this are drawn without instancing
+        static constexpr size_t MIN_INSTANCED_BATCH = 2;
+
+        // Mirrors "uniform Lights { int light_count; Light lights[MAX_TABLE_LIGHTS]; }"
+        // The shaders that read at most MAX_LIGHTS lights declare a shorter array, which reads the start of the same buffer
+        struct LightsBlock {
+            GLint light_count; GLint padding0[3];
+            LightBlockElement lights[LightSelection::MAX_LIGHTS];
+        };
+
+        virtual ~ForwardRenderer() = default;
+
         // Initialize the renderer including the sky and the Postprocessing objects.
         // windowSize is the width & height of the window (in pixels).
-        void initialize(glm::ivec2 windowSize, const nlohmann::json& config);
+        virtual void initialize(glm::ivec2 windowSize, const nlohmann::json& config);
         // Clean up the renderer
-        void destroy();
+        virtual void destroy();
         // This function should be called every frame to draw the given world
-        void render(World* world);
+        // If a job system is given, the commands are built on its workers (see "prepareCommands")
+        virtual void render(World* world, JobSystem* jobs = nullptr);
+        // Updates the render list then puts its commands that are visible from the camera in "opaqueCommands" & "transparentCommands" and sorts them.
+        // The render list is split into ranges of COMMAND_BATCH_SIZE and each range is culled by a job into its own list.
+        // Then the lists are merged in the order of the ranges, so the result is the same for any number of threads.
+        // If neither the render list nor VP changed since the last call, the sorted commands of the last call are kept as they are.
+        // No OpenGL function is called here and the cached matrices must be up to date (see "World::updateTransforms").
+        void prepareCommands(World* world, CameraComponent* camera, const glm::mat4& VP, JobSystem* jobs);
+        // Removes the retained commands so that the next frame builds all of them again
+        void clearRenderList() { renderList.clear(); commandsPrepared = false; }
+        const std::vector<RenderCommand>& getOpaqueCommands() const { return opaqueCommands; }
+        const std::vector<RenderCommand>& getTransparentCommands() const { return transparentCommands; }
 
         std::vector<Entity *> lightedEntities(World *world);
-        void lightSetup(std::vector<Entity *> entities, ShaderProgram *program);
-        void executeCommands(std::vector<RenderCommand> commands,glm::mat4 VP,std::vector<Entity *> lightEntities,glm::vec3 eye);
+        // Returns the shader data of a light in world space
+        static LightBlockElement makeLightElement(Entity* entity, const LightComponent* light);
+        // Fills the lights uniform buffer with the data of the given light entities
+        // If the lighting is clustered, only the directional lights go to the uniform buffer and the others are assigned to the clusters
+        // of the camera (on the workers of the job system if there is one).
+        // If the lights are selected per draw, the lights that can reach the camera frustum go to the uniform buffer.
+        void lightSetup(const std::vector<Entity *>& entities, CameraComponent* camera = nullptr, JobSystem* jobs = nullptr);
+        // Returns the program with which the commands of the material are drawn
+        // (the clustered or the "DRAW_LIGHTS" variant of its shader if it is lit)
+        virtual ShaderProgram* getProgram(const Material* material) const;
+        // Culls the commands in [begin, end) of the render list and computes the sort keys of the visible ones
+        // "eye" and "forward" are the camera position and forward direction and "farPlane" is the distance to its far plane
+        void buildCommands(size_t begin, size_t end, RenderCommandList& list, const frustum_culling::Frustum& frustum,
+                           glm::vec3 eye, glm::vec3 forward, float farPlane) const;
+        // Sorts the commands by their keys (computed by "buildCommands")
+        void sortCommands(std::vector<RenderCommand>& commands);
+        void executeCommands(const std::vector<RenderCommand>& commands, const glm::mat4& VP);
+        // Streams "instanceData" to the instance buffer
+        void uploadInstanceData();
+        // Returns true if the commands of the material are drawn in the depth pre-pass
+        bool isDepthPrepassed(const Material* material) const;
+        // Draws the depth of the pre-passed commands (the color writes are disabled)
+        void drawDepthPrepass(const std::vector<RenderCommand>& commands);
+        // Draws the opaque commands after their depth pre-pass (if it is enabled) and measures their GPU time
+        void drawOpaqueCommands(const std::vector<RenderCommand>& commands, const glm::mat4& VP);
+
+        // The steps of "render":
+        // Finds the camera (returns nullptr if there is none), computes VP and prepares the commands
+        CameraComponent* prepareFrame(World* world, JobSystem* jobs, glm::mat4& VP);
+        // Fills & binds the camera, lights and sky uniform buffers (and selects the lights of the commands if needed)
+        void uploadFrameData(World* world, CameraComponent* camera, const glm::mat4& VP, JobSystem* jobs);
+        void drawSky(CameraComponent* camera, const glm::mat4& VP);
+        // Applies the postprocessing (if any) to the given framebuffer and records the state call statistics
+        void finishFrame(GLint outputFrameBuffer);
+
+        // Returns the statistics of the last rendered frame
+        const RenderStatistics& getStatistics() const { return statistics; }
+        // Draws the statistics in an ImGui window if "statistics" is enabled in the renderer config
+        // This should be called from the "onImmediateGui" of the state
+        void drawStatisticsGui() const;
         void deserialize(const nlohmann::json &data) 
         {
             if (data.contains("sky_top"))
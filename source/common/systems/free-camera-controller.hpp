@@ -30,14 +30,15 @@ namespace our
         // This should be called every frame to update all entities containing a FreeCameraControllerComponent 
         void update(World* world, float deltaTime) {
             // First of all, we search for an entity containing both a CameraComponent and a FreeCameraControllerComponent
-            // As soon as we find one, we break
+            // We keep the first one we find
             CameraComponent* camera = nullptr;
             FreeCameraControllerComponent *controller = nullptr;
-            for(auto entity : world->getEntities()){
-                camera = entity->getComponent<CameraComponent>();
-                controller = entity->getComponent<FreeCameraControllerComponent>();
-                if(camera && controller) break;
-            }
+            world->view<FreeCameraControllerComponent, CameraComponent>().each(
+                [&](Entity*, FreeCameraControllerComponent& foundController, CameraComponent& foundCamera){
+                    if(camera) return;
+                    camera = &foundCamera;
+                    controller = &foundController;
+                });
             // If there is no entity with both a CameraComponent and a FreeCameraControllerComponent, we can do nothing so we return
             if(!(camera && controller)) return;
             // Get the entity that we found via getOwner of camera (we could use controller->getOwner())
@@ -0,0 +1,113 @@
+#include "frustum-culling.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace our::frustum_culling {
+
+    Frustum extractFrustum(const glm::mat4& VP) {
+        // Each plane is a sum or a difference of the last row of the matrix and one of the other rows (Gribb & Hartmann)
+        // Note that glm matrices are column major so the row i is (VP[0][i], VP[1][i], VP[2][i], VP[3][i])
+        glm::vec4 rows[4];
+        for(int i = 0; i < 4; i++) rows[i] = glm::vec4(VP[0][i], VP[1][i], VP[2][i], VP[3][i]);
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // Left
+        frustum.planes[1] = rows[3] - rows[0]; // Right
+        frustum.planes[2] = rows[3] + rows[1]; // Bottom
+        frustum.planes[3] = rows[3] - rows[1]; // Top
+        frustum.planes[4] = rows[3] + rows[2]; // Near
+        frustum.planes[5] = rows[3] - rows[2]; // Far
+        // Normalize the planes so that the plane equation gives the actual distance (needed to compare it with the radius)
+        for(auto& plane : frustum.planes) plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    void transformSphere(const glm::mat4& M, glm::vec3 center, float radius, glm::vec3& worldCenter, float& worldRadius) {
+        worldCenter = glm::vec3(M * glm::vec4(center, 1.0f));
+        float scaleSquared = glm::max(glm::max(
+            glm::dot(glm::vec3(M[0]), glm::vec3(M[0])),
+            glm::dot(glm::vec3(M[1]), glm::vec3(M[1]))),
+            glm::dot(glm::vec3(M[2]), glm::vec3(M[2])));
+        worldRadius = radius * glm::sqrt(scaleSquared);
+    }
+
+    bool intersects(const Frustum& frustum, glm::vec3 center, float radius) {
+        for(const auto& plane : frustum.planes) {
+            if(glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+        }
+        return true;
+    }
+
+    void coneBoundingSphere(glm::vec3 apex, glm::vec3 direction, float angle, float range, glm::vec3& center, float& radius) {
+        if(angle >= glm::radians(90.0f)) {
+            center = apex;
+            radius = range;
+        } else if(angle > glm::radians(45.0f)) {
+            // The sphere passes through the circle at the base of the cone
+            center = apex + direction * (range * glm::cos(angle));
+            radius = range * glm::sin(angle);
+        } else {
+            // The sphere passes through the apex and the circle at the base of the cone
+            radius = range / (2.0f * glm::cos(angle));
+            center = apex + direction * radius;
+        }
+    }
+
+    bool intersectsCone(glm::vec3 center, float radius, glm::vec3 apex, glm::vec3 direction, float cosAngle, float range) {
+        glm::vec3 toCenter = center - apex;
+        float alongAxis = glm::dot(toCenter, direction);
+        float acrossAxis = glm::sqrt(glm::max(0.0f, glm::dot(toCenter, toCenter) - alongAxis * alongAxis));
+        float sinAngle = glm::sqrt(glm::max(0.0f, 1.0f - cosAngle * cosAngle));
+        // The distance from the center of the sphere to the side of the cone
+        float distance = cosAngle * acrossAxis - alongAxis * sinAngle;
+        return distance <= radius && alongAxis <= radius + range && alongAxis >= -radius;
+    }
+
+    size_t cull(const Frustum& frustum, const SphereList& spheres, std::vector<std::uint8_t>& visible) {
+        visible.resize(spheres.size());
+        return cull(frustum, spheres, 0, spheres.size(), visible.data());
+    }
+
+    size_t cull(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end, std::uint8_t* visible) {
+        size_t visibleCount = 0;
+        size_t index = begin;
+
+#if defined(FRUSTUM_CULLING_SSE)
+        // Test 4 spheres at a time: for each plane, a sphere is outside if its signed distance is less than -radius
+        for(; index + 4 <= end; index += 4) {
+            __m128 x = _mm_loadu_ps(&spheres.x[index]);
+            __m128 y = _mm_loadu_ps(&spheres.y[index]);
+            __m128 z = _mm_loadu_ps(&spheres.z[index]);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[index]));
+            __m128 inside = _mm_cmpeq_ps(x, x); // All bits set (the centers are never NaN)
+            for(const auto& plane : frustum.planes) {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for(int lane = 0; lane < 4; lane++) {
+                std::uint8_t isVisible = (mask >> lane) & 1;
+                visible[index - begin + lane] = isVisible;
+                visibleCount += isVisible;
+            }
+        }
+#endif
+
+        // Test the remaining spheres (or all of them if SSE is not available) one by one
+        for(; index < end; index++) {
+            std::uint8_t isVisible = 1;
+            for(const auto& plane : frustum.planes) {
+                float distance = plane.x * spheres.x[index] + plane.y * spheres.y[index] + plane.z * spheres.z[index] + plane.w;
+                if(distance < -spheres.radius[index]) { isVisible = 0; break; }
+            }
+            visible[index - begin] = isVisible;
+            visibleCount += isVisible;
+        }
+        return visibleCount;
+    }
+
+}
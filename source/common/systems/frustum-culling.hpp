@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // This namespace contains the functions used to skip drawing the objects that are outside the camera view.
+    // Each object is bounded by a sphere in world space and the spheres are tested against the 6 planes of the camera frustum.
+    // The spheres are stored as a structure of arrays so that the test can run on 4 spheres at once using SIMD (SSE).
+    // It also contains the tests used to skip the lights that cannot reach an object (see "LightSelection" & "LightClusters").
+    namespace frustum_culling {
+
+        // The 6 planes of a view frustum (left, right, bottom, top, near, far)
+        // Each plane is stored as (normal, distance) with a normalized inward-facing normal
+        // so a point p is inside the plane if dot(normal, p) + distance >= 0
+        struct Frustum {
+            glm::vec4 planes[6];
+        };
+
+        // A list of bounding spheres stored as a structure of arrays
+        struct SphereList {
+            std::vector<float> x, y, z, radius;
+
+            void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+            size_t size() const { return x.size(); }
+            void push(glm::vec3 center, float r) {
+                x.push_back(center.x); y.push_back(center.y); z.push_back(center.z); radius.push_back(r);
+            }
+            void set(size_t index, glm::vec3 center, float r) {
+                x[index] = center.x; y[index] = center.y; z[index] = center.z; radius[index] = r;
+            }
+            // Replaces the sphere at the given index with the last sphere then removes the last one (so the order is not kept)
+            void swapRemove(size_t index) {
+                x[index] = x.back(); y[index] = y.back(); z[index] = z.back(); radius[index] = radius.back();
+                x.pop_back(); y.pop_back(); z.pop_back(); radius.pop_back();
+            }
+        };
+
+        // Extracts the frustum planes from a view projection matrix (in world space if VP = P * V)
+        Frustum extractFrustum(const glm::mat4& VP);
+
+        // Transforms a local bounding sphere to the world space using the given model matrix
+        // Since the matrix could scale the object, the radius is scaled by the largest axis scale
+        void transformSphere(const glm::mat4& M, glm::vec3 center, float radius, glm::vec3& worldCenter, float& worldRadius);
+
+        // Tests a sphere against the frustum (returns true if they intersect)
+        bool intersects(const Frustum& frustum, glm::vec3 center, float radius);
+
+        // Computes the smallest sphere around a cone whose apex is "apex", whose axis is the normalized "direction",
+        // whose half angle is "angle" (in radians) and whose sides have the length "range" (e.g. the volume lit by a spot light)
+        // If the angle is larger than 90 degrees, the sphere around the apex is returned
+        void coneBoundingSphere(glm::vec3 apex, glm::vec3 direction, float angle, float range, glm::vec3& center, float& radius);
+
+        // Tests a sphere against the same cone as above, given the cosine of its half angle (returns true if they may intersect)
+        // The test is conservative: it may return true for a sphere just outside the cone near its apex or its base
+        bool intersectsCone(glm::vec3 center, float radius, glm::vec3 apex, glm::vec3 direction, float cosAngle, float range);
+
+        // Tests all the spheres against the frustum and writes 1 in "visible" for each sphere that intersects it or 0 otherwise
+        // Returns the number of visible spheres
+        size_t cull(const Frustum& frustum, const SphereList& spheres, std::vector<std::uint8_t>& visible);
+        // Tests the spheres in [begin, end) and writes the result of the sphere "begin + i" in "visible[i]"
+        // This allows multiple threads to test separate ranges of the same list
+        size_t cull(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end, std::uint8_t* visible);
+
+    }
+
+}
@@ -0,0 +1,40 @@
+#include "gpu-timer.hpp"
+
+namespace our {
+
+    void GpuTimer::initialize() {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    void GpuTimer::destroy() {
+        glDeleteQueries(QUERY_COUNT, queries);
+        for(int index = 0; index < QUERY_COUNT; index++) pending[index] = false;
+        running = false;
+    }
+
+    void GpuTimer::begin() {
+        // Read the results that are available, from the oldest query to the newest (the queries finish in order)
+        for(int offset = 1; offset <= QUERY_COUNT; offset++) {
+            int index = (current + offset) % QUERY_COUNT;
+            if(!pending[index]) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) break;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+            milliseconds = (double)elapsed / 1e6;
+            pending[index] = false;
+        }
+        running = !pending[current];
+        if(running) glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    void GpuTimer::end() {
+        if(!running) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        current = (current + 1) % QUERY_COUNT;
+        running = false;
+    }
+
+}
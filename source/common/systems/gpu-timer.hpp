@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/gl.h>
+
+namespace our {
+
+    // A GPU timer measures the time taken by the GPU to run the commands sent between "begin" and "end" (using GL_TIME_ELAPSED queries).
+    // The result of a query is only read once it is available (a few frames later) so the CPU never waits for the GPU.
+    // Only one GL_TIME_ELAPSED query can be active at a time, so the ranges of different timers must not overlap.
+    class GpuTimer {
+        // The queries are used in turn, so a query is only reused after the GPU finished the frames of the other ones
+        static constexpr int QUERY_COUNT = 4;
+        GLuint queries[QUERY_COUNT] = {};
+        bool pending[QUERY_COUNT] = {};
+        int current = 0;
+        bool running = false;
+        double milliseconds = 0;
+
+    public:
+        void initialize();
+        void destroy();
+
+        // Starts measuring (the measure of this frame is skipped if all the queries are still waiting for their results)
+        void begin();
+        void end();
+
+        // The time of the last measure whose result is available (in milliseconds)
+        double getMilliseconds() const { return milliseconds; }
+    };
+
+}
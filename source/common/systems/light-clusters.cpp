@@ -0,0 +1,285 @@
+#include "light-clusters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LIGHT_CLUSTERS_SSE
+#include <xmmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace our {
+
+    namespace {
+        const UniformHandle LIGHT_DATA_UNIFORM = ShaderProgram::getUniformHandle("light_data");
+        const UniformHandle LIGHT_GRID_UNIFORM = ShaderProgram::getUniformHandle("light_grid");
+        const UniformHandle LIGHT_INDICES_UNIFORM = ShaderProgram::getUniformHandle("light_indices");
+
+        // Returns the index of the lowest set bit (the value must not be zero)
+        int lowestBit(std::uint32_t value) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, value);
+            return (int)index;
+#else
+            return __builtin_ctz(value);
+#endif
+        }
+
+        // Replaces the content of a buffer (orphaning its old storage so we don't wait for the draws that use it)
+        void uploadBuffer(GLuint buffer, const void* data, size_t size) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            // A buffer texture always gets some storage even if there is nothing to read
+            glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)std::max<size_t>(size, 16), nullptr, GL_STREAM_DRAW);
+            if(size > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)size, data);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // Returns the point of the segment from "nearPoint" to "farPoint" (in view space) at the given view depth
+        glm::vec3 pointAtDepth(glm::vec3 nearPoint, glm::vec3 farPoint, float depth) {
+            float t = (depth + nearPoint.z) / (nearPoint.z - farPoint.z);
+            return glm::mix(nearPoint, farPoint, t);
+        }
+    }
+
+    void LightClusters::initialize(const nlohmann::json& config, bool createObjects) {
+        if(config.is_object()) {
+            if(auto it = config.find("clusters"); it != config.end() && it->is_array() && it->size() == 3)
+                counts = glm::max(glm::ivec3((*it)[0].get<int>(), (*it)[1].get<int>(), (*it)[2].get<int>()), glm::ivec3(1));
+            threshold = config.value("threshold", threshold);
+        }
+        boundsProjection = glm::mat4(0.0f);
+        if(!createObjects) return;
+
+        clustersBuffer = new UniformBuffer(sizeof(ClustersBlock));
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for(int index = 0; index < 3; index++) {
+            uploadBuffer(buffers[index], nullptr, 0);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[index]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[index], buffers[index]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize);
+    }
+
+    void LightClusters::destroy() {
+        if(!clustersBuffer) return;
+        delete clustersBuffer;
+        clustersBuffer = nullptr;
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(3, buffers);
+    }
+
+    void LightClusters::computeBounds(const glm::mat4& projection, float nearPlane, float farPlane) {
+        boundsProjection = projection;
+        boundsNear = nearPlane;
+        boundsFar = farPlane;
+        sliceDepths.resize(counts.z + 1);
+        for(int slice = 0; slice <= counts.z; slice++)
+            sliceDepths[slice] = nearPlane * std::pow(farPlane / nearPlane, (float)slice / counts.z);
+
+        // The corners of the tiles on the near & the far planes in view space
+        glm::mat4 inverseProjection = glm::inverse(projection);
+        std::vector<glm::vec3> nearCorners, farCorners;
+        for(int y = 0; y <= counts.y; y++) {
+            for(int x = 0; x <= counts.x; x++) {
+                glm::vec2 ndc = glm::vec2(x, y) / glm::vec2(counts.x, counts.y) * 2.0f - 1.0f;
+                glm::vec4 nearCorner = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+                glm::vec4 farCorner = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+                nearCorners.push_back(glm::vec3(nearCorner) / nearCorner.w);
+                farCorners.push_back(glm::vec3(farCorner) / farCorner.w);
+            }
+        }
+
+        size_t clusterCount = (size_t)counts.x * counts.y * counts.z;
+        for(auto* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) values->resize(clusterCount);
+        size_t cluster = 0;
+        for(int slice = 0; slice < counts.z; slice++) {
+            for(int y = 0; y < counts.y; y++) {
+                for(int x = 0; x < counts.x; x++, cluster++) {
+                    glm::vec3 boxMin(std::numeric_limits<float>::max()), boxMax(-std::numeric_limits<float>::max());
+                    for(int corner = 0; corner < 4; corner++) {
+                        size_t index = (size_t)(y + corner / 2) * (counts.x + 1) + (x + corner % 2);
+                        for(int side = 0; side < 2; side++) {
+                            glm::vec3 point = pointAtDepth(nearCorners[index], farCorners[index], sliceDepths[slice + side]);
+                            boxMin = glm::min(boxMin, point);
+                            boxMax = glm::max(boxMax, point);
+                        }
+                    }
+                    minX[cluster] = boxMin.x; minY[cluster] = boxMin.y; minZ[cluster] = boxMin.z;
+                    maxX[cluster] = boxMax.x; maxY[cluster] = boxMax.y; maxZ[cluster] = boxMax.z;
+                }
+            }
+        }
+    }
+
+    void LightClusters::assign(const std::vector<LightInfluence>& lights, const glm::mat4& view, const glm::mat4& projection,
+                               float nearPlane, float farPlane, glm::ivec2 screenSize, JobSystem* jobs) {
+        auto start = std::chrono::steady_clock::now();
+        if(projection != boundsProjection || nearPlane != boundsNear || farPlane != boundsFar || sliceDepths.size() != (size_t)counts.z + 1)
+            computeBounds(projection, nearPlane, farPlane);
+
+        // Move the lights to view space
+        viewSpheres.clear();
+        viewCones.clear();
+        lightData.clear();
+        for(const auto& light : lights) {
+            glm::vec3 center = glm::vec3(view * glm::vec4(light.data.position, 1.0f));
+            viewSpheres.push_back(glm::vec4(center, light.radius));
+            // The cone test is skipped for the point lights and the spot lights that are wider than a hemisphere
+            float outerAngle = light.data.cone_angles.y;
+            if(light.data.type == 2 && outerAngle < glm::radians(90.0f)) {
+                glm::vec3 direction = glm::normalize(glm::vec3(view * glm::vec4(light.data.direction, 0.0f)));
+                viewCones.push_back(glm::vec4(direction, std::cos(outerAngle)));
+            } else {
+                viewCones.push_back(glm::vec4(0.0f, 0.0f, 0.0f, 2.0f));
+            }
+            // The type is stored as a float since its int bits would be a denormal float which some drivers flush to zero
+            const LightBlockElement& data = light.data;
+            lightData.push_back(glm::vec4(data.position, (float)data.type));
+            lightData.push_back(glm::vec4(data.direction, data.range));
+            lightData.push_back(glm::vec4(data.diffuse, 0.0f));
+            lightData.push_back(glm::vec4(data.specular, 0.0f));
+            lightData.push_back(glm::vec4(data.attenuation, 0.0f));
+            lightData.push_back(glm::vec4(data.cone_angles, 0.0f, 0.0f));
+        }
+
+        // Each slice is assigned separately, then the lists of the slices are concatenated in order
+        slices.resize(counts.z);
+        if(jobs) {
+            jobs->parallelFor((size_t)counts.z, 1, [this](size_t begin, size_t end){
+                for(size_t slice = begin; slice < end; slice++) assignSlice((int)slice);
+            });
+        } else {
+            for(int slice = 0; slice < counts.z; slice++) assignSlice(slice);
+        }
+
+        size_t clustersPerSlice = (size_t)counts.x * counts.y;
+        size_t maxIndices = (size_t)std::max(0, maxTextureBufferSize);
+        grid.resize(clustersPerSlice * counts.z);
+        indices.clear();
+        statistics = LightClusterStatistics();
+        statistics.lights = (int)lights.size();
+        for(int slice = 0; slice < counts.z; slice++) {
+            const Slice& result = slices[slice];
+            for(size_t cluster = 0; cluster < clustersPerSlice; cluster++) {
+                glm::uvec2 range = result.ranges[cluster];
+                // The lights that don't fit in the buffer texture are dropped
+                size_t count = std::min<size_t>(range.y, maxIndices - indices.size());
+                statistics.droppedLights += (int)(range.y - count);
+                grid[slice * clustersPerSlice + cluster] = glm::uvec2((std::uint32_t)indices.size(), (std::uint32_t)count);
+                indices.insert(indices.end(), result.indices.begin() + range.x, result.indices.begin() + range.x + count);
+                statistics.maxClusterLights = std::max(statistics.maxClusterLights, (int)count);
+            }
+        }
+        statistics.assignedLights = (int)indices.size();
+
+        block.view = view;
+        block.counts = glm::uvec4(counts, 0);
+        float logRatio = std::log(farPlane / nearPlane);
+        block.depth = glm::vec4(nearPlane, farPlane, counts.z / logRatio, -counts.z * std::log(nearPlane) / logRatio);
+        block.screen = glm::vec4(screenSize, 0.0f, 0.0f);
+        statistics.assignTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void LightClusters::assignSlice(int slice) {
+        Slice& result = slices[slice];
+        size_t clustersPerSlice = (size_t)counts.x * counts.y;
+        size_t words = (viewSpheres.size() + 31) / 32;
+        result.masks.assign(clustersPerSlice * words, 0);
+        result.indices.clear();
+        result.ranges.resize(clustersPerSlice);
+
+        size_t first = (size_t)slice * clustersPerSlice;
+        // The slice covers the view z range [-far depth, -near depth]
+        float sliceNear = -sliceDepths[slice], sliceFar = -sliceDepths[slice + 1];
+        for(size_t light = 0; light < viewSpheres.size(); light++) {
+            glm::vec4 sphere = viewSpheres[light];
+            if(sphere.z - sphere.w > sliceNear || sphere.z + sphere.w < sliceFar) continue;
+            glm::vec4 cone = viewCones[light];
+            std::uint32_t bit = std::uint32_t(1) << (light % 32);
+            std::uint32_t* masks = result.masks.data() + light / 32;
+
+            // Tests the cone of a spot light against the bounding sphere of a cluster
+            auto insideCone = [&](size_t cluster) {
+                if(cone.w > 1.0f) return true;
+                glm::vec3 boxMin(minX[cluster], minY[cluster], minZ[cluster]), boxMax(maxX[cluster], maxY[cluster], maxZ[cluster]);
+                return frustum_culling::intersectsCone(0.5f * (boxMin + boxMax), 0.5f * glm::length(boxMax - boxMin),
+                    glm::vec3(sphere), glm::vec3(cone), cone.w, sphere.w);
+            };
+            auto add = [&](size_t index) {
+                if(insideCone(first + index)) masks[index * words] |= bit;
+            };
+
+            size_t index = 0;
+#if defined(LIGHT_CLUSTERS_SSE)
+            // Test 4 clusters at a time: the squared distance from the sphere center to each box is compared with the squared radius
+            __m128 x = _mm_set1_ps(sphere.x), y = _mm_set1_ps(sphere.y), z = _mm_set1_ps(sphere.z);
+            __m128 radiusSquared = _mm_set1_ps(sphere.w * sphere.w);
+            __m128 zero = _mm_setzero_ps();
+            for(; index + 4 <= clustersPerSlice; index += 4) {
+                size_t cluster = first + index;
+                __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[cluster]), x), _mm_sub_ps(x, _mm_loadu_ps(&maxX[cluster]))));
+                __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[cluster]), y), _mm_sub_ps(y, _mm_loadu_ps(&maxY[cluster]))));
+                __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[cluster]), z), _mm_sub_ps(z, _mm_loadu_ps(&maxZ[cluster]))));
+                __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared));
+                for(int lane = 0; lane < 4; lane++)
+                    if(mask & (1 << lane)) add(index + lane);
+            }
+#endif
+
+            // Test the remaining clusters (or all of them if SSE is not available) one by one
+            for(; index < clustersPerSlice; index++) {
+                size_t cluster = first + index;
+                glm::vec3 center = glm::vec3(sphere);
+                glm::vec3 boxMin(minX[cluster], minY[cluster], minZ[cluster]), boxMax(maxX[cluster], maxY[cluster], maxZ[cluster]);
+                glm::vec3 delta = glm::max(glm::vec3(0.0f), glm::max(boxMin - center, center - boxMax));
+                if(glm::dot(delta, delta) <= sphere.w * sphere.w) add(index);
+            }
+        }
+
+        // Gather the indices of the lights of each cluster (in increasing order)
+        for(size_t cluster = 0; cluster < clustersPerSlice; cluster++) {
+            std::uint32_t offset = (std::uint32_t)result.indices.size();
+            const std::uint32_t* masks = result.masks.data() + cluster * words;
+            for(size_t word = 0; word < words; word++) {
+                for(std::uint32_t bits = masks[word]; bits != 0; bits &= bits - 1)
+                    result.indices.push_back((std::uint32_t)(word * 32 + lowestBit(bits)));
+            }
+            result.ranges[cluster] = glm::uvec2(offset, (std::uint32_t)result.indices.size() - offset);
+        }
+    }
+
+    void LightClusters::upload() {
+        if(!clustersBuffer) return;
+        uploadBuffer(buffers[0], lightData.data(), lightData.size() * sizeof(glm::vec4));
+        uploadBuffer(buffers[1], grid.data(), grid.size() * sizeof(glm::uvec2));
+        uploadBuffer(buffers[2], indices.data(), indices.size() * sizeof(std::uint32_t));
+        clustersBuffer->update(block);
+    }
+
+    void LightClusters::bind() const {
+        if(!clustersBuffer) return;
+        for(GLuint index = 0; index < 3; index++) {
+            GLStateCache::activeTexture(FIRST_TEXTURE_UNIT + index);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[index]);
+        }
+        clustersBuffer->bind(UNIFORM_BLOCK_CLUSTERS);
+    }
+
+    void LightClusters::setupProgram(ShaderProgram* program) {
+        if(program->getUniformLocation(LIGHT_DATA_UNIFORM) < 0) return;
+        program->set(LIGHT_DATA_UNIFORM, (GLint)FIRST_TEXTURE_UNIT);
+        program->set(LIGHT_GRID_UNIFORM, (GLint)(FIRST_TEXTURE_UNIT + 1));
+        program->set(LIGHT_INDICES_UNIFORM, (GLint)(FIRST_TEXTURE_UNIT + 2));
+    }
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../shader/shader.hpp"
+#include "../shader/uniform-buffer.hpp"
+#include "../material/material.hpp"
+#include "../jobs/job-system.hpp"
+#include "frustum-culling.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // Mirrors "struct Light" in "lighting.frag"
+    // It is both an element of the "Lights" uniform block (std140) and 6 texels of the light data buffer texture of the clusters
+    struct LightBlockElement {
+        glm::vec3 position; GLint type;
+        glm::vec3 direction; float range; // The influence radius (only read by the light volumes of "DeferredRenderer")
+        glm::vec3 diffuse; float padding1;
+        glm::vec3 specular; float padding2;
+        glm::vec3 attenuation; float padding3;
+        glm::vec2 cone_angles; float padding4[2];
+    };
+    static_assert(sizeof(LightBlockElement) == 96, "LightBlockElement must match the std140 layout of Light");
+
+    // Mirrors "uniform Clusters { mat4 cluster_view; uvec4 cluster_counts; vec4 cluster_depth; vec4 cluster_screen; }"
+    struct ClustersBlock {
+        glm::mat4 view;
+        glm::uvec4 counts; // The number of clusters along x, y & z (w is unused)
+        glm::vec4 depth;   // (near, far, scale, bias) where the slice of a view depth d is floor(log(d) * scale + bias)
+        glm::vec4 screen;  // The size of the viewport in pixels (zw are unused)
+    };
+
+    // A light given to the clusters (or to "LightSelection"): its shader data and the distance beyond which it can be ignored
+    // (see "LightComponent::getInfluenceRadius")
+    struct LightInfluence {
+        LightBlockElement data;
+        float radius;
+    };
+
+    // The statistics of the last light assignment
+    struct LightClusterStatistics {
+        int lights = 0;           // The lights given to the clusters
+        int assignedLights = 0;   // The sum of the numbers of lights of all the clusters
+        int maxClusterLights = 0; // The largest number of lights in one cluster
+        int droppedLights = 0;    // The assignments that didn't fit in the index buffer texture
+        double assignTime = 0;    // The time taken by "assign" (in seconds)
+    };
+
+    // The clusters split the view frustum into a grid of cells (froxels): uniform tiles on the screen and slices whose depth grows
+    // exponentially from the near plane to the far plane. Each frame, the point & spot lights are assigned on the CPU to the clusters
+    // they touch, then the lights and the light list of each cluster are uploaded to buffer textures so that a fragment only walks
+    // the lights of its own cluster (see "CLUSTERED" in "lighting.frag").
+    // Each slice is assigned by one job: the bounding sphere of each light is tested against 4 cluster boxes at a time (using SSE),
+    // then the spot lights are also tested against the bounding sphere of each remaining cluster.
+    //
+    // The config is read from a json object:
+    //  "clusters": the number of clusters along x, y & z (default: [16, 9, 24])
+    //  "threshold": the light contribution below which a light is ignored (see "LightComponent::getInfluenceRadius") (default: 1/256)
+    class LightClusters {
+        glm::ivec3 counts = {16, 9, 24};
+        float threshold = 1.0f / 256.0f;
+
+        // The view space bounding box of each cluster (ordered by slice, then row, then column) stored as a structure of arrays
+        std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+        // The projection & the depth range from which the boxes were computed (they are only recomputed when these change)
+        glm::mat4 boundsProjection = glm::mat4(0.0f);
+        float boundsNear = 0, boundsFar = 0;
+        std::vector<float> sliceDepths; // The view depth of the boundary of each slice (counts.z + 1 values)
+
+        // The lights of the current frame in view space
+        std::vector<glm::vec4> viewSpheres; // The center & the radius of each light
+        std::vector<glm::vec4> viewCones;   // The direction & the cosine of the outer angle of each spot light (w is 2 for the other lights)
+        // The light table as RGBA32F texels (6 per light, with the same layout as "LightBlockElement" except that the type is a float)
+        std::vector<glm::vec4> lightData;
+
+        // The lights of each slice found by its job: one bit per light for each cluster, then the light indices of each cluster
+        struct Slice {
+            std::vector<std::uint32_t> masks;
+            std::vector<std::uint32_t> indices;
+            std::vector<glm::uvec2> ranges; // The offset (in "indices") & the count of each cluster of the slice
+        };
+        std::vector<Slice> slices;
+        // The offset (in "indices") & the count of each cluster, then the light indices of all the clusters
+        std::vector<glm::uvec2> grid;
+        std::vector<std::uint32_t> indices;
+
+        ClustersBlock block{};
+        UniformBuffer* clustersBuffer = nullptr;
+        // The light data (RGBA32F), the grid (RG32UI) & the indices (R32UI)
+        GLuint buffers[3] = {}, textures[3] = {};
+        GLint maxTextureBufferSize = 65536;
+        LightClusterStatistics statistics;
+
+        // Computes the bounding box of every cluster from the projection
+        void computeBounds(const glm::mat4& projection, float nearPlane, float farPlane);
+        // Finds the lights of each cluster of a slice
+        void assignSlice(int slice);
+
+    public:
+        // The first texture unit used by the buffer textures (the units before it are left for the materials)
+        static constexpr GLuint FIRST_TEXTURE_UNIT = Material::MAX_TEXTURE_UNITS;
+
+        // Reads the config (see the description of the class)
+        // If "createObjects" is false, no OpenGL object is created (only "assign" can be used then)
+        void initialize(const nlohmann::json& config, bool createObjects = true);
+        void destroy();
+
+        // Assigns the lights to the clusters of a camera (no OpenGL function is called here)
+        // "nearPlane" & "farPlane" are the depths of the first & the last slice and "screenSize" is the size of the viewport.
+        // If a job system is given, the slices are assigned on its workers.
+        void assign(const std::vector<LightInfluence>& lights, const glm::mat4& view, const glm::mat4& projection,
+                    float nearPlane, float farPlane, glm::ivec2 screenSize, JobSystem* jobs = nullptr);
+        // Uploads the result of the last assignment to the buffer textures & the uniform buffer
+        void upload();
+        // Binds the buffer textures to their texture units and the uniform buffer to "UNIFORM_BLOCK_CLUSTERS"
+        void bind() const;
+        // Tells the given program (which must be in use) which texture units hold the buffer textures
+        static void setupProgram(ShaderProgram* program);
+
+        glm::ivec3 getCounts() const { return counts; }
+        float getThreshold() const { return threshold; }
+        // The offset & the count of the lights of each cluster in "getIndices" and the light indices of all the clusters
+        const std::vector<glm::uvec2>& getGrid() const { return grid; }
+        const std::vector<std::uint32_t>& getIndices() const { return indices; }
+        const LightClusterStatistics& getStatistics() const { return statistics; }
+    };
+
+}
@@ -0,0 +1,138 @@
+#include "light-selection.hpp"
+#include "../material/material.hpp"
+#include "../components/light.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace our {
+
+    void LightSelection::initialize(const nlohmann::json& config) {
+        if(config.is_object()) {
+            lightsPerDraw = config.value("lights-per-draw", lightsPerDraw);
+            threshold = config.value("threshold", threshold);
+        }
+        // Only a few variants are compiled, so K is rounded up to a power of 2
+        int supported = 1;
+        while(supported < lightsPerDraw && supported < MAX_LIGHTS_PER_DRAW) supported *= 2;
+        lightsPerDraw = supported;
+        define = "DRAW_LIGHTS " + std::to_string(lightsPerDraw);
+    }
+
+    void LightSelection::setLights(const std::vector<LightInfluence>& lights, const frustum_culling::Frustum& frustum) {
+        table.clear();
+        tableLights.clear();
+        statistics = LightSelectionStatistics();
+        for(const auto& light : lights) {
+            TableLight tableLight;
+            tableLight.position = light.data.position;
+            tableLight.range = light.radius;
+            tableLight.direction = light.data.direction;
+            tableLight.cosAngle = 2.0f;
+            tableLight.attenuation = light.data.attenuation;
+            tableLight.intensity = std::max({light.data.diffuse.x, light.data.diffuse.y, light.data.diffuse.z,
+                light.data.specular.x, light.data.specular.y, light.data.specular.z});
+            tableLight.directional = light.data.type == (GLint)LightType::DIRECTIONAL;
+            if(!tableLight.directional) {
+                // A light that is too weak to reach anything is skipped
+                if(light.radius <= 0.0f) continue;
+                tableLight.boundsCenter = light.data.position;
+                tableLight.boundsRadius = light.radius;
+                float outerAngle = light.data.cone_angles.y;
+                if(light.data.type == (GLint)LightType::SPOT && outerAngle < glm::radians(90.0f)) {
+                    tableLight.direction = glm::normalize(light.data.direction);
+                    tableLight.cosAngle = std::cos(outerAngle);
+                    frustum_culling::coneBoundingSphere(light.data.position, tableLight.direction, outerAngle, light.radius,
+                        tableLight.boundsCenter, tableLight.boundsRadius);
+                }
+                // A light that cannot reach the camera frustum cannot light any visible object
+                if(!frustum_culling::intersects(frustum, tableLight.boundsCenter, tableLight.boundsRadius)) continue;
+            }
+            if((int)table.size() == MAX_LIGHTS) {
+                statistics.droppedLights++;
+                continue;
+            }
+            table.push_back(light.data);
+            tableLights.push_back(tableLight);
+        }
+        statistics.lights = (int)table.size();
+    }
+
+    void LightSelection::select(std::vector<RenderCommand>& commands, JobSystem* jobs) {
+        auto start = std::chrono::steady_clock::now();
+        size_t rangeCount = (commands.size() + SELECT_BATCH_SIZE - 1) / SELECT_BATCH_SIZE;
+        rangeCounts.assign(rangeCount, 0);
+        auto selectRanges = [&](size_t begin, size_t end){
+            rangeCounts[begin / SELECT_BATCH_SIZE] = selectRange(commands, begin, end);
+        };
+        if(jobs) {
+            jobs->parallelFor(commands.size(), SELECT_BATCH_SIZE, selectRanges);
+        } else {
+            for(size_t begin = 0; begin < commands.size(); begin += SELECT_BATCH_SIZE)
+                selectRanges(begin, std::min(commands.size(), begin + SELECT_BATCH_SIZE));
+        }
+        for(long long count : rangeCounts) statistics.selectedLights += count;
+        for(const auto& command : commands)
+            if(command.material->shader->usesLights()) statistics.commands++;
+        statistics.selectTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    long long LightSelection::selectRange(std::vector<RenderCommand>& commands, size_t begin, size_t end) const {
+        long long selected = 0;
+        float scores[MAX_LIGHTS_PER_DRAW];
+        std::uint32_t indices[MAX_LIGHTS_PER_DRAW];
+        for(size_t index = begin; index < end; index++) {
+            RenderCommand& command = commands[index];
+            command.lights = glm::uvec2(~0u);
+            if(!command.material->shader->usesLights()) continue;
+
+            // Keep the best lights sorted by decreasing score (a light only passes the lights with a lower score, so ties keep the table order)
+            int count = 0;
+            for(std::uint32_t light = 0; light < (std::uint32_t)tableLights.size(); light++) {
+                const TableLight& tableLight = tableLights[light];
+                float score = tableLight.intensity;
+                if(!tableLight.directional) {
+                    glm::vec3 offset = command.boundsCenter - tableLight.boundsCenter;
+                    float reach = tableLight.boundsRadius + command.boundsRadius;
+                    if(glm::dot(offset, offset) > reach * reach) continue;
+                    if(tableLight.cosAngle <= 1.0f && !frustum_culling::intersectsCone(command.boundsCenter, command.boundsRadius,
+                        tableLight.position, tableLight.direction, tableLight.cosAngle, tableLight.range)) continue;
+                    // The contribution is estimated at the point of the bounding sphere that is the closest to the light
+                    float distance = std::max(0.0f, glm::distance(command.boundsCenter, tableLight.position) - command.boundsRadius);
+                    float attenuation = glm::dot(tableLight.attenuation, glm::vec3(distance * distance, distance, 1.0f));
+                    score /= std::max(attenuation, 1e-6f);
+                }
+                if(count == lightsPerDraw && score <= scores[count - 1]) continue;
+                int slot = count < lightsPerDraw ? count++ : count - 1;
+                while(slot > 0 && scores[slot - 1] < score) {
+                    scores[slot] = scores[slot - 1];
+                    indices[slot] = indices[slot - 1];
+                    slot--;
+                }
+                scores[slot] = score;
+                indices[slot] = light;
+            }
+
+            // Pack the indices one byte each (the unused bytes stay NO_LIGHT)
+            for(int slot = 0; slot < count; slot++) {
+                std::uint32_t& word = slot < 4 ? command.lights.x : command.lights.y;
+                int shift = 8 * (slot % 4);
+                word = (word & ~(NO_LIGHT << shift)) | (indices[slot] << shift);
+            }
+            selected += count;
+        }
+        return selected;
+    }
+
+    int LightSelection::countLights(glm::uvec2 lights) {
+        int count = 0;
+        for(int slot = 0; slot < MAX_LIGHTS_PER_DRAW; slot++) {
+            std::uint32_t word = slot < 4 ? lights.x : lights.y;
+            if(((word >> (8 * (slot % 4))) & NO_LIGHT) == NO_LIGHT) break;
+            count++;
+        }
+        return count;
+    }
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "light-clusters.hpp"
+#include "render-list.hpp"
+#include "frustum-culling.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // The statistics of the light selection of the last frame
+    struct LightSelectionStatistics {
+        int lights = 0;              // The lights in the light table (the directional lights and the lights that reach the camera frustum)
+        int droppedLights = 0;       // The lights that reach the camera frustum but didn't fit in the light table
+        int commands = 0;            // The lit commands for which lights were selected
+        long long selectedLights = 0; // The sum of the numbers of lights selected for each command
+        double selectTime = 0;       // The time taken by "select" (in seconds)
+    };
+
+    // The light selection gives each draw only the few lights that matter the most to it.
+    // First, the lights that can reach the camera frustum are put in a light table (which is uploaded to the "Lights" uniform block).
+    // Then, for each command, the lights whose influence volume (a sphere, or a cone for the spot lights) overlaps the world bounding
+    // sphere of the command are ranked by their estimated contribution at the closest point of that sphere and the best K are kept.
+    // Their indices in the table are packed (one byte each) in "RenderCommand::lights" and the lit shaders are drawn with their
+    // "DRAW_LIGHTS K" variant which only walks these lights (see "lighting.frag").
+    //
+    // The config is read from a json object:
+    //  "lights-per-draw": K, the number of lights given to each draw (rounded up to 1, 2, 4 or 8) (default: 4)
+    //  "threshold": the light contribution below which a light is ignored (see "LightComponent::getInfluenceRadius") (default: 1/256)
+    class LightSelection {
+        int lightsPerDraw = 4;
+        float threshold = 1.0f / 256.0f;
+        std::string define;
+
+        // The data used to test and rank a light of the table
+        struct TableLight {
+            glm::vec3 position; float range;      // The light position and its influence radius
+            glm::vec3 boundsCenter; float boundsRadius; // The sphere around the influence volume
+            glm::vec3 direction; float cosAngle;  // The cone of the spot lights (cosAngle is 2 for the other lights)
+            glm::vec3 attenuation; float intensity;
+            bool directional;
+        };
+        std::vector<LightBlockElement> table;
+        std::vector<TableLight> tableLights;
+        std::vector<long long> rangeCounts; // The number of lights selected in each range of commands (one per job)
+        LightSelectionStatistics statistics;
+
+        // Selects the lights of the commands in [begin, end) and returns the sum of their numbers of lights
+        long long selectRange(std::vector<RenderCommand>& commands, size_t begin, size_t end) const;
+
+    public:
+        // The size of the light table (must match "MAX_TABLE_LIGHTS" in "lighting.frag")
+        static constexpr int MAX_LIGHTS = 128;
+        // The largest supported number of lights per draw (the indices are packed in the 8 bytes of a uvec2)
+        static constexpr int MAX_LIGHTS_PER_DRAW = 8;
+        // The packed index of an unused light slot
+        static constexpr std::uint32_t NO_LIGHT = 0xFF;
+        // The number of commands whose lights are selected by one job
+        static constexpr size_t SELECT_BATCH_SIZE = 1024;
+
+        // Reads the config (see the description of the class)
+        void initialize(const nlohmann::json& config);
+
+        // Fills the light table with the given lights that can reach the given camera frustum (and resets the statistics)
+        void setLights(const std::vector<LightInfluence>& lights, const frustum_culling::Frustum& frustum);
+        // Selects the lights of each command (on the workers of the job system if one is given)
+        void select(std::vector<RenderCommand>& commands, JobSystem* jobs = nullptr);
+
+        // The light table (its lights are referenced by their index in "RenderCommand::lights")
+        const std::vector<LightBlockElement>& getLights() const { return table; }
+        // The define of the shader variants that read the selected lights (e.g. "DRAW_LIGHTS 4")
+        const std::string& getDefine() const { return define; }
+        int getLightsPerDraw() const { return lightsPerDraw; }
+        float getThreshold() const { return threshold; }
+        const LightSelectionStatistics& getStatistics() const { return statistics; }
+
+        // Returns the number of lights packed in "RenderCommand::lights"
+        static int countLights(glm::uvec2 lights);
+    };
+
+}
@@ -2,12 +2,15 @@
 
 #include "../ecs/world.hpp"
 #include "../components/movement.hpp"
+#include "../ecs/transform-batch.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
 #include <iostream>
+#include <vector>
 
 namespace our
 {
@@ -16,22 +19,42 @@ namespace our
     // This system is added as a simple example for how use the ECS framework to implement logic. 
     // For more information, see "common/components/movement.hpp"
     class MovementSystem {
+        // The moving entities with their transforms & velocities gathered as a structure of arrays (kept to reuse their memory)
+        std::vector<Entity*> entities;
+        transform_batch::TransformList transforms;
+        transform_batch::VelocityList velocities;
     public:
 
+        // The number of entities integrated by each job when the update is split over the worker threads
+        static constexpr size_t CHUNK_SIZE = 2048;
+
         // This should be called every frame to update all entities containing a MovementComponent. 
-        void update(World* world, float deltaTime) {
-            // For each entity in the world
-            for(auto entity : world->getEntities()){
-                // Get the movement component if it exists
-                MovementComponent* movement = entity->getComponent<MovementComponent>();
-                // If the movement component exists
-                if(movement){
-                    
-                    // Change the position and rotation based on the linear & angular velocity and delta time.
-                    entity->localTransform.position += deltaTime * movement->linearVelocity;
-                    entity->localTransform.rotation += deltaTime * movement->angularVelocity;
+        // The entities are integrated together using the SIMD kernels (see "transform_batch::integrate").
+        // If a job system is given, the entities are split into chunks that are integrated in parallel
+        // (each entity is integrated by exactly one chunk so the result is the same).
+        void update(World* world, float deltaTime, JobSystem* jobs = nullptr) {
+            entities.clear();
+            transforms.clear();
+            velocities.clear();
+            // For each entity in the world that has a movement component, gather its transform and velocities
+            world->view<MovementComponent>().each([this](Entity* entity, MovementComponent& movement){
+                entities.push_back(entity);
+                transforms.push(entity->localTransform);
+                velocities.push(movement.linearVelocity, movement.angularVelocity);
+            });
+            // Change the positions and rotations based on the linear & angular velocities and delta time.
+            auto integrateRange = [this, deltaTime](size_t begin, size_t end){
+                transform_batch::integrate(transforms, velocities, deltaTime, begin, end);
+                for(size_t index = begin; index < end; index++){
+                    Transform& transform = entities[index]->localTransform;
+                    for(int axis = 0; axis < 3; axis++){
+                        transform.position[axis] = transforms.position[axis][index];
+                        transform.rotation[axis] = transforms.rotation[axis][index];
+                    }
                 }
-            }
+            };
+            if(jobs && entities.size() > CHUNK_SIZE) jobs->parallelFor(entities.size(), CHUNK_SIZE, integrateRange);
+            else integrateRange(0, entities.size());
         }
 
     };
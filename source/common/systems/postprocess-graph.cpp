@@ -0,0 +1,223 @@
+#include "postprocess-graph.hpp"
+#include "../texture/texture-utils.hpp"
+#include "../material/pipeline-state.hpp"
+#include "../deserialize-utils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace our {
+
+    void PostprocessGraph::initialize(glm::ivec2 windowSize, const nlohmann::json& config) {
+        this->windowSize = windowSize;
+
+        // A single shader path is a pass from the scene to the output
+        nlohmann::json passesConfig = nlohmann::json::array();
+        if(config.is_string()) {
+            passesConfig.push_back({{"shader", config.get<std::string>()}});
+        } else if(config.is_object()) {
+            passesConfig = config.value("passes", nlohmann::json::array());
+        }
+
+        for(size_t index = 0; index < passesConfig.size(); index++) {
+            const nlohmann::json& passConfig = passesConfig[index];
+            if(!passConfig.is_object()) continue;
+            Pass pass;
+            pass.name = passConfig.value("name", "pass" + std::to_string(index));
+            // By default, the passes form a chain that starts at the scene and ends at the output
+            std::string previous = passes.empty() ? SCENE_COLOR : passes.back().output;
+            if(passConfig.contains("inputs")) {
+                const nlohmann::json& inputs = passConfig["inputs"];
+                if(inputs.is_string()) pass.inputs.push_back(inputs.get<std::string>());
+                else if(inputs.is_array()) for(const auto& input : inputs) pass.inputs.push_back(input.get<std::string>());
+            } else {
+                pass.inputs.push_back(previous);
+            }
+            pass.output = passConfig.value("output", index + 1 == passesConfig.size() ? std::string(OUTPUT) : pass.name);
+            pass.scale = passConfig.value("scale", pass.scale);
+            if(passConfig.contains("format")) {
+                std::string format = passConfig.value("format", "");
+                if(auto it = gl_enum_deserialize::texture_formats.find(format); it != gl_enum_deserialize::texture_formats.end())
+                    pass.format = it->second;
+                else
+                    std::cerr << "WARNING: The postprocess pass \"" << pass.name << "\" has an unknown format \"" << format << "\" so GL_RGBA8 is used" << std::endl;
+            }
+
+            // A pass without a shader keeps a null program and is rejected by "compile" (along with the passes that read its output)
+            if(std::string shader = passConfig.value("shader", ""); !shader.empty()) {
+                pass.program = new ShaderProgram();
+                pass.program->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+                pass.program->attach(shader, GL_FRAGMENT_SHADER);
+                pass.program->link();
+            }
+            for(size_t input = 0; input < pass.inputs.size(); input++)
+                pass.inputUniforms.push_back(ShaderProgram::getUniformHandle(input == 0 ? "tex" : "tex" + std::to_string(input)));
+            passes.push_back(std::move(pass));
+        }
+
+        // The same sampler is used for all the inputs
+        sampler = new Sampler();
+        sampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        sampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // The fullscreen triangle needs no vertex data, but a vertex array must be bound to draw
+        glGenVertexArrays(1, &vertexArray);
+
+        compile();
+    }
+
+    void PostprocessGraph::compile() {
+        // Validate the passes in order: a pass needs a shader, can only read the scene or a resource written by an earlier valid pass
+        // and each resource is written by one pass only
+        std::map<std::string, int> producers;
+        std::vector<bool> valid(passes.size(), false);
+        for(size_t index = 0; index < passes.size(); index++) {
+            const Pass& pass = passes[index];
+            bool ok = true;
+            if(!pass.program) {
+                std::cerr << "WARNING: The postprocess pass \"" << pass.name << "\" has no shader" << std::endl;
+                ok = false;
+            }
+            for(const std::string& input : pass.inputs) {
+                if(input == OUTPUT || (input != SCENE_COLOR && input != SCENE_DEPTH && !producers.count(input))) {
+                    std::cerr << "WARNING: The postprocess pass \"" << pass.name << "\" reads \"" << input << "\" which no earlier pass writes" << std::endl;
+                    ok = false;
+                }
+            }
+            if(pass.output == SCENE_COLOR || pass.output == SCENE_DEPTH || producers.count(pass.output)) {
+                std::cerr << "WARNING: The postprocess pass \"" << pass.name << "\" writes \"" << pass.output << "\" which is already written" << std::endl;
+                ok = false;
+            }
+            if(!ok) continue;
+            valid[index] = true;
+            producers[pass.output] = (int)index;
+        }
+        if(!producers.count(OUTPUT))
+            std::cerr << "WARNING: No postprocess pass writes \"" << OUTPUT << "\" so the scene is copied as is" << std::endl;
+
+        // Cull the dead passes: walking backwards from the output, a pass is kept if a kept pass reads its output
+        std::vector<bool> alive(passes.size(), false);
+        std::map<std::string, bool> needed = {{OUTPUT, true}};
+        for(size_t index = passes.size(); index-- > 0;) {
+            if(!valid[index] || !needed.count(passes[index].output)) continue;
+            alive[index] = true;
+            for(const std::string& input : passes[index].inputs) needed[input] = true;
+        }
+        order.clear();
+        for(size_t index = 0; index < passes.size(); index++)
+            if(alive[index]) order.push_back((int)index);
+
+        // The lifetime of each intermediate resource ends at the last pass that reads it
+        std::map<std::string, size_t> lastUses;
+        for(size_t position = 0; position < order.size(); position++)
+            for(const std::string& input : passes[order[position]].inputs) lastUses[input] = position;
+
+        // Allocate the targets in the order of execution. The output of a pass is allocated before its inputs are released,
+        // so a pass never writes to the target that it reads.
+        std::map<std::string, int> resourceTargets;
+        std::vector<int> freeTargets;
+        for(size_t position = 0; position < order.size(); position++) {
+            Pass& pass = passes[order[position]];
+            pass.outputTarget = -1;
+            if(pass.output != OUTPUT) {
+                glm::ivec2 size = glm::max(glm::ivec2(glm::vec2(windowSize) * pass.scale), glm::ivec2(1));
+                for(size_t slot = 0; slot < freeTargets.size(); slot++) {
+                    const Target& target = targets[freeTargets[slot]];
+                    if(target.size == size && target.format == pass.format) {
+                        pass.outputTarget = freeTargets[slot];
+                        freeTargets.erase(freeTargets.begin() + slot);
+                        break;
+                    }
+                }
+                if(pass.outputTarget < 0) {
+                    Target target{texture_utils::empty(pass.format, size), 0, size, pass.format};
+                    glGenFramebuffers(1, &target.frameBuffer);
+                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.frameBuffer);
+                    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture->getOpenGLName(), 0);
+                    pass.outputTarget = (int)targets.size();
+                    targets.push_back(target);
+                }
+                resourceTargets[pass.output] = pass.outputTarget;
+                statistics.resources++;
+            }
+            pass.inputTargets.clear();
+            for(const std::string& input : pass.inputs) {
+                if(input == SCENE_COLOR) {
+                    pass.inputTargets.push_back(SCENE_COLOR_TARGET);
+                } else if(input == SCENE_DEPTH) {
+                    pass.inputTargets.push_back(SCENE_DEPTH_TARGET);
+                } else {
+                    int target = resourceTargets[input];
+                    pass.inputTargets.push_back(target);
+                    // A resource that is read twice by the same pass is only released once
+                    if(lastUses[input] == position && std::find(freeTargets.begin(), freeTargets.end(), target) == freeTargets.end())
+                        freeTargets.push_back(target);
+                }
+            }
+        }
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        statistics.passes = (int)order.size();
+        statistics.culledPasses = (int)(passes.size() - order.size());
+        statistics.targets = (int)targets.size();
+    }
+
+    void PostprocessGraph::destroy() {
+        for(Pass& pass : passes) delete pass.program;
+        passes.clear();
+        order.clear();
+        for(Target& target : targets) {
+            glDeleteFramebuffers(1, &target.frameBuffer);
+            delete target.texture;
+        }
+        targets.clear();
+        delete sampler;
+        sampler = nullptr;
+        GLStateCache::forgetVertexArray(vertexArray);
+        glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+        statistics = PostprocessGraphStatistics();
+    }
+
+    void PostprocessGraph::execute(Texture2D* sceneColor, Texture2D* sceneDepth, GLuint sceneFrameBuffer, GLint outputFrameBuffer) {
+        if(order.empty()) {
+            // Without an output pass, the scene is copied as is
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFrameBuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFrameBuffer);
+            glBlitFramebuffer(0, 0, windowSize.x, windowSize.y, 0, 0, windowSize.x, windowSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFrameBuffer);
+            return;
+        }
+
+        // The passes overwrite every pixel of their target, so no depth test, blending or culling is needed
+        PipelineState state{};
+        state.depthMask = false;
+        state.setup();
+        GLStateCache::bindVertexArray(vertexArray);
+        for(int index : order) {
+            const Pass& pass = passes[index];
+            if(pass.outputTarget < 0) {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFrameBuffer);
+                glViewport(0, 0, windowSize.x, windowSize.y);
+            } else {
+                const Target& target = targets[pass.outputTarget];
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.frameBuffer);
+                glViewport(0, 0, target.size.x, target.size.y);
+            }
+            pass.program->use();
+            for(GLuint unit = 0; unit < (GLuint)pass.inputTargets.size(); unit++) {
+                int input = pass.inputTargets[unit];
+                Texture2D* texture = input == SCENE_COLOR_TARGET ? sceneColor : input == SCENE_DEPTH_TARGET ? sceneDepth : targets[input].texture;
+                GLStateCache::activeTexture(unit);
+                texture->bind();
+                sampler->bind(unit);
+                pass.program->set(pass.inputUniforms[unit], (GLint)unit);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glViewport(0, 0, windowSize.x, windowSize.y);
+    }
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../shader/shader.hpp"
+#include "../texture/texture2d.hpp"
+#include "../texture/sampler.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // The statistics of the compiled postprocessing graph (they don't change after "initialize")
+    struct PostprocessGraphStatistics {
+        int passes = 0;       // The passes that are executed
+        int culledPasses = 0; // The passes that were skipped since nothing reads their output (or since they are invalid)
+        int resources = 0;    // The intermediate resources written by the executed passes
+        int targets = 0;      // The render targets allocated for these resources (resources whose lifetimes don't overlap share a target)
+    };
+
+    // A postprocessing graph runs a chain (or a tree) of fullscreen passes over the rendered scene.
+    // Each pass draws a fragment shader (with "fullscreen.vert") that reads some resources and writes one resource:
+    // - "scene" & "depth" are the color & the depth of the rendered scene.
+    // - "output" is the framebuffer to which the renderer outputs.
+    // - Any other name is an intermediate resource with its own resolution scale & format.
+    // The graph is compiled once: the passes whose output is never read (directly or not) by the "output" pass are culled,
+    // then each intermediate resource is given a render target from a pool where a target is reused by a later resource
+    // (of the same size & format) once the last pass that reads the previous resource has run.
+    //
+    // The config is either the path of a fragment shader (one pass from "scene" to "output") or a json object:
+    //  "passes": an array of passes, each one having:
+    //      "shader": the path of the fragment shader (a pass without one is rejected)
+    //      "name": used in the warnings (default: "pass" followed by its index)
+    //      "inputs": the resources bound to the texture units 0, 1, ... and to the samplers "tex", "tex1", ...
+    //                (default: the output of the previous pass or "scene" for the first pass)
+    //      "output": the written resource (default: "output" for the last pass, otherwise its name)
+    //      "scale": the size of the output relative to the window (default: 1, ignored for "output")
+    //      "format": the internal format of the output (e.g. "GL_RGBA16F") (default: "GL_RGBA8", ignored for "output")
+    //                (an unknown format is reported and replaced by the default)
+    class PostprocessGraph {
+        struct Pass {
+            std::string name;
+            ShaderProgram* program = nullptr;
+            std::vector<std::string> inputs;
+            std::string output;
+            float scale = 1.0f;
+            GLenum format = GL_RGBA8;
+            // Filled by "compile": the target of each input (or SCENE_COLOR_TARGET / SCENE_DEPTH_TARGET), its sampler uniform
+            // and the target of the output (-1 for "output")
+            std::vector<int> inputTargets;
+            std::vector<UniformHandle> inputUniforms;
+            int outputTarget = -1;
+        };
+        // A render target of the pool and its framebuffer
+        struct Target {
+            Texture2D* texture;
+            GLuint frameBuffer;
+            glm::ivec2 size;
+            GLenum format;
+        };
+
+        glm::ivec2 windowSize = {0, 0};
+        std::vector<Pass> passes;
+        std::vector<int> order; // The passes that are executed (in the order of the config)
+        std::vector<Target> targets;
+        Sampler* sampler = nullptr;
+        GLuint vertexArray = 0;
+        PostprocessGraphStatistics statistics;
+
+        // Validates the passes, culls the dead ones and allocates the targets of the intermediate resources
+        void compile();
+
+    public:
+        // The names of the resources provided by the renderer
+        static constexpr const char* SCENE_COLOR = "scene";
+        static constexpr const char* SCENE_DEPTH = "depth";
+        static constexpr const char* OUTPUT = "output";
+        // The input targets of the scene color & depth (see "Pass::inputTargets")
+        static constexpr int SCENE_COLOR_TARGET = -1;
+        static constexpr int SCENE_DEPTH_TARGET = -2;
+
+        // Reads & compiles the graph (see the description of the class)
+        void initialize(glm::ivec2 windowSize, const nlohmann::json& config);
+        void destroy();
+
+        // Runs the passes on the given scene color & depth, writing "output" to the given framebuffer
+        // (if no pass writes "output", the scene framebuffer is copied to it)
+        void execute(Texture2D* sceneColor, Texture2D* sceneDepth, GLuint sceneFrameBuffer, GLint outputFrameBuffer);
+
+        const PostprocessGraphStatistics& getStatistics() const { return statistics; }
+    };
+
+}
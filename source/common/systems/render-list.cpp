@@ -0,0 +1,112 @@
+#include "render-list.hpp"
+#include "../ecs/entity.hpp"
+
+namespace our {
+
+    namespace {
+        const UniformHandle MIT_UNIFORM = ShaderProgram::getUniformHandle("MIT");
+    }
+
+    void RenderList::clear() {
+        world = nullptr;
+        slots.clear();
+        commands.clear();
+        spheres.clear();
+        entrySlots.clear();
+        dirtySlots.clear();
+        statistics = RenderListStatistics();
+        version++;
+    }
+
+    void RenderList::update(World* world, JobSystem* jobs) {
+        if(world != this->world) {
+            clear();
+            this->world = world;
+        }
+        statistics.addedEntries = statistics.updatedEntries = statistics.removedEntries = 0;
+        dirtySlots.clear();
+        updateCount++;
+
+        // Compare each mesh renderer with the data its entry was built from
+        size_t existingCount = commands.size(), seenCount = 0;
+        world->view<MeshRendererComponent>().each([&](Entity* entity, MeshRendererComponent& meshRenderer){
+            std::uint32_t slotIndex = meshRenderer.getPoolSlot();
+            if(slotIndex >= slots.size()) slots.resize(slotIndex + 1);
+            Slot& slot = slots[slotIndex];
+            if(slot.entry != NO_ENTRY && slot.generation == meshRenderer.getPoolGeneration()) {
+                seenCount++;
+                slot.lastSeen = updateCount;
+                if(slot.worldVersion == entity->getWorldVersion() && slot.mesh == meshRenderer.mesh && slot.material == meshRenderer.material) return;
+                statistics.updatedEntries++;
+            } else {
+                // The slot is either new or holds a mesh renderer that replaced the one of its entry
+                if(slot.entry == NO_ENTRY) {
+                    slot.entry = (std::uint32_t)commands.size();
+                    commands.emplace_back();
+                    spheres.push(glm::vec3(0.0f), 0.0f);
+                    entrySlots.push_back(slotIndex);
+                } else {
+                    seenCount++;
+                    statistics.removedEntries++;
+                }
+                slot.generation = meshRenderer.getPoolGeneration();
+                slot.lastSeen = updateCount;
+                statistics.addedEntries++;
+            }
+            slot.entity = entity;
+            slot.worldVersion = entity->getWorldVersion();
+            slot.mesh = meshRenderer.mesh;
+            slot.material = meshRenderer.material;
+            dirtySlots.push_back(slotIndex);
+        });
+        // If every existing entry was seen, none of them has to be removed (so there is no need to visit them)
+        if(seenCount < existingCount) removeUnseen();
+
+        // Rebuild the commands that changed (each job writes to separate entries)
+        auto buildRange = [this](size_t begin, size_t end){
+            for(size_t index = begin; index < end; index++) build(dirtySlots[index]);
+        };
+        if(jobs) jobs->parallelFor(dirtySlots.size(), BUILD_BATCH_SIZE, buildRange);
+        else buildRange(0, dirtySlots.size());
+
+        if(statistics.addedEntries + statistics.updatedEntries + statistics.removedEntries > 0) version++;
+        statistics.entries = (int)commands.size();
+    }
+
+    void RenderList::removeUnseen() {
+        for(size_t entry = 0; entry < commands.size();) {
+            std::uint32_t removedSlot = entrySlots[entry];
+            if(slots[removedSlot].lastSeen == updateCount) {
+                entry++;
+                continue;
+            }
+            // The last entry is moved to the place of the removed one
+            commands[entry] = commands.back();
+            spheres.swapRemove(entry);
+            entrySlots[entry] = entrySlots.back();
+            slots[entrySlots[entry]].entry = (std::uint32_t)entry;
+            slots[removedSlot].entry = NO_ENTRY;
+            commands.pop_back();
+            entrySlots.pop_back();
+            statistics.removedEntries++;
+        }
+    }
+
+    void RenderList::build(std::uint32_t slotIndex) {
+        const Slot& slot = slots[slotIndex];
+        RenderCommand& command = commands[slot.entry];
+        command.localToWorld = slot.entity->getLocalToWorldMatrix();
+        // The inverse transpose is cached by the entity and is only requested for the shaders that need it (the lit ones)
+        command.localToWorldInverseTranspose = slot.material->shader->getUniformLocation(MIT_UNIFORM) >= 0 ?
+            slot.entity->getLocalToWorldInverseTranspose() : glm::mat4(1.0f);
+        command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+        command.mesh = slot.mesh;
+        command.material = slot.material;
+        // We also compute the world bounding sphere of the command to test it against the camera frustum (and the lights)
+        frustum_culling::transformSphere(command.localToWorld, slot.mesh->getBoundingSphereCenter(), slot.mesh->getBoundingSphereRadius(),
+            command.boundsCenter, command.boundsRadius);
+        spheres.set(slot.entry, command.boundsCenter, command.boundsRadius);
+        command.lights = glm::uvec2(~0u);
+    }
+
+}
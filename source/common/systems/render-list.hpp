@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../jobs/job-system.hpp"
+#include "frustum-culling.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace our
+{
+
+    // The render command stores command that tells the renderer that it should draw
+    // the given mesh at the given localToWorld matrix using the given material
+    // The renderer will fill this struct using the mesh renderer components
+    struct RenderCommand {
+        glm::mat4 localToWorld;
+        glm::mat4 localToWorldInverseTranspose; // Only filled for the materials whose shader uses it ("MIT")
+        glm::vec3 center;
+        glm::vec3 boundsCenter; float boundsRadius; // The world bounding sphere of the mesh
+        glm::uvec2 lights; // The packed indices of the lights that reach the command (see "LightSelection")
+        Mesh* mesh;
+        Material* material;
+        std::uint64_t sortKey; // The key by which the commands are ordered (see "render-queue.hpp")
+    };
+
+    // The number of entries of a render list and how many of them changed in its last update
+    struct RenderListStatistics {
+        int entries = 0;
+        int addedEntries = 0;   // The mesh renderers that were created (or enabled) since the previous update
+        int updatedEntries = 0; // The mesh renderers whose transform, mesh or material changed since the previous update
+        int removedEntries = 0; // The mesh renderers that were destroyed (or disabled) since the previous update
+    };
+
+    // A render list keeps a command (and a world bounding sphere) for each enabled mesh renderer of a world between frames.
+    // Each update compares every mesh renderer with the data its command was built from (the world matrix version of its entity,
+    // its mesh and its material) and only rebuilds the commands that changed, so a static scene costs one comparison per mesh renderer.
+    // The entries are found by the pool slot of their mesh renderer and the generation of that slot tells if the mesh renderer was replaced.
+    // The commands are stored contiguously (in no particular order) so that they can be split into ranges for the culling.
+    class RenderList {
+        static constexpr std::uint32_t NO_ENTRY = ~std::uint32_t(0);
+
+        // The data from which the command of a mesh renderer was built (indexed by the pool slot of the mesh renderer)
+        struct Slot {
+            std::uint32_t entry = NO_ENTRY; // The index of the command in "commands"
+            std::uint32_t generation = 0;   // The generation of the pool slot when the entry was added
+            std::uint32_t worldVersion = 0;
+            std::uint32_t lastSeen = 0;     // The last update in which the mesh renderer was found
+            Entity* entity = nullptr;
+            Mesh* mesh = nullptr;
+            Material* material = nullptr;
+        };
+
+        const World* world = nullptr; // The world of the entries (the list is cleared if a different world is given)
+        std::vector<Slot> slots;
+        std::vector<RenderCommand> commands;
+        frustum_culling::SphereList spheres;
+        std::vector<std::uint32_t> entrySlots; // The slot of each entry
+        std::vector<std::uint32_t> dirtySlots; // The slots whose command must be rebuilt in the current update
+        std::uint32_t updateCount = 0;
+        std::uint64_t version = 0;
+        RenderListStatistics statistics;
+
+        // Removes the entries whose mesh renderer was not found in the current update
+        void removeUnseen();
+        // Rebuilds the command & the bounding sphere of the entry of a slot
+        void build(std::uint32_t slotIndex);
+
+    public:
+        // The number of entries rebuilt by one job
+        static constexpr size_t BUILD_BATCH_SIZE = 1024;
+
+        // Brings the entries up to date with the enabled mesh renderers of the world.
+        // The cached matrices of the entities must be up to date (see "World::updateTransforms").
+        // If a job system is given, the changed commands are rebuilt on its workers.
+        void update(World* world, JobSystem* jobs = nullptr);
+        // Removes all the entries (so the next update rebuilds all the commands)
+        void clear();
+
+        // The commands and their world bounding spheres (the sphere "i" bounds the command "i")
+        const std::vector<RenderCommand>& getCommands() const { return commands; }
+        const frustum_culling::SphereList& getSpheres() const { return spheres; }
+        size_t size() const { return commands.size(); }
+        // Returns a number that changes whenever an entry is added, rebuilt or removed
+        std::uint64_t getVersion() const { return version; }
+        // Returns the statistics of the last update
+        const RenderListStatistics& getStatistics() const { return statistics; }
+    };
+
+}
@@ -0,0 +1,86 @@
+#include "render-queue.hpp"
+#include "../shader/shader.hpp"
+#include "../material/material.hpp"
+#include "../mesh/mesh.hpp"
+
+#include <glm/common.hpp>
+#include <array>
+
+namespace our::render_queue {
+
+    // Returns the lowest "bits" bits of the value
+    static std::uint64_t field(std::uint64_t value, int bits){
+        return value & ((std::uint64_t(1) << bits) - 1);
+    }
+
+    // Quantizes a normalized depth to the given number of bits
+    static std::uint64_t quantize(float depth, int bits){
+        std::uint64_t maximum = (std::uint64_t(1) << bits) - 1;
+        return (std::uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * (float)maximum);
+    }
+
+    // Combines the pipeline options into 8 bits. Collisions are harmless since they only affect the grouping of the draws, not their correctness.
+    static std::uint64_t pipelineBits(const PipelineState& state){
+        std::uint64_t bits = 0;
+        bits |= (std::uint64_t)state.blending.enabled << 0;
+        bits |= (std::uint64_t)state.depthTesting.enabled << 1;
+        bits |= (std::uint64_t)state.depthMask << 2;
+        bits |= (std::uint64_t)state.faceCulling.enabled << 3;
+        bits |= (std::uint64_t)(state.faceCulling.culledFace == GL_FRONT) << 4;
+        bits |= (std::uint64_t)((state.blending.sourceFactor ^ state.blending.destinationFactor ^ state.depthTesting.function) & 0x7) << 5;
+        return bits;
+    }
+
+    std::uint64_t makeKey(Pass pass, const ShaderProgram* shader, const PipelineState& pipelineState,
+                          const Material* material, const Mesh* mesh, float depth){
+        std::uint64_t shaderId = field(shader->getOpenGLName(), 8);
+        std::uint64_t pipelineId = pipelineBits(pipelineState);
+        std::uint64_t materialId = field(material->getId(), 12);
+        if(pass == Pass::OPAQUE_COMMANDS){
+            std::uint64_t meshId = field(mesh->getVertexArray(), 12);
+            return ((std::uint64_t)pass << 62) | (shaderId << 54) | (pipelineId << 46) |
+                   (materialId << 34) | (meshId << 22) | quantize(depth, 22);
+        } else {
+            std::uint64_t meshId = field(mesh->getVertexArray(), 10);
+            std::uint64_t invertedDepth = quantize(1.0f - depth, 24);
+            return ((std::uint64_t)pass << 62) | (invertedDepth << 38) | (shaderId << 30) |
+                   (pipelineId << 22) | (materialId << 10) | meshId;
+        }
+    }
+
+    void sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch){
+        if(entries.size() < 2) return;
+        scratch.resize(entries.size());
+
+        // Build the histograms of all the 8 digits in a single read over the keys
+        std::array<std::array<std::uint32_t, 256>, 8> histograms{};
+        for(const auto& entry : entries)
+            for(int digit = 0; digit < 8; digit++)
+                histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+
+        SortEntry* source = entries.data();
+        SortEntry* destination = scratch.data();
+        std::uint32_t count = (std::uint32_t)entries.size();
+        for(int digit = 0; digit < 8; digit++){
+            auto& histogram = histograms[digit];
+            // If all the keys have the same value for this digit, this pass would not change the order
+            if(histogram[(source[0].key >> (digit * 8)) & 0xFF] == count) continue;
+            // Turn the counts into the start offsets of each bucket
+            std::uint32_t offset = 0;
+            for(auto& bucket : histogram){
+                std::uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+            // Scatter the entries to their buckets (this is stable, which is what makes LSD radix sort work)
+            for(std::uint32_t index = 0; index < count; index++){
+                const SortEntry& entry = source[index];
+                destination[histogram[(entry.key >> (digit * 8)) & 0xFF]++] = entry;
+            }
+            std::swap(source, destination);
+        }
+        // If the sorted data ended up in the scratch buffer, copy it back
+        if(source != entries.data()) std::copy(source, source + count, entries.data());
+    }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    class ShaderProgram;
+    class Material;
+    class Mesh;
+    struct PipelineState;
+
+    // This namespace contains the functions used to order the render commands such that the GL state changes between draws are minimized.
+    // Each command gets a 64-bit sort key where the most significant bits hold the state that is the most expensive to change.
+    // Sorting the keys (in ascending order) groups the draws that share a shader, then a pipeline state, then a material, then a mesh.
+    //
+    // Opaque key layout (front to back, so that early depth testing rejects hidden fragments):
+    //      | pass (2) | shader (8) | pipeline (8) | material (12) | mesh (12) | depth (22) |
+    // Transparent key layout (back to front, since blending requires it):
+    //      | pass (2) | inverted depth (24) | shader (8) | pipeline (8) | material (12) | mesh (10) |
+    namespace render_queue {
+
+        // The passes in the order in which they are drawn
+        enum class Pass : std::uint64_t {
+            OPAQUE_COMMANDS = 0,
+            TRANSPARENT_COMMANDS = 1
+        };
+
+        // An entry that is sorted instead of the command itself (which is much larger to move around)
+        struct SortEntry {
+            std::uint64_t key;
+            std::uint32_t index; // The index of the command in its list
+        };
+
+        // Builds the sort key of a command
+        // "depth" is the normalized distance from the camera along its forward direction (0 = on the camera, 1 = on the far plane)
+        std::uint64_t makeKey(Pass pass, const ShaderProgram* shader, const PipelineState& pipelineState,
+                              const Material* material, const Mesh* mesh, float depth);
+
+        // Sorts the entries by key in ascending order using a LSD radix sort (8 bits per pass).
+        // The passes in which all keys share the same byte are skipped, so it usually does less than 8 passes.
+        // "scratch" is a temporary buffer which is kept by the caller to avoid reallocating it every frame.
+        void sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+    }
+
+}
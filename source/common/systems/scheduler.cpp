@@ -0,0 +1,131 @@
+#include "scheduler.hpp"
+
+#include <imgui.h>
+
+namespace our {
+
+    namespace {
+        double getSeconds(std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration<double>(duration).count();
+        }
+    }
+
+    void SystemScheduler::initialize(const nlohmann::json& config) {
+        if(!config.is_object()) return;
+        parallel = config.value("parallel", parallel);
+        showTimings = config.value("timings", showTimings);
+    }
+
+    void SystemScheduler::add(std::string name, AccessMask reads, AccessMask writes, Function function) {
+        systems.push_back({ reads, writes, std::move(function), {}, {} });
+        SystemTiming& timing = timings.emplace_back();
+        timing.name = std::move(name);
+        graphValid = false;
+    }
+
+    void SystemScheduler::clear() {
+        systems.clear();
+        timings.clear();
+        graphValid = false;
+    }
+
+    void SystemScheduler::resetTimings() {
+        for(auto& timing : timings) {
+            timing.totalTime = 0;
+            timing.runs = 0;
+        }
+    }
+
+    void SystemScheduler::buildGraph() {
+        for(auto& system : systems) {
+            system.predecessors.clear();
+            system.successors.clear();
+        }
+        for(std::uint32_t later = 0; later < systems.size(); later++) {
+            for(std::uint32_t earlier = 0; earlier < later; earlier++) {
+                const System& a = systems[earlier];
+                const System& b = systems[later];
+                bool conflict = (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+                if(!conflict) continue;
+                systems[later].predecessors.push_back(earlier);
+                systems[earlier].successors.push_back(later);
+            }
+        }
+        remainingPredecessors = std::make_unique<std::atomic<int>[]>(systems.size());
+        graphValid = true;
+    }
+
+    void SystemScheduler::execute(std::uint32_t index, double deltaTime, int thread, std::chrono::steady_clock::time_point runStart) {
+        auto start = std::chrono::steady_clock::now();
+        systems[index].function(deltaTime);
+        auto end = std::chrono::steady_clock::now();
+        // Only the thread running the system writes its timing, and the timings are read after the run ends
+        SystemTiming& timing = timings[index];
+        timing.lastTime = getSeconds(end - start);
+        timing.totalTime += timing.lastTime;
+        timing.runs++;
+        timing.start = getSeconds(start - runStart);
+        timing.end = getSeconds(end - runStart);
+        timing.thread = thread;
+    }
+
+    void SystemScheduler::launch(JobSystem& jobs, JobCounter& counter, std::uint32_t index, double deltaTime, std::chrono::steady_clock::time_point runStart) {
+        jobs.run([this, &jobs, &counter, index, deltaTime, runStart](){
+            execute(index, deltaTime, jobs.getThreadIndex(), runStart);
+            // The successors are submitted before this job finishes, so the counter can't reach zero before they run
+            for(std::uint32_t successor : systems[index].successors)
+                if(--remainingPredecessors[successor] == 0) launch(jobs, counter, successor, deltaTime, runStart);
+        }, &counter);
+    }
+
+    void SystemScheduler::run(double deltaTime, JobSystem* jobs) {
+        if(!graphValid) buildGraph();
+        auto runStart = std::chrono::steady_clock::now();
+        if(jobs && parallel) {
+            for(std::uint32_t index = 0; index < systems.size(); index++)
+                remainingPredecessors[index] = (int)systems[index].predecessors.size();
+            JobCounter counter;
+            for(std::uint32_t index = 0; index < systems.size(); index++)
+                if(systems[index].predecessors.empty()) launch(*jobs, counter, index, deltaTime, runStart);
+            // The calling thread runs the systems too while it waits
+            jobs->wait(counter);
+        } else {
+            for(std::uint32_t index = 0; index < systems.size(); index++) execute(index, deltaTime, 0, runStart);
+        }
+        lastRunTime = getSeconds(std::chrono::steady_clock::now() - runStart);
+        findCriticalPath();
+    }
+
+    void SystemScheduler::findCriticalPath() {
+        // The systems are added in an order that respects the dependencies, so each system comes after its predecessors.
+        // The longest path ending at a system is its duration plus the longest path ending at one of its predecessors.
+        std::vector<double> longest(systems.size(), 0.0);
+        std::vector<std::int32_t> previous(systems.size(), -1);
+        std::int32_t last = -1;
+        for(std::uint32_t index = 0; index < systems.size(); index++) {
+            for(std::uint32_t predecessor : systems[index].predecessors) {
+                if(longest[predecessor] > longest[index]) {
+                    longest[index] = longest[predecessor];
+                    previous[index] = (std::int32_t)predecessor;
+                }
+            }
+            longest[index] += timings[index].lastTime;
+            timings[index].critical = false;
+            if(last < 0 || longest[index] > longest[last]) last = (std::int32_t)index;
+        }
+        criticalPathTime = last < 0 ? 0.0 : longest[last];
+        for(std::int32_t index = last; index >= 0; index = previous[index]) timings[index].critical = true;
+    }
+
+    void SystemScheduler::drawTimingsGui() const {
+        if(!showTimings) return;
+        ImGui::Begin("Systems");
+        ImGui::Text("Last run: %.3f ms (critical path: %.3f ms)", 1000.0 * lastRunTime, 1000.0 * criticalPathTime);
+        for(const auto& timing : timings) {
+            ImGui::Text("%s %s: %.3f ms (average: %.3f ms) on thread %d", timing.critical ? "*" : " ", timing.name.c_str(),
+                1000.0 * timing.lastTime, 1000.0 * timing.getAverageTime(), timing.thread);
+        }
+        ImGui::End();
+    }
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../ecs/component.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <json/json.hpp>
+
+namespace our {
+
+    // The data that a system reads or writes. Each component type has its own bit (the same as its "componentBit")
+    // and the data that doesn't live in a component has one of the other bits.
+    using AccessMask = std::uint64_t;
+
+    namespace access {
+        // Returns the bit of a component type
+        constexpr AccessMask component(ComponentType type) { return AccessMask(componentBit(type)); }
+        // Returns the bits of the given component classes (e.g. access::components<MovementComponent, CameraComponent>())
+        template<typename... T>
+        constexpr AccessMask components() { return (AccessMask(0) | ... | component(T::getTypeIndex())); }
+
+        // The transforms of the entities and their cached matrices. Since "Entity::getLocalToWorldMatrix" updates the cache,
+        // a system that reads the world matrices should declare TRANSFORM as written.
+        constexpr AccessMask TRANSFORM = AccessMask(1) << 32;
+        // The entity list: adding, destroying or enabling entities and changing their names, tags or components
+        constexpr AccessMask ENTITIES = AccessMask(1) << 33;
+        // The application: the keyboard, the mouse and the state changes
+        constexpr AccessMask APPLICATION = AccessMask(1) << 34;
+        // The bits from 48 to 63 are left for the data that the systems of a state share (e.g. the collision events)
+        constexpr AccessMask custom(int index) { return AccessMask(1) << (48 + index); }
+    }
+
+    // The measured times of a system. The times are in seconds and "start" & "end" are relative to the start of the last run.
+    struct SystemTiming {
+        std::string name;
+        double lastTime = 0;       // The duration of its last run
+        double totalTime = 0;      // The sum of its durations since the timings were reset
+        int runs = 0;
+        double start = 0, end = 0; // When it started & ended in the last run
+        int thread = 0;            // The thread that ran it last time (0 is the main thread, see "JobSystem::getThreadIndex")
+        bool critical = false;     // True if it is on the critical path of the last run
+
+        double getAverageTime() const { return runs > 0 ? totalTime / runs : 0.0; }
+    };
+
+    // The scheduler runs a list of systems, each declaring the data it reads & writes (see "access").
+    // Two systems conflict if one of them writes data that the other one reads or writes. The conflicting systems always run
+    // in the order in which they were added, while the others (which touch separate data) can run at the same time on the workers.
+    // So the result is the same as running all the systems one by one in the order they were added, as long as
+    // the declared access is correct.
+    // The order is a dependency graph (an edge from each system to every later system that conflicts with it). A system starts
+    // as soon as all its predecessors finish. After each run, the longest chain of dependent systems (the critical path)
+    // is found from the measured times: speeding up the systems on it is what shortens the run.
+    //
+    // The config is read from a json object:
+    //  "parallel": whether the systems run on the job system (default: true)
+    //  "timings": whether the timings are shown in an ImGui window (see "drawTimingsGui") (default: false)
+    class SystemScheduler {
+    public:
+        using Function = std::function<void(double deltaTime)>;
+
+    private:
+        struct System {
+            AccessMask reads, writes;
+            Function function;
+            std::vector<std::uint32_t> predecessors, successors;
+        };
+
+        std::vector<System> systems;
+        std::vector<SystemTiming> timings;
+        std::unique_ptr<std::atomic<int>[]> remainingPredecessors; // The predecessors that didn't finish yet in the current run
+        bool graphValid = false;
+
+        bool parallel = true;
+        bool showTimings = false;
+        double lastRunTime = 0;      // The duration of the last run
+        double criticalPathTime = 0; // The sum of the durations of the systems on the critical path of the last run
+
+        // Finds the predecessors & successors of each system
+        void buildGraph();
+        // Runs a system and measures its time
+        void execute(std::uint32_t index, double deltaTime, int thread, std::chrono::steady_clock::time_point runStart);
+        // Submits a job that runs a system then submits its successors that have no other unfinished predecessors
+        void launch(JobSystem& jobs, JobCounter& counter, std::uint32_t index, double deltaTime, std::chrono::steady_clock::time_point runStart);
+        // Marks the systems on the critical path of the last run
+        void findCriticalPath();
+
+    public:
+        // Reads the config (see the description of the class)
+        void initialize(const nlohmann::json& config);
+
+        // Adds a system that reads & writes the given data. The systems that conflict with it and were added before it run before it.
+        void add(std::string name, AccessMask reads, AccessMask writes, Function function);
+        // Removes all the systems
+        void clear();
+
+        // Runs all the systems once. If no job system is given (or "parallel" is false), they run one by one on the calling thread.
+        void run(double deltaTime, JobSystem* jobs = nullptr);
+
+        // Returns the timings of the systems in the order in which they were added
+        const std::vector<SystemTiming>& getTimings() const { return timings; }
+        void resetTimings();
+        double getLastRunTime() const { return lastRunTime; }
+        double getCriticalPathTime() const { return criticalPathTime; }
+
+        // Draws the timings in an ImGui window if "timings" is enabled in the config
+        void drawTimingsGui() const;
+    };
+
+}
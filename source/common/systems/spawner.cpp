@@ -0,0 +1,170 @@
+#include "spawner.hpp"
+#include "../components/collider.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace our {
+
+    void SpawnerSystem::initialize(World* world, const nlohmann::json& config) {
+        prefabs.clear();
+        instanceIndex.clear();
+        statistics = SpawnerStatistics();
+        if(!config.is_object()) return;
+
+        seed = config.value("seed", 0u);
+        windowSize = config.value("window", 100.0f);
+        startDistance = config.value("start", 0.0f);
+        spawnDistance = config.value("spawn-distance", 300.0f);
+        despawnDistance = config.value("despawn-distance", 20.0f);
+        nextWindow = (std::int64_t)std::ceil(startDistance / windowSize);
+        windowDistance = 0.0f;
+
+        if(!config.contains("prefabs")) return;
+        for(const auto& [name, data] : config["prefabs"].items()) {
+            if(!data.is_object() || !data.contains("entity")) {
+                std::cerr << "The prefab \"" << name << "\" has no entity" << std::endl;
+                continue;
+            }
+            std::uint32_t prefabIndex = (std::uint32_t)prefabs.size();
+            Prefab& prefab = prefabs.emplace_back();
+            prefab.name = name;
+            prefab.budget = data.value("budget", 0.0f);
+            prefab.spacing = data.value("spacing", 0.0f);
+            prefab.offset = data.value("offset", 0.0f);
+            prefab.length = data.value("length", 0.0f);
+            prefab.spawnDistance = data.value("spawn-distance", spawnDistance);
+            if(prefab.spacing <= 0 && prefab.budget > 0) windowDistance = std::max(windowDistance, prefab.spawnDistance);
+            if(auto x = data.find("x"); x != data.end() && x->is_array() && x->size() == 2) {
+                prefab.randomX = true;
+                prefab.minX = (*x)[0].get<float>();
+                prefab.maxX = (*x)[1].get<float>();
+            }
+
+            // Create the pool. The entities are added at the end of the world's list, so the new entities of an instance
+            // are the ones that were appended by deserializing it (the root entity comes first).
+            int poolSize = data.value("pool", 1);
+            nlohmann::json description = nlohmann::json::array({ data["entity"] });
+            for(int index = 0; index < poolSize; index++) {
+                size_t first = world->getEntities().size();
+                world->deserialize(description);
+                const auto& entities = world->getEntities();
+                if(entities.size() == first) break;
+
+                Instance& instance = prefab.instances.emplace_back();
+                for(size_t entityIndex = first; entityIndex < entities.size(); entityIndex++) {
+                    entities[entityIndex]->setEnabled(false);
+                    instance.entities.push_back(entities[entityIndex]->getHandle());
+                }
+                instance.transform = entities[first]->localTransform;
+                std::uint32_t instanceNumber = (std::uint32_t)prefab.instances.size() - 1;
+                instanceIndex[instance.entities.front().value] = { prefabIndex, instanceNumber };
+                statistics.instances++;
+            }
+            // The free list is used as a stack, so it is reversed to use the first instances first
+            for(std::uint32_t index = (std::uint32_t)prefab.instances.size(); index-- > 0;) prefab.freeInstances.push_back(index);
+        }
+    }
+
+    void SpawnerSystem::spawn(World* world, Prefab& prefab, float distance, float x) {
+        if(prefab.freeInstances.empty()) {
+            statistics.skipped++;
+            return;
+        }
+        std::uint32_t index = prefab.freeInstances.back();
+        prefab.freeInstances.pop_back();
+        Instance& instance = prefab.instances[index];
+        instance.distance = distance;
+        instance.active = true;
+        statistics.active++;
+
+        for(size_t entityIndex = 0; entityIndex < instance.entities.size(); entityIndex++) {
+            Entity* entity = world->get(instance.entities[entityIndex]);
+            if(!entity) continue;
+            entity->setEnabled(true);
+            // The object jumped to its new place, so this is not a motion that should be swept nor interpolated
+            entity->resetInterpolation();
+            if(auto collider = entity->getComponent<ColliderComponent>(); collider) collider->resetMotion();
+            if(entityIndex == 0) {
+                // The root is placed relative to the transform given in the prefab (the descendants follow it)
+                entity->localTransform = instance.transform;
+                entity->localTransform.position.x = x;
+                entity->localTransform.position.z = instance.transform.position.z - distance;
+            }
+        }
+    }
+
+    void SpawnerSystem::release(World* world, Prefab& prefab, std::uint32_t index) {
+        Instance& instance = prefab.instances[index];
+        if(!instance.active) return;
+        for(auto handle : instance.entities)
+            if(Entity* entity = world->get(handle)) entity->setEnabled(false);
+        instance.active = false;
+        prefab.freeInstances.push_back(index);
+        statistics.active--;
+    }
+
+    void SpawnerSystem::update(World* world, float distance) {
+        // Release the instances that fell behind the player
+        for(auto& prefab : prefabs) {
+            for(std::uint32_t index = 0; index < prefab.instances.size(); index++) {
+                const Instance& instance = prefab.instances[index];
+                if(instance.active && instance.distance + 0.5f * prefab.length < distance - despawnDistance)
+                    release(world, prefab, index);
+            }
+        }
+
+        // Place the spaced prefabs whose near end came within their spawn distance
+        for(auto& prefab : prefabs) {
+            if(prefab.spacing <= 0) continue;
+            float x = prefab.instances.empty() ? 0.0f : prefab.instances.front().transform.position.x;
+            while(true) {
+                float slotDistance = prefab.offset + prefab.spacing * (float)prefab.nextSlot;
+                if(slotDistance - 0.5f * prefab.length > distance + prefab.spawnDistance) break;
+                spawn(world, prefab, slotDistance, x);
+                prefab.nextSlot++;
+            }
+        }
+
+        // Generate the random prefabs of the windows that came within the largest spawn distance.
+        // All the prefabs draw their numbers when the window is generated (so the track only depends on the seed),
+        // then each instance waits until the window comes within the spawn distance of its prefab.
+        while((float)nextWindow * windowSize <= distance + windowDistance) {
+            // Each window has its own generator which only depends on the seed and the window index
+            std::seed_seq sequence{ seed, (std::uint32_t)nextWindow, (std::uint32_t)((std::uint64_t)nextWindow >> 32) };
+            std::mt19937 generator(sequence);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            for(auto& prefab : prefabs) {
+                if(prefab.spacing > 0 || prefab.budget <= 0) continue;
+                int count = (int)prefab.budget;
+                if(unit(generator) < prefab.budget - (float)count) count++;
+                float defaultX = prefab.instances.empty() ? 0.0f : prefab.instances.front().transform.position.x;
+                for(int index = 0; index < count; index++) {
+                    float place = ((float)nextWindow + unit(generator)) * windowSize;
+                    float x = prefab.randomX ? prefab.minX + (prefab.maxX - prefab.minX) * unit(generator) : defaultX;
+                    prefab.pending.push_back({ (float)nextWindow * windowSize, place, x });
+                }
+            }
+            nextWindow++;
+        }
+        for(auto& prefab : prefabs) {
+            size_t count = 0;
+            for(; count < prefab.pending.size() && prefab.pending[count].window <= distance + prefab.spawnDistance; count++)
+                spawn(world, prefab, prefab.pending[count].distance, prefab.pending[count].x);
+            prefab.pending.erase(prefab.pending.begin(), prefab.pending.begin() + count);
+        }
+    }
+
+    bool SpawnerSystem::recycle(Entity* entity) {
+        auto it = instanceIndex.find(entity->getHandle().value);
+        if(it == instanceIndex.end()) return false;
+        auto [prefabIndex, index] = it->second;
+        Prefab& prefab = prefabs[prefabIndex];
+        if(!prefab.instances[index].active) return false;
+        release(entity->getWorld(), prefab, index);
+        return true;
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <json/json.hpp>
+
+namespace our {
+
+    // The number of prefab instances managed by the spawner
+    struct SpawnerStatistics {
+        int instances = 0; // All the instances (active or pooled)
+        int active = 0;    // The instances that are currently placed on the track
+        int skipped = 0;   // The spawns that were skipped since the pool of their prefab was empty (since initialize)
+    };
+
+    // The spawner system places objects along an endless track (the track extends along the negative z axis).
+    // Each prefab is an entity description (like the ones in the "world" of the scene) that is instantiated
+    // a fixed number of times when the spawner is initialized. These instances form the pool of the prefab:
+    // a spawn enables a free instance and moves it to its place, and an instance that falls behind the player
+    // (or that is recycled by the game) is disabled and returned to its pool. So no entity is created or destroyed while playing.
+    //
+    // There are two kinds of prefabs:
+    // - Regularly spaced prefabs (with "spacing") are placed every "spacing" units (e.g. road tiles & lamps).
+    // - Random prefabs (with "budget") are placed randomly: the track is divided into windows of equal length and each window
+    //   receives "budget" instances of the prefab on average (the fractional part is the chance of an extra instance).
+    // The random numbers of each window are generated from the seed and the window index only, so a given seed always
+    // generates the same track regardless of the frame rate.
+    //
+    // The config is read from a json object:
+    //  "seed": the seed of the track (default: 0)
+    //  "window": the length of a window (default: 100)
+    //  "start": the distance before which no random prefabs are placed (default: 0)
+    //  "spawn-distance": how far in front of the player the objects are placed (default: 300)
+    //  "despawn-distance": how far behind the player the objects are returned to their pools (default: 20)
+    //  "prefabs": an object that maps each prefab name to:
+    //      "entity": the entity description (its position is relative to its place on the track)
+    //      "pool": the number of instances (default: 1)
+    //      "budget": the average number of instances per window (for random prefabs)
+    //      "spacing" & "offset": the distance between the instances and the distance of the first one (for spaced prefabs)
+    //      "length": the length of the object along the track (default: 0)
+    //      "x": the range of the random x positions as [min, max] (default: the x position of the entity)
+    //      "spawn-distance": overrides the spawn distance for this prefab (e.g. to place long objects earlier)
+    //                        (the random instances of a window are placed when the window comes within it)
+    class SpawnerSystem {
+        // An instance of a prefab (the root entity and its descendants)
+        struct Instance {
+            std::vector<EntityHandle> entities; // The root entity is first
+            Transform transform; // The transform of the root entity as given in the prefab
+            float distance = 0;  // The distance at which it was placed
+            bool active = false;
+        };
+        // A random instance that was generated with its window but is not placed yet (its prefab has a shorter spawn distance)
+        struct Placement {
+            float window;   // The start of its window
+            float distance, x;
+        };
+
+        struct Prefab {
+            std::string name;
+            float budget = 0;
+            float spacing = 0, offset = 0;
+            float length = 0;
+            float spawnDistance = 0;
+            bool randomX = false;
+            float minX = 0, maxX = 0;
+            std::int64_t nextSlot = 0; // The index of the next spaced instance
+            std::vector<Instance> instances;
+            std::vector<std::uint32_t> freeInstances;
+            std::vector<Placement> pending; // Ordered by window
+        };
+
+        std::vector<Prefab> prefabs;
+        // Maps the handle of each root entity to its prefab & instance (used by "recycle")
+        std::unordered_map<std::uint32_t, std::pair<std::uint32_t, std::uint32_t>> instanceIndex;
+
+        std::uint32_t seed = 0;
+        float windowSize = 100.0f;
+        float startDistance = 0.0f;
+        float spawnDistance = 300.0f;
+        float despawnDistance = 20.0f;
+        std::int64_t nextWindow = 0; // The index of the next window to fill with random prefabs
+        float windowDistance = 0.0f; // The largest spawn distance of the random prefabs (the windows are generated within it)
+
+        SpawnerStatistics statistics;
+
+        // Takes a free instance of the prefab and places it at the given distance and x position
+        void spawn(World* world, Prefab& prefab, float distance, float x);
+        // Disables the entities of an instance and returns it to the pool
+        void release(World* world, Prefab& prefab, std::uint32_t instanceIndex);
+
+    public:
+        // Reads the config and creates the pools of the prefabs in the given world (any previous pools are forgotten)
+        void initialize(World* world, const nlohmann::json& config);
+
+        // This should be called every frame with the distance traveled by the player along the track.
+        // It places the objects that came within the spawn distance and releases the ones that fell behind.
+        void update(World* world, float distance);
+
+        // Returns an instance to its pool before it falls behind (e.g. when the player picks it up)
+        // Returns false if the entity is not the root of an active instance
+        bool recycle(Entity* entity);
+
+        const SpawnerStatistics& getStatistics() const { return statistics; }
+    };
+
+}
@@ -3,6 +3,7 @@
 #include <glad/gl.h>
 #include <json/json.hpp>
 #include <glm/vec4.hpp>
+#include "../gl-state-cache.hpp"
 
 namespace our
 {
@@ -28,7 +29,8 @@ namespace our
         {
             // TODO: (Req 5) Complete this function
 
-            // Deleting the Sampler object
+            // Deleting the Sampler object (after making the state cache forget it since its name could be reused)
+            GLStateCache::forgetSampler(name);
             glDeleteSamplers(1, &name);
         }
 
@@ -38,7 +40,7 @@ namespace our
             // TODO: (Req 5) Complete this function
             
             // Binding the texture unit to the sampler object
-            glBindSampler(textureUnit, name);
+            GLStateCache::bindSampler(textureUnit, name);
         }
 
         // This static method ensures that no sampler is bound to the given texture unit
@@ -47,7 +49,7 @@ namespace our
             // TODO: (Req 5) Complete this function
 
             // Unbind the texture unit
-            glBindSampler(textureUnit, 0);
+            GLStateCache::bindSampler(textureUnit, 0);
         }
 
         // This function sets a sampler paramter where the value is of type "GLint"
@@ -5,10 +5,11 @@
 
 #include <glad/gl.h>
 
+#include <algorithm>
 #include <vector>
 #include <filesystem>
 
-bool our::screenshot_png(const std::string& filename, bool include_alpha) {
+void our::screenshot_capture(ScreenshotImage& image, bool include_alpha) {
 
     // Read the current viewport parameters
     struct {
@@ -20,7 +21,10 @@ bool our::screenshot_png(const std::string& filename, bool include_alpha) {
     uint8_t components = include_alpha ? 4 : 3;
 
     // Allocate memory to store image
-    std::vector<uint8_t> data(components * viewport.w * viewport.h);
+    image.width = viewport.w;
+    image.height = viewport.h;
+    image.components = components;
+    image.data.resize(components * viewport.w * viewport.h);
 
     // If alpha is included, each pixel will use 4 bytes so the row would always be divisible by 4.
     // Otherwise, we can only be sure it is divisible by 1 (because everything is divisible by 1).
@@ -28,16 +32,30 @@ bool our::screenshot_png(const std::string& filename, bool include_alpha) {
     // Pick a format for reading pixels from framebuffer
     GLenum format = include_alpha ? GL_RGBA : GL_RGB;
     // Read Pixels from framebuffer
-    glReadPixels(viewport.x, viewport.y, viewport.w, viewport.h, format, GL_UNSIGNED_BYTE, data.data());
+    glReadPixels(viewport.x, viewport.y, viewport.w, viewport.h, format, GL_UNSIGNED_BYTE, image.data.data());
 
     // Since texture row in OpenGL start from bottom and goes up, we need to flip since image formats start from top to bottom.
-    stbi_flip_vertically_on_write(true);
+    // The rows are flipped here instead of using "stbi_flip_vertically_on_write" since that is a global setting
+    // and the images could be saved on different threads.
+    size_t row_size = (size_t)components * viewport.w;
+    for(int row = 0; row < viewport.h / 2; row++)
+        std::swap_ranges(
+            image.data.begin() + row * row_size, image.data.begin() + (row + 1) * row_size,
+            image.data.begin() + (viewport.h - 1 - row) * row_size);
+}
 
+bool our::screenshot_save_png(const std::string& filename, const ScreenshotImage& image) {
     // Make sure the directory in which we want to save screenshot exists. If not, create it.
     std::error_code ec;
     std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), ec);
     if(ec) return false;
 
     // Save image and return whether it succeeded or not
-    return stbi_write_png(filename.c_str(), viewport.w, viewport.h, components, data.data(), 0);
+    return stbi_write_png(filename.c_str(), image.width, image.height, image.components, image.data.data(), 0);
+}
+
+bool our::screenshot_png(const std::string& filename, bool include_alpha) {
+    ScreenshotImage image;
+    screenshot_capture(image, include_alpha);
+    return screenshot_save_png(filename, image);
 }
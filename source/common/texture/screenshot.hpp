@@ -1,10 +1,25 @@
 #ifndef GFX_LAB_SCREENSHOT_H
 #define GFX_LAB_SCREENSHOT_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace our {
 
+    // The pixels read from the framebuffer (the rows are ordered from top to bottom like in the image files)
+    struct ScreenshotImage {
+        int width = 0, height = 0;
+        int components = 0;
+        std::vector<uint8_t> data;
+    };
+
+    // Reads the pixels of the current viewport. This must be called on the thread that owns the OpenGL context.
+    void screenshot_capture(ScreenshotImage& image, bool include_alpha = false);
+    // Encodes the image into a png file (creating its directory if needed). Since it doesn't use OpenGL, it can run on any thread.
+    bool screenshot_save_png(const std::string& filename, const ScreenshotImage& image);
+
+    // Captures the current viewport and saves it into a png file
     bool screenshot_png(const std::string& filename, bool include_alpha = false);
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glad/gl.h>
+#include "../gl-state-cache.hpp"
 
 namespace our
 {
@@ -26,7 +27,8 @@ namespace our
         {
             // TODO: (Req 4) Complete this function
 
-            // Deleting the texture object
+            // Deleting the texture object (after making the state cache forget it since its name could be reused)
+            GLStateCache::forgetTexture(name);
             glDeleteTextures(1, &name);
         }
 
@@ -40,7 +42,7 @@ namespace our
         void bind() const
         {
             // TODO: (Req 4) Complete this function
-            glBindTexture(GL_TEXTURE_2D, name);
+            GLStateCache::bindTexture(name);
         }
 
         // This static method ensures that no texture is bound to GL_TEXTURE_2D
@@ -49,7 +51,7 @@ namespace our
             // TODO: (Req 4) Complete this function
 
             // Unbinding
-            glBindTexture(GL_TEXTURE_2D, 0);
+            GLStateCache::bindTexture(0);
         }
 
         Texture2D(const Texture2D &) = delete;
@@ -17,10 +17,13 @@
 #include "states/menu-state.hpp"
 #include "states/game-state.hpp"
 #include "states/end-game-state.hpp"
-#include <ctime>
+#include "states/ecs-benchmark-state.hpp"
+#include "states/collision-benchmark-state.hpp"
+#include "states/transform-benchmark-state.hpp"
+#include "states/job-benchmark-state.hpp"
+#include "states/render-benchmark-state.hpp"
 
 int main(int argc, char** argv) {
-     srand(time( 0 ) );
     
     flags::args args(argc, argv); // Parse the command line arguments
     // config_path is the path to the json file containing the application configuration
@@ -30,6 +33,10 @@ int main(int argc, char** argv) {
     // This is useful for testing multiple configurations in a batch
     // Default: 0 where the application runs indefinitely until manually closed
     int run_for_frames = args.get<int>("f", 0);
+    // headless runs the application without a visible window and renders every frame offscreen
+    // This is useful for running the tests & benchmarks on machines without a display (e.g. "--headless -f=2")
+    // Default: false
+    bool headless = args.get<bool>("headless", false);
 
     // Open the config file and exit if failed
     std::ifstream file_in(config_path);
@@ -42,7 +49,7 @@ int main(int argc, char** argv) {
     file_in.close();
 
     // Create the application
-    our::Application app(app_config);
+    our::Application app(app_config, headless);
     
     // Register all the states of the project in the application
     app.registerState<Playstate>("main");
@@ -57,6 +64,11 @@ int main(int argc, char** argv) {
     app.registerState<MaterialTestState>("material-test");
     app.registerState<EntityTestState>("entity-test");
     app.registerState<RendererTestState>("renderer-test");
+    app.registerState<ECSBenchmarkState>("ecs-benchmark");
+    app.registerState<CollisionBenchmarkState>("collision-benchmark");
+    app.registerState<TransformBenchmarkState>("transform-benchmark");
+    app.registerState<JobBenchmarkState>("job-benchmark");
+    app.registerState<RenderBenchmarkState>("render-benchmark");
     // Then choose the state to run based on the option "start-scene" in the config
     if(app_config.contains(std::string{"start-scene"})){
         app.changeState(app_config["start-scene"].get<std::string>());
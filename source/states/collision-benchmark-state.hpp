@@ -0,0 +1,153 @@
+#pragma once
+
+#include <ecs/world.hpp>
+#include <components/collider.hpp>
+#include <components/movement.hpp>
+#include <systems/collision.hpp>
+#include <systems/movement.hpp>
+#include <application.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <imgui.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// This state measures the time taken to find the collisions between a set of fast movers and many static obstacles.
+// It compares the collision system (spatial hash broadphase) with testing every mover against every other collider.
+// The obstacles are scattered on a square field and the movers cross the field in random directions (wrapping at its edges).
+// The parameters are read from "benchmark" in the config: "obstacles" (default: 10000), "movers" (default: 100),
+// "field-size" (default: 1000) and "speed" (default: 600 units per second, so the movers skip over thin obstacles between frames).
+// The collision grid parameters are read from "collision" in the config (see "CollisionSystem::initialize").
+// The average times are printed when the state is destroyed (run it with "-f=<frames>").
+class CollisionBenchmarkState: public our::State {
+
+    our::World world;
+    our::MovementSystem movementSystem;
+    our::CollisionSystem collisionSystem;
+
+    int obstacleCount = 0, moverCount = 0;
+    float fieldSize = 0;
+    int iterations = 0;
+    double bruteForceTime = 0, systemTime = 0; // The total time in seconds
+    long long bruteForceContacts = 0, systemContacts = 0; // The total number of contacts (they should match)
+
+    // The boxes gathered by the brute force test (kept as members to reuse their memory)
+    std::vector<our::collision::AABB> starts;
+    std::vector<glm::vec3> motions;
+    std::vector<std::uint8_t> statics;
+
+    void onInitialize() override {
+        auto config = getApp()->getConfig().value("benchmark", nlohmann::json::object());
+        obstacleCount = config.value("obstacles", 10000);
+        moverCount = config.value("movers", 100);
+        fieldSize = config.value("field-size", 1000.0f);
+        float speed = config.value("speed", 600.0f);
+        collisionSystem.initialize(getApp()->getConfig().value("collision", nlohmann::json::object()));
+        iterations = 0;
+        bruteForceTime = systemTime = 0;
+        bruteForceContacts = systemContacts = 0;
+
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(-0.5f * fieldSize, 0.5f * fieldSize);
+        std::uniform_real_distribution<float> size(0.1f, 2.0f);
+        std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+
+        // The obstacles are thin walls with random sizes
+        for(int index = 0; index < obstacleCount; index++){
+            our::Entity* entity = world.add();
+            entity->localTransform.position = glm::vec3(position(generator), 0, position(generator));
+            our::ColliderComponent* collider = entity->addComponent<our::ColliderComponent>();
+            collider->isStatic = true;
+            collider->useMeshBounds = false;
+            collider->extents = glm::vec3(size(generator), 1.0f, 0.05f);
+        }
+        // The movers are small boxes with swept colliders
+        for(int index = 0; index < moverCount; index++){
+            our::Entity* entity = world.add();
+            entity->localTransform.position = glm::vec3(position(generator), 0, position(generator));
+            our::ColliderComponent* collider = entity->addComponent<our::ColliderComponent>();
+            collider->swept = true;
+            collider->useMeshBounds = false;
+            collider->extents = glm::vec3(0.5f);
+            float direction = angle(generator);
+            entity->addComponent<our::MovementComponent>()->linearVelocity = speed * glm::vec3(glm::cos(direction), 0, glm::sin(direction));
+        }
+    }
+
+    // Tests every non-static collider against every other collider using the same box & sweep tests as the collision system
+    int bruteForce() {
+        starts.clear(); motions.clear(); statics.clear();
+        world.view<our::ColliderComponent>().each([this](our::Entity* entity, our::ColliderComponent& collider){
+            our::collision::AABB current = our::collision::transformBox(entity->getLocalToWorldMatrix(), collider.center, collider.extents);
+            if(collider.swept && collider.hasPrevious){
+                our::collision::AABB previous = { collider.previousMin, collider.previousMax };
+                starts.push_back(previous);
+                motions.push_back(0.5f * (current.min + current.max) - 0.5f * (previous.min + previous.max));
+            } else {
+                starts.push_back(current);
+                motions.push_back(glm::vec3(0.0f));
+            }
+            statics.push_back(collider.isStatic);
+        });
+        int contacts = 0;
+        float time;
+        for(size_t first = 0; first < starts.size(); first++){
+            if(statics[first]) continue;
+            for(size_t second = 0; second < starts.size(); second++){
+                if(second == first || (!statics[second] && second < first)) continue;
+                if(our::collision::sweep(starts[first], motions[first], starts[second], motions[second], time)) contacts++;
+            }
+        }
+        return contacts;
+    }
+
+    void onDraw(double deltaTime) override {
+        const float step = 1.0f / 60.0f;
+        using clock = std::chrono::high_resolution_clock;
+
+        movementSystem.update(&world, step);
+        // Wrap the movers that left the field (the jump is not a motion so it shouldn't be swept)
+        world.view<our::MovementComponent, our::ColliderComponent>().each([this](our::Entity* entity, our::MovementComponent&, our::ColliderComponent& collider){
+            glm::vec3& position = entity->localTransform.position;
+            if(glm::abs(position.x) > 0.5f * fieldSize || glm::abs(position.z) > 0.5f * fieldSize){
+                position.x = glm::clamp(-position.x, -0.5f * fieldSize, 0.5f * fieldSize);
+                position.z = glm::clamp(-position.z, -0.5f * fieldSize, 0.5f * fieldSize);
+                collider.resetMotion();
+            }
+        });
+
+        // The brute force test runs first since the collision system updates the previous boxes of the colliders
+        auto start = clock::now();
+        bruteForceContacts += bruteForce();
+        auto middle = clock::now();
+        collisionSystem.update(&world);
+        auto end = clock::now();
+        systemContacts += collisionSystem.getStatistics().contacts;
+
+        bruteForceTime += std::chrono::duration<double>(middle - start).count();
+        systemTime += std::chrono::duration<double>(end - middle).count();
+        iterations++;
+    }
+
+    void onImmediateGui() override {
+        if(iterations == 0) return;
+        const auto& statistics = collisionSystem.getStatistics();
+        ImGui::Begin("Collision Benchmark");
+        ImGui::Text("Obstacles: %d, Movers: %d", obstacleCount, moverCount);
+        ImGui::Text("Brute force: %.3f ms", 1000.0 * bruteForceTime / iterations);
+        ImGui::Text("Spatial hash: %.3f ms", 1000.0 * systemTime / iterations);
+        ImGui::Text("Tested pairs: %d, Contacts: %d", statistics.testedPairs, statistics.contacts);
+        ImGui::End();
+    }
+
+    void onDestroy() override {
+        if(iterations > 0){
+            std::cout << "Collision benchmark (" << obstacleCount << " obstacles, " << moverCount << " movers, " << iterations << " iterations)" << std::endl;
+            std::cout << "  brute force:  " << 1000.0 * bruteForceTime / iterations << " ms/iteration, " << bruteForceContacts << " contacts" << std::endl;
+            std::cout << "  spatial hash: " << 1000.0 * systemTime / iterations << " ms/iteration, " << systemContacts << " contacts" << std::endl;
+        }
+        world.clear();
+    }
+};
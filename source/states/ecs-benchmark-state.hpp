@@ -0,0 +1,111 @@
+#pragma once
+
+#include <ecs/world.hpp>
+#include <components/movement.hpp>
+#include <systems/movement.hpp>
+#include <application.hpp>
+
+#include <imgui.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// This state measures the time taken to iterate over the entities of a world and update their movement components.
+// It compares the pooled component storage (iterated via "World::view") with the previous layout
+// in which each entity held a map from the component name to a separately allocated component.
+// The number of entities is read from "benchmark.entities" in the config (default: 100000).
+// The average time per iteration is printed when the state is destroyed (run it with "-f=<frames>").
+class ECSBenchmarkState: public our::State {
+
+    // A replica of the previous entity layout (used as the baseline)
+    struct LegacyEntity {
+        std::unordered_map<std::string, our::Component*> components;
+        our::Transform localTransform;
+
+        template<typename T>
+        T* getComponent(){
+            if(auto it = components.find(T::getID()); it != components.end()){
+                return dynamic_cast<T*>(it->second);
+            }
+            return nullptr;
+        }
+
+        ~LegacyEntity(){
+            for(auto& it : components) delete it.second;
+        }
+    };
+
+    our::World world;
+    our::MovementSystem movementSystem;
+    std::unordered_set<LegacyEntity*> legacyEntities;
+
+    int entityCount = 0;
+    int iterations = 0;
+    double legacyTime = 0, viewTime = 0; // The total time in seconds
+
+    void onInitialize() override {
+        auto config = getApp()->getConfig().value("benchmark", nlohmann::json::object());
+        entityCount = config.value("entities", 100000);
+        iterations = 0;
+        legacyTime = viewTime = 0;
+
+        for(int index = 0; index < entityCount; index++){
+            glm::vec3 velocity = glm::vec3(index % 7, index % 11, index % 13) * 0.01f;
+
+            our::Entity* entity = world.add();
+            entity->setName("entity");
+            our::MovementComponent* movement = entity->addComponent<our::MovementComponent>();
+            movement->linearVelocity = velocity;
+            movement->angularVelocity = velocity;
+
+            LegacyEntity* legacyEntity = new LegacyEntity();
+            our::MovementComponent* legacyMovement = new our::MovementComponent();
+            legacyMovement->linearVelocity = velocity;
+            legacyMovement->angularVelocity = velocity;
+            legacyEntity->components[our::MovementComponent::getID()] = legacyMovement;
+            legacyEntities.insert(legacyEntity);
+        }
+    }
+
+    void onDraw(double deltaTime) override {
+        const float step = 1.0f / 60.0f;
+        using clock = std::chrono::high_resolution_clock;
+
+        auto start = clock::now();
+        for(auto entity : legacyEntities){
+            if(auto movement = entity->getComponent<our::MovementComponent>(); movement){
+                entity->localTransform.position += step * movement->linearVelocity;
+                entity->localTransform.rotation += step * movement->angularVelocity;
+            }
+        }
+        auto middle = clock::now();
+        movementSystem.update(&world, step);
+        auto end = clock::now();
+
+        legacyTime += std::chrono::duration<double>(middle - start).count();
+        viewTime += std::chrono::duration<double>(end - middle).count();
+        iterations++;
+    }
+
+    void onImmediateGui() override {
+        if(iterations == 0) return;
+        ImGui::Begin("ECS Benchmark");
+        ImGui::Text("Entities: %d", entityCount);
+        ImGui::Text("Map lookup: %.3f ms", 1000.0 * legacyTime / iterations);
+        ImGui::Text("Pooled view: %.3f ms", 1000.0 * viewTime / iterations);
+        ImGui::End();
+    }
+
+    void onDestroy() override {
+        if(iterations > 0){
+            std::cout << "ECS benchmark (" << entityCount << " entities, " << iterations << " iterations)" << std::endl;
+            std::cout << "  map lookup per entity: " << 1000.0 * legacyTime / iterations << " ms/iteration" << std::endl;
+            std::cout << "  pooled view:           " << 1000.0 * viewTime / iterations << " ms/iteration" << std::endl;
+        }
+        for(auto entity : legacyEntities) delete entity;
+        legacyEntities.clear();
+        world.clear();
+    }
+};
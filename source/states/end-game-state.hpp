@@ -1,16 +1,18 @@
 #pragma once
 #include <application.hpp>
 #include <ecs/world.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
 #include <asset-loader.hpp>
 
+#include <memory>
+
 // This state shows how to use the ECS framework and deserialization.
 class EndGameState: public our::State {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    std::unique_ptr<our::ForwardRenderer> renderer;
     our::FreeCameraControllerSystem cameraController;
     our::MovementSystem movementSystem;
 
@@ -29,7 +31,9 @@ class EndGameState: public our::State {
         cameraController.enter(getApp());
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        // The renderer type (forward or deferred) is selected by "type" in the renderer config
+        renderer.reset(our::createRendererFromConfig(config["renderer"]));
+        renderer->initialize(size, config["renderer"]);
     }
 
     void onDraw(double deltaTime) override {
@@ -39,12 +43,12 @@ class EndGameState: public our::State {
 
         logic(&world);
         // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
+        renderer->render(&world, &getApp()->getJobSystem());
     }
 
     void onDestroy() override {
         // Don't forget to destroy the renderer
-        renderer.destroy();
+        renderer->destroy();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         cameraController.exit();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
@@ -52,8 +56,8 @@ class EndGameState: public our::State {
     }
     void logic(our::World *world)
     {
-        our::Entity *EXIT = nullptr;
-        our::Entity *REPLAY = nullptr;
+        our::Entity *EXIT = world->findByName("EXIT");
+        our::Entity *REPLAY = world->findByName("REPLAY");
 
         /* small scall means it is not selected */
         float smallScale=1;
@@ -61,21 +65,6 @@ class EndGameState: public our::State {
          /* small scall means it is selected */
         float largeScale=2; 
 
-        // Making the logic for the start menu
-        for (const auto i : world->getEntities())
-        {
-            if (i->name.substr(0,4) == "EXIT")
-            {
-                EXIT = i;
-                continue;
-            }
-            if (i->name.substr(0,4) == "REPL")
-            {
-                REPLAY = i;
-                continue;
-            }
-        }
-         
         /* Check if the Enter key is pressed */
         if (getApp()->getKeyboard().justPressed(GLFW_KEY_ENTER))
         {
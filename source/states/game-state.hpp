@@ -3,24 +3,33 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
+#include <systems/collision.hpp>
+#include <systems/spawner.hpp>
+#include <systems/scheduler.hpp>
 #include <asset-loader.hpp>
 #include <ecs/entity.hpp>
 #include <iostream>
+#include <memory>
 
 // This state shows how to use the ECS framework and deserialization.
 class Gamestate : public our::State
 {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    std::unique_ptr<our::ForwardRenderer> renderer;
     our::FreeCameraControllerSystem cameraController;
     our::MovementSystem movementSystem;
+    our::CollisionSystem collisionSystem;
+    our::SpawnerSystem spawner;
+    our::SystemScheduler scheduler;
 
     void onInitialize() override
     {
+        initializeGameTags();
+
         // First of all, we get the scene configuration from the app config
         auto &config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
@@ -35,103 +44,139 @@ class Gamestate : public our::State
         {
             world.deserialize(config["world"]);
         }
+        // The obstacles, pickups and the repeated scenery (road & lamps) are placed along the track by the spawner
+        spawner.initialize(&world, config.value("spawner", nlohmann::json::object()));
 
         // We initialize the camera controller system since it needs a pointer to the app
         cameraController.enter(getApp());
+        // The collision grid parameters are optional
+        collisionSystem.initialize(config.value("collision", nlohmann::json::object()));
+        registerSystems(config.value("scheduler", nlohmann::json::object()));
 
 
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        // The renderer type (forward or deferred) is selected by "type" in the renderer config
+        renderer.reset(our::createRendererFromConfig(config["renderer"]));
+        renderer->initialize(size, config["renderer"]);
+    }
+
+    void onFixedUpdate(double fixedDeltaTime) override
+    {
+        // The transforms at the start of the step are kept to interpolate the drawn transforms
+        world.beginSimulationStep();
+
+        // Here, we just run a bunch of systems to control the world logic (see "registerSystems")
+        // Since they run at a fixed rate, the game behaves the same regardless of the frame rate
+        scheduler.run(fixedDeltaTime, &getApp()->getJobSystem());
+    }
+
+    // Adds the systems to the scheduler with the data that each of them reads & writes.
+    // The systems that conflict run in the order in which they are added here.
+    void registerSystems(const nlohmann::json &config)
+    {
+        using namespace our;
+        // The collision events are shared by the collision system and the game logic
+        const AccessMask COLLISION_EVENTS = access::custom(0);
+
+        scheduler.clear();
+        scheduler.initialize(config);
+        scheduler.add("movement", access::components<MovementComponent>(), access::TRANSFORM,
+            [this](double deltaTime){ movementSystem.update(&world, (float)deltaTime, &getApp()->getJobSystem()); });
+        scheduler.add("camera-controller", access::components<CameraComponent, FreeCameraControllerComponent>() | access::APPLICATION, access::TRANSFORM,
+            [this](double deltaTime){ cameraController.update(&world, (float)deltaTime); });
+        // The collisions are detected after moving the entities (the events are consumed by the game logic)
+        scheduler.add("collision", access::components<MeshRendererComponent>() | access::TRANSFORM,
+            access::components<ColliderComponent>() | access::TRANSFORM | COLLISION_EVENTS,
+            [this](double){ collisionSystem.update(&world); });
+        // The logic changes the velocities & the energy bar, recycles the objects (via the spawner) and changes the state
+        scheduler.add("logic", COLLISION_EVENTS, access::components<MovementComponent>() | access::TRANSFORM | access::ENTITIES | access::APPLICATION,
+            [this](double deltaTime){ logic(&world, deltaTime); });
     }
 
     void onDraw(double deltaTime) override
     {
+        // We use the renderer system to draw the scene between the last two simulation steps
+        world.beginInterpolation((float)getApp()->getInterpolationAlpha());
+        renderer->render(&world, &getApp()->getJobSystem());
+        world.endInterpolation();
 
-        // Here, we just run a bunch of systems to control the world logic
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
+        // The keys are checked every frame (a step may not run every frame so it could miss a key that was just pressed)
+        if (getApp()->getKeyboard().justPressed(GLFW_KEY_ESCAPE))
+        {
+            getApp()->changeState("end");
+        }
+        // The entities marked for removal during this frame are destroyed at its end
+        world.deleteMarkedEntities();
+    }
 
-        // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
-        logic(&world, deltaTime);
+    void onImmediateGui() override
+    {
+        // Show the renderer statistics & the system timings (if enabled in the config)
+        renderer->drawStatisticsGui();
+        scheduler.drawTimingsGui();
     }
 
     void onDestroy() override
     {
         // Don't forget to destroy the renderer
-        renderer.destroy();
+        renderer->destroy();
+        // The world is cleared so that it is populated again when the game is replayed
+        world.clear();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         cameraController.exit();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
         our::clearAllAssets();
     }
 
-    void renderObjectAgain(int stepForward, our::Entity *obj)
+    // The masks of the tags used by the game logic (the tags are given to the entities in the scene config)
+    struct GameTags {
+        our::TagMask gas, wall, bump, can;
+    } gameTags;
+
+    // The interned names of the entities that the game logic needs every frame
+    our::NameId carName, energyName, cameraName;
+
+    void initializeGameTags()
     {
-        obj->localTransform.position.z -= stepForward;
+        gameTags.gas = our::tags::get("gas");
+        gameTags.wall = our::tags::get("wall");
+        gameTags.bump = our::tags::get("bump");
+        gameTags.can = our::tags::get("can");
+        carName = our::names::intern("car");
+        energyName = our::names::intern("energy");
+        cameraName = our::names::intern("camera");
     }
 
-    void checkCollision(our::Entity *obj, our::Entity *energy, our::Entity *car, our::Entity *camera)
+    // Applies the effect of an object that the car hit then returns the object to its pool
+    void onCarCollision(our::Entity *obj, our::Entity *energy, our::Entity *camera)
     {
         double wallCollision = 1.5;
         double gasCollision = 1.5;
-        double stepForward = (rand() % 100) + 120;
 
-        glm::vec3 objPos = obj->localTransform.position;
         our::MovementComponent *movement = camera->getComponent<our::MovementComponent>();
-        double zDepth = movement->linearVelocity.z / -50.0;
-
-        glm::vec3 carPos = glm::vec3(car->getLocalToWorldMatrix() * glm::vec4(car->localTransform.position, 1));
-        // check for position related to car
-        if (abs(abs(objPos.z) - abs(carPos.z - 10)) < zDepth)
+        our::TagMask tags = obj->getTags();
+        if (tags & gameTags.gas) //----------- GAS ------------//
         {
-
-            if (abs(carPos.x - objPos.x) <= (car->localTransform.scale.x + obj->localTransform.scale.x + 0.5))
-            {
-                // Collision detected
-                if (obj->name.substr(0, 3) == "gas") //----------- GAS ------------//
-                {
-                    renderObjectAgain(stepForward+500, obj);
-                    energy->localTransform.scale.x += gasCollision;
-                    std::cout << "collision gas" << std::endl;
-                }
-                else if (obj->name.substr(0, 3) == "wal") //----------- Wall ------------//
-                {
-                    renderObjectAgain(stepForward, obj);
-                    energy->localTransform.scale.x -= wallCollision;
-                    std::cout << "collision wall" << std::endl;
-                }
-                else if (obj->name.substr(0, 3) == "bum") //----------- Bump ------------//
-                {
-                    renderObjectAgain(stepForward, obj);
-                    movement->linearVelocity.z /= 1.3;
-                    std::cout << "bump collision" << std::endl;
-                }
-                else if (obj->name.substr(0, 3) == "can") //----------- Can ------------//
-                {
-                    renderObjectAgain(stepForward+200, obj);
-                    movement->linearVelocity.z *= 1.3;
-                    std::cout << "can collision" << std::endl;
-                }
-            }
+            energy->localTransform.scale.x += gasCollision;
+            std::cout << "collision gas" << std::endl;
         }
-        else if (abs(objPos.z) < abs(carPos.z) - 10)
+        else if (tags & gameTags.wall) //----------- Wall ------------//
         {
-
-            if (obj->name.substr(0, 3) != "lam")
-            {
-                renderObjectAgain(stepForward, obj);
-            }
-            else if (obj->name.substr(0, 4) == "lamp" && (abs(objPos.z) < abs(carPos.z) - 100))
-            {
-                renderObjectAgain(200, obj);
-            }
-            else if (obj->name.substr(0, 4) == "lamm" && (abs(objPos.z) < abs(carPos.z) - 100))
-            {
-                renderObjectAgain(200, obj);
-            }
+            energy->localTransform.scale.x -= wallCollision;
+            std::cout << "collision wall" << std::endl;
+        }
+        else if (tags & gameTags.bump) //----------- Bump ------------//
+        {
+            movement->linearVelocity.z /= 1.3;
+            std::cout << "bump collision" << std::endl;
+        }
+        else if (tags & gameTags.can) //----------- Can ------------//
+        {
+            movement->linearVelocity.z *= 1.3;
+            std::cout << "can collision" << std::endl;
         }
+        spawner.recycle(obj);
     }
 
     // the logic of the game should implemented here
@@ -140,58 +185,37 @@ class Gamestate : public our::State
 
         const double MAX_SCALE = 7;
 
-        our::Entity *car = nullptr;
-        our::Entity *energy = nullptr;
-        our::Entity *camera = nullptr;
-
-        // Making the logic of collision
-        for (const auto i : world->getEntities())
-        {
-            // first getting the cam position to check it with wall/gas
-            if (i->name == "car")
-            {
-                car = i;
-                continue;
-            }
-            if (i->name == "energy")
-            {
-                energy = i;
-                continue;
-            }
-            if (i->name == "camera")
-            {
-                camera = i;
-                continue;
-            }
-        }
+        // The entities are looked up by name in the world's name index (instead of searching the list of entities)
+        our::Entity *car = world->findByName(carName);
+        our::Entity *energy = world->findByName(energyName);
+        our::Entity *camera = world->findByName(cameraName);
 
         // decrement the car energy with time
         energy->localTransform.scale.x -= deltaTime / 10.0;
 
-        for (const auto i : world->getEntities())
+        // Apply the objects hit by the car since the last frame (the car collider is swept so fast hits are not missed)
+        our::EntityHandle carHandle = car->getHandle();
+        for (const auto &event : collisionSystem.getEvents())
         {
-            if (i->name.substr(0, 3) == "bum" || i->name.substr(0, 3) == "wal" || i->name.substr(0, 3) == "gas" || i->name.substr(0, 3) == "can" || i->name.substr(0, 3) == "lam")
-                checkCollision(i, energy, car, camera);
-            if (i->name.substr(0, 4) == "road" && ((abs(i->localTransform.position.z) + i->localTransform.scale.x) < abs(glm::vec3(car->getLocalToWorldMatrix() * glm::vec4(car->localTransform.position, 1)).z) - 50))
-                i->localTransform.position.z -= 2000; // render the road again in front
+            if (!event.entered || !event.involves(carHandle))
+                continue;
+            if (our::Entity *obj = world->get(event.getOther(carHandle)))
+                onCarCollision(obj, energy, camera);
         }
 
+        // The track extends along the negative z axis, so the distance traveled by the car is its negated z position
+        float carDistance = -car->getLocalToWorldMatrix()[3].z;
+        spawner.update(world, carDistance);
+
         if (energy->localTransform.scale.x <= 0)
         {
             energy->localTransform.scale.x = 0;
             // go to game over
-            world->clear();
             getApp()->changeState("end");
         }
         else if (energy->localTransform.scale.x > MAX_SCALE)
         {
             energy->localTransform.scale.x = MAX_SCALE;
         }
-
-        if (getApp()->getKeyboard().justPressed(GLFW_KEY_ESCAPE))
-        {
-            world->clear();
-            getApp()->changeState("end");
-        }
     }
 };
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <jobs/job-system.hpp>
+#include <application.hpp>
+
+#include <imgui.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// This state stresses the job system of the application (see "JobSystem") and checks that all the jobs ran correctly.
+// Each frame runs 4 tests:
+// - Tiny jobs: many jobs that do nearly nothing (measures the overhead of submitting & running a job).
+// - Job tree: each job spawns children till a given depth (the jobs are spread over the threads by stealing).
+// - Stages: a chain of stages where each stage depends on the counter of the previous one (checks the dependencies).
+// - Parallel for: hashes a range of integers with "parallelFor" and compares the time & the result with a single thread.
+// The parameters are read from "benchmark" in the config: "tiny-jobs" (default: 10000), "tree-depth" (default: 4),
+// "tree-branching" (default: 8), "stages" (default: 8), "stage-jobs" (default: 64) and "parallel-for" (default: 4000000).
+// The results & the statistics of the threads are printed when the state is destroyed (run it with "-f=<frames>").
+class JobBenchmarkState: public our::State {
+
+    int tinyJobCount = 0, treeDepth = 0, treeBranching = 0, stageCount = 0, stageJobCount = 0;
+    size_t parallelForCount = 0;
+
+    int iterations = 0;
+    int errors = 0; // The number of tests whose result was wrong
+    double tinyJobsTime = 0, treeTime = 0, stagesTime = 0, parallelForTime = 0, serialTime = 0; // The total times in seconds
+    long long treeJobs = 0; // The number of jobs in a tree
+
+    std::atomic<long long> executed{0};
+
+    // A cheap integer hash (so that the parallel & the serial sums are exactly equal)
+    static std::uint64_t hash(std::uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        return value ^ (value >> 33);
+    }
+
+    // Spawns the children of a node of the job tree (each job counts itself)
+    void spawnTree(our::JobSystem& jobs, our::JobCounter& counter, int depth) {
+        executed++;
+        if(depth == 0) return;
+        for(int child = 0; child < treeBranching; child++)
+            jobs.run([this, &jobs, &counter, depth](){ spawnTree(jobs, counter, depth - 1); }, &counter);
+    }
+
+    void onInitialize() override {
+        auto config = getApp()->getConfig().value("benchmark", nlohmann::json::object());
+        tinyJobCount = config.value("tiny-jobs", 10000);
+        treeDepth = config.value("tree-depth", 4);
+        treeBranching = config.value("tree-branching", 8);
+        stageCount = config.value("stages", 8);
+        stageJobCount = config.value("stage-jobs", 64);
+        parallelForCount = config.value("parallel-for", (size_t)4000000);
+        iterations = errors = 0;
+        tinyJobsTime = treeTime = stagesTime = parallelForTime = serialTime = 0;
+        treeJobs = 0;
+        for(long long level = 0, width = 1; level <= treeDepth; level++, width *= treeBranching) treeJobs += width;
+        getApp()->getJobSystem().resetStatistics();
+    }
+
+    void onDraw(double) override {
+        using clock = std::chrono::high_resolution_clock;
+        our::JobSystem& jobs = getApp()->getJobSystem();
+
+        // Tiny jobs
+        auto start = clock::now();
+        executed = 0;
+        {
+            our::JobCounter counter;
+            for(int index = 0; index < tinyJobCount; index++) jobs.run([this](){ executed++; }, &counter);
+            jobs.wait(counter);
+        }
+        tinyJobsTime += std::chrono::duration<double>(clock::now() - start).count();
+        if(executed != tinyJobCount) errors++;
+
+        // Job tree
+        start = clock::now();
+        executed = 0;
+        {
+            our::JobCounter counter;
+            jobs.run([this, &jobs, &counter](){ spawnTree(jobs, counter, treeDepth); }, &counter);
+            jobs.wait(counter);
+        }
+        treeTime += std::chrono::duration<double>(clock::now() - start).count();
+        if(executed != treeJobs) errors++;
+
+        // Stages: every job of a stage must see that all the jobs of the previous stages finished
+        start = clock::now();
+        executed = 0;
+        {
+            std::vector<our::JobCounter> counters(stageCount);
+            std::atomic<int> wrongOrder{0};
+            for(int stage = 0; stage < stageCount; stage++) {
+                auto job = [this, stage, &wrongOrder](){
+                    if(executed.load() < (long long)stage * stageJobCount) wrongOrder++;
+                    executed++;
+                };
+                for(int index = 0; index < stageJobCount; index++) {
+                    if(stage == 0) jobs.run(job, &counters[stage]);
+                    else jobs.run(job, &counters[stage], counters[stage - 1]);
+                }
+            }
+            for(auto& counter : counters) jobs.wait(counter);
+            if(wrongOrder != 0) errors++;
+        }
+        stagesTime += std::chrono::duration<double>(clock::now() - start).count();
+        if(executed != (long long)stageCount * stageJobCount) errors++;
+
+        // Parallel for: each batch writes its partial sum to its own element so that the threads don't share a variable
+        start = clock::now();
+        const size_t batchSize = 16384;
+        std::vector<std::uint64_t> partialSums((parallelForCount + batchSize - 1) / batchSize, 0);
+        jobs.parallelFor(parallelForCount, batchSize, [&partialSums](size_t begin, size_t end){
+            std::uint64_t sum = 0;
+            for(size_t index = begin; index < end; index++) sum += hash(index);
+            partialSums[begin / batchSize] = sum;
+        });
+        std::uint64_t parallelSum = 0;
+        for(auto sum : partialSums) parallelSum += sum;
+        auto middle = clock::now();
+        std::uint64_t serialSum = 0;
+        for(size_t index = 0; index < parallelForCount; index++) serialSum += hash(index);
+        auto end = clock::now();
+        parallelForTime += std::chrono::duration<double>(middle - start).count();
+        serialTime += std::chrono::duration<double>(end - middle).count();
+        if(parallelSum != serialSum) errors++;
+
+        iterations++;
+    }
+
+    void onImmediateGui() override {
+        if(iterations == 0) return;
+        auto total = getApp()->getJobSystem().getStatistics().getTotal();
+        ImGui::Begin("Job Benchmark");
+        ImGui::Text("Workers: %d, Errors: %d", getApp()->getJobSystem().getWorkerCount(), errors);
+        ImGui::Text("Tiny jobs: %.2f M jobs/s", 1e-6 * tinyJobCount * iterations / tinyJobsTime);
+        ImGui::Text("Job tree: %.3f ms", 1000.0 * treeTime / iterations);
+        ImGui::Text("Stages: %.3f ms", 1000.0 * stagesTime / iterations);
+        ImGui::Text("Parallel for: %.3f ms (serial: %.3f ms)", 1000.0 * parallelForTime / iterations, 1000.0 * serialTime / iterations);
+        ImGui::Text("Executed: %llu, Stolen: %llu, Max queue depth: %d",
+            (unsigned long long)total.executedJobs, (unsigned long long)total.stolenJobs, total.maxQueueDepth);
+        ImGui::End();
+    }
+
+    void onDestroy() override {
+        if(iterations == 0) return;
+        our::JobSystem& jobs = getApp()->getJobSystem();
+        std::cout << "Job benchmark (" << jobs.getWorkerCount() << " workers, " << iterations << " iterations, " << errors << " errors)" << std::endl;
+        std::cout << "  tiny jobs:    " << tinyJobCount * iterations / tinyJobsTime << " jobs/s" << std::endl;
+        std::cout << "  job tree:     " << 1000.0 * treeTime / iterations << " ms/iteration (" << treeJobs << " jobs)" << std::endl;
+        std::cout << "  stages:       " << 1000.0 * stagesTime / iterations << " ms/iteration (" << stageCount << " x " << stageJobCount << " jobs)" << std::endl;
+        std::cout << "  parallel for: " << 1000.0 * parallelForTime / iterations << " ms/iteration (serial: "
+            << 1000.0 * serialTime / iterations << " ms, speedup: " << serialTime / parallelForTime << ")" << std::endl;
+        auto statistics = jobs.getStatistics();
+        for(size_t index = 0; index < statistics.workers.size(); index++) {
+            const auto& worker = statistics.workers[index];
+            std::cout << "  " << (index == 0 ? "main thread" : "worker " + std::to_string(index)) << ": "
+                << worker.executedJobs << " executed, " << worker.stolenJobs << " stolen, "
+                << worker.idleTime * 1000.0 << " ms idle, max queue depth " << worker.maxQueueDepth << std::endl;
+        }
+    }
+};
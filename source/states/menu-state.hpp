@@ -3,17 +3,19 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
 #include <asset-loader.hpp>
 
+#include <memory>
+
 // This state shows how to use the ECS framework and deserialization.
 class MenuState : public our::State
 {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    std::unique_ptr<our::ForwardRenderer> renderer;
     our::MovementSystem movementSystem;
 
     void onInitialize() override
@@ -35,7 +37,9 @@ class MenuState : public our::State
 
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        // The renderer type (forward or deferred) is selected by "type" in the renderer config
+        renderer.reset(our::createRendererFromConfig(config["renderer"]));
+        renderer->initialize(size, config["renderer"]);
     }
 
     void onDraw(double deltaTime) override
@@ -47,13 +51,13 @@ class MenuState : public our::State
         logic(&world);
 
         // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
+        renderer->render(&world, &getApp()->getJobSystem());
     }
 
     void onDestroy() override
     {
         // Don't forget to destroy the renderer
-        renderer.destroy();
+        renderer->destroy();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
@@ -62,28 +66,12 @@ class MenuState : public our::State
 
     void logic(our::World *world)
     {
-        our::Entity *start = nullptr;
-        our::Entity *quit = nullptr;
+        our::Entity *start = world->findByName("startGame");
+        our::Entity *quit = world->findByName("quitGame");
 
         float smallScale=1;
         float largeScale=2; 
 
-        // Making the logic of collision
-        for (const auto i : world->getEntities())
-        {
-            // first getting the cam position to check it with wall/gas
-            if (i->name.substr(0,5) == "start")
-            {
-                start = i;
-                continue;
-            }
-            if (i->name.substr(0,4) == "quit")
-            {
-                quit = i;
-                continue;
-            }
-        }
-
         if (getApp()->getKeyboard().justPressed(GLFW_KEY_ENTER))
         {
             if(quit->localTransform.scale.x==largeScale){
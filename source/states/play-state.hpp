@@ -3,18 +3,22 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
+#include <systems/scheduler.hpp>
 #include <asset-loader.hpp>
 
+#include <memory>
+
 // This state shows how to use the ECS framework and deserialization.
 class Playstate: public our::State {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    std::unique_ptr<our::ForwardRenderer> renderer;
     our::FreeCameraControllerSystem cameraController;
     our::MovementSystem movementSystem;
+    our::SystemScheduler scheduler;
 
     void onInitialize() override {
         // First of all, we get the scene configuration from the app config
@@ -29,22 +33,46 @@ class Playstate: public our::State {
         }
         // We initialize the camera controller system since it needs a pointer to the app
         cameraController.enter(getApp());
+        // The systems are run by the scheduler with the data that each of them reads & writes
+        scheduler.clear();
+        scheduler.initialize(config.value("scheduler", nlohmann::json::object()));
+        scheduler.add("movement", our::access::components<our::MovementComponent>(), our::access::TRANSFORM,
+            [this](double deltaTime){ movementSystem.update(&world, (float)deltaTime, &getApp()->getJobSystem()); });
+        scheduler.add("camera-controller",
+            our::access::components<our::CameraComponent, our::FreeCameraControllerComponent>() | our::access::APPLICATION, our::access::TRANSFORM,
+            [this](double deltaTime){ cameraController.update(&world, (float)deltaTime); });
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        // The renderer type (forward or deferred) is selected by "type" in the renderer config
+        renderer.reset(our::createRendererFromConfig(config["renderer"]));
+        renderer->initialize(size, config["renderer"]);
     }
 
-    void onDraw(double deltaTime) override {
+    void onFixedUpdate(double fixedDeltaTime) override {
+        // The transforms at the start of the step are kept to interpolate the drawn transforms
+        world.beginSimulationStep();
         // Here, we just run a bunch of systems to control the world logic
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
-        // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
+        scheduler.run(fixedDeltaTime, &getApp()->getJobSystem());
+    }
+
+    void onDraw(double deltaTime) override {
+        // We use the renderer system to draw the scene between the last two simulation steps
+        world.beginInterpolation((float)getApp()->getInterpolationAlpha());
+        renderer->render(&world, &getApp()->getJobSystem());
+        world.endInterpolation();
+        // The entities marked for removal during this frame are destroyed at its end
+        world.deleteMarkedEntities();
+    }
+
+    void onImmediateGui() override {
+        // Show the renderer statistics & the system timings (if enabled in the config)
+        renderer->drawStatisticsGui();
+        scheduler.drawTimingsGui();
     }
 
     void onDestroy() override {
         // Don't forget to destroy the renderer
-        renderer.destroy();
+        renderer->destroy();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         cameraController.exit();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
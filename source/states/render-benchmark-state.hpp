@@ -0,0 +1,177 @@
+#pragma once
+
+#include <asset-loader.hpp>
+#include <ecs/world.hpp>
+#include <components/camera.hpp>
+#include <components/mesh-renderer.hpp>
+#include <systems/forward-renderer.hpp>
+#include <jobs/job-system.hpp>
+#include <application.hpp>
+
+#include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// This state measures the time taken by the renderer to build, cull and sort the commands of many mesh renderers
+// (see "ForwardRenderer::prepareCommands") on the calling thread only and with different numbers of workers.
+// Each frame, a few mesh renderers move, then each run updates its retained commands (see "RenderList") and also
+// builds all of them again from scratch. It checks that every run produces exactly the same sorted commands as the serial run.
+// The assets & the world (which must contain a camera) are read from "scene" in the config, then the mesh renderers are
+// scattered in a cube around the camera.
+// The parameters are read from "benchmark" in the config: "renderables" (default: 50000), "field-size" (default: 200),
+// "moving" (the fraction of the mesh renderers that move every frame, default: 0.01), "meshes" & "materials" (the names of
+// the assets given to the mesh renderers at random) and "workers" (the numbers of workers to compare, default: [1, 3, 7]).
+// The average times are printed when the state is destroyed (run it with "-f=<frames>").
+class RenderBenchmarkState: public our::State {
+
+    struct Result {
+        int workers = 0;
+        std::unique_ptr<our::JobSystem> jobs; // Null for the serial run
+        std::unique_ptr<our::ForwardRenderer> renderer; // Each run has its own retained commands
+        double retainedTime = 0, fullTime = 0; // The total times in seconds
+    };
+
+    our::World world;
+    our::CameraComponent* camera = nullptr;
+    std::vector<Result> results;
+    std::vector<our::Entity*> movers;
+    int renderableCount = 0;
+    int iterations = 0;
+    int errors = 0; // The number of runs whose commands differ from the serial run
+    long long dirtyEntries = 0; // The total number of retained commands that were rebuilt by the serial run
+
+    // The sort keys & matrices of the serial run (the other runs are compared with them)
+    std::vector<our::RenderCommand> expectedOpaque, expectedTransparent;
+
+    // Prepares the commands of a run & checks them against the serial run, then returns the time taken in seconds
+    double prepare(Result& result, const glm::mat4& VP) {
+        auto start = std::chrono::high_resolution_clock::now();
+        result.renderer->prepareCommands(&world, camera, VP, result.jobs.get());
+        double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        if(!result.jobs){
+            expectedOpaque = result.renderer->getOpaqueCommands();
+            expectedTransparent = result.renderer->getTransparentCommands();
+        } else if(!equal(expectedOpaque, result.renderer->getOpaqueCommands()) || !equal(expectedTransparent, result.renderer->getTransparentCommands())){
+            errors++;
+        }
+        return time;
+    }
+
+    static bool equal(const std::vector<our::RenderCommand>& first, const std::vector<our::RenderCommand>& second) {
+        if(first.size() != second.size()) return false;
+        for(size_t index = 0; index < first.size(); index++){
+            if(first[index].sortKey != second[index].sortKey || first[index].localToWorld != second[index].localToWorld) return false;
+        }
+        return true;
+    }
+
+    void onInitialize() override {
+        auto& config = getApp()->getConfig()["scene"];
+        if(config.contains("assets")) our::deserializeAllAssets(config["assets"]);
+        if(config.contains("world")) world.deserialize(config["world"]);
+
+        auto benchmark = getApp()->getConfig().value("benchmark", nlohmann::json::object());
+        renderableCount = benchmark.value("renderables", 50000);
+        float fieldSize = benchmark.value("field-size", 200.0f);
+        float moving = benchmark.value("moving", 0.01f);
+        std::vector<std::string> meshes = benchmark.value("meshes", std::vector<std::string>{});
+        std::vector<std::string> materials = benchmark.value("materials", std::vector<std::string>{});
+        std::vector<int> workerCounts = benchmark.value("workers", std::vector<int>{1, 3, 7});
+        iterations = errors = 0;
+        dirtyEntries = 0;
+
+        camera = nullptr;
+        world.view<our::CameraComponent>().each([this](our::Entity*, our::CameraComponent& found){
+            if(!camera) camera = &found;
+        });
+        if(!camera || meshes.empty() || materials.empty()){
+            std::cerr << "The render benchmark needs a camera in the world and at least one mesh & material" << std::endl;
+            return;
+        }
+
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(-0.5f * fieldSize, 0.5f * fieldSize);
+        std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+        std::uniform_int_distribution<size_t> mesh(0, meshes.size() - 1), material(0, materials.size() - 1);
+        for(int index = 0; index < renderableCount; index++){
+            our::Entity* entity = world.add();
+            entity->localTransform.position = glm::vec3(position(generator), position(generator), position(generator));
+            entity->localTransform.rotation = glm::vec3(angle(generator), angle(generator), angle(generator));
+            our::MeshRendererComponent* meshRenderer = entity->addComponent<our::MeshRendererComponent>();
+            meshRenderer->mesh = our::AssetLoader<our::Mesh>::get(meshes[mesh(generator)]);
+            meshRenderer->material = our::AssetLoader<our::Material>::get(materials[material(generator)]);
+            if(index < moving * renderableCount) movers.push_back(entity);
+        }
+        world.updateTransforms();
+
+        // The first run is the serial one, then each run has its own job system with the given number of workers
+        results.clear();
+        results.emplace_back();
+        for(int workers : workerCounts){
+            Result& result = results.emplace_back();
+            result.workers = workers;
+            result.jobs = std::make_unique<our::JobSystem>();
+            result.jobs->start(workers);
+        }
+        for(auto& result : results){
+            result.renderer = std::make_unique<our::ForwardRenderer>();
+            result.renderer->initialize(getApp()->getFrameBufferSize(), config.value("renderer", nlohmann::json::object()));
+        }
+    }
+
+    void onDraw(double) override {
+        if(!camera) return;
+        // The movers go back & forth so that they stay in the field
+        float step = iterations % 2 == 0 ? 0.1f : -0.1f;
+        for(auto entity : movers) entity->localTransform.position.x += step;
+        world.updateTransforms();
+
+        glm::mat4 VP = camera->getProjectionMatrix(getApp()->getFrameBufferSize()) * camera->getViewMatrix();
+        for(auto& result : results) result.retainedTime += prepare(result, VP);
+        dirtyEntries += results[0].renderer->getStatistics().renderList.updatedEntries;
+        for(auto& result : results){
+            result.renderer->clearRenderList();
+            result.fullTime += prepare(result, VP);
+        }
+        iterations++;
+    }
+
+    void onImmediateGui() override {
+        if(iterations == 0) return;
+        const auto& statistics = results[0].renderer->getStatistics();
+        ImGui::Begin("Render Benchmark");
+        ImGui::Text("Renderables: %d, Moving: %d, Errors: %d", renderableCount, (int)movers.size(), errors);
+        for(const auto& result : results){
+            ImGui::Text("%d workers: full %.3f ms (speedup: %.2f), retained %.3f ms", result.workers,
+                1000.0 * result.fullTime / iterations, results[0].fullTime / result.fullTime, 1000.0 * result.retainedTime / iterations);
+        }
+        ImGui::Text("Retained commands: %d", statistics.renderList.entries);
+        ImGui::End();
+    }
+
+    void onDestroy() override {
+        if(iterations > 0){
+            std::cout << "Render benchmark (" << renderableCount << " renderables, " << movers.size() << " moving, "
+                << iterations << " iterations, " << errors << " errors)" << std::endl;
+            std::cout << "  rebuilt retained commands: " << (double)dirtyEntries / iterations << " per frame" << std::endl;
+            for(const auto& result : results){
+                std::cout << "  " << (result.jobs ? std::to_string(result.workers) + " workers: " : "serial:    ")
+                    << "full " << 1000.0 * result.fullTime / iterations << " ms/iteration (speedup: " << results[0].fullTime / result.fullTime
+                    << "), retained " << 1000.0 * result.retainedTime / iterations << " ms/iteration" << std::endl;
+            }
+        }
+        for(auto& result : results){
+            if(result.jobs) result.jobs->stop();
+            if(result.renderer) result.renderer->destroy();
+        }
+        results.clear();
+        movers.clear();
+        world.clear();
+        our::clearAllAssets();
+    }
+};
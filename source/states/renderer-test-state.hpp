@@ -4,14 +4,16 @@
 #include <ecs/world.hpp>
 #include <components/camera.hpp>
 #include <components/mesh-renderer.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <application.hpp>
 
+#include <memory>
+
 // This state tests and shows how to use the Forward renderer.
 class RendererTestState: public our::State {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    std::unique_ptr<our::ForwardRenderer> renderer;
     
     void onInitialize() override {
         // First of all, we get the scene configuration from the app config
@@ -27,12 +29,19 @@ class RendererTestState: public our::State {
         }
 
         glm::ivec2 size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        // The renderer type (forward or deferred) is selected by "type" in the renderer config
+        renderer.reset(our::createRendererFromConfig(config["renderer"]));
+        renderer->initialize(size, config["renderer"]);
     }
 
     void onDraw(double deltaTime) override {
         // We simply call the renderer's "render" function and it should do all the rendering work
-        renderer.render(&world);
+        renderer->render(&world, &getApp()->getJobSystem());
+    }
+
+    void onImmediateGui() override {
+        // Show the renderer statistics (if enabled in the config)
+        renderer->drawStatisticsGui();
     }
 
     void onDestroy() override {
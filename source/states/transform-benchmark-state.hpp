@@ -0,0 +1,138 @@
+#pragma once
+
+#include <ecs/transform.hpp>
+#include <ecs/transform-batch.hpp>
+#include <application.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// This state measures the throughput of integrating the velocities & composing the matrices of many transforms.
+// It compares the scalar path (one transform at a time using "Transform::toMat4") with the batched path
+// (see "transform_batch") using each instruction set supported by the CPU, and checks that the batched matrices
+// match the scalar ones within "transform_batch::TOLERANCE".
+// The parameters are read from "benchmark" in the config: "transforms" (default: 100000) and "angle-range" (default: 100 radians).
+// The throughput is printed in entities per second when the state is destroyed (run it with "-f=<frames>").
+class TransformBenchmarkState: public our::State {
+
+    struct Result {
+        our::transform_batch::InstructionSet instructionSet;
+        double time = 0; // The total time in seconds
+        float error = 0; // The largest error (see "transform_batch::getError")
+    };
+
+    // The same transforms stored as an array of structures (for the scalar path) and as a structure of arrays (for the batches)
+    std::vector<our::Transform> transforms;
+    std::vector<glm::vec3> linearVelocities, angularVelocities;
+    our::transform_batch::TransformList transformList;
+    our::transform_batch::VelocityList velocityList;
+    std::vector<glm::mat4> scalarMatrices, batchMatrices;
+
+    double scalarTime = 0;
+    std::vector<Result> results;
+    int iterations = 0;
+
+    void onInitialize() override {
+        auto config = getApp()->getConfig().value("benchmark", nlohmann::json::object());
+        int count = config.value("transforms", 100000);
+        float angleRange = config.value("angle-range", 100.0f);
+        iterations = 0;
+        scalarTime = 0;
+
+        // Only the instruction sets supported by the CPU are compared
+        results.clear();
+        auto supported = our::transform_batch::getSupportedInstructionSet();
+        for(auto instructionSet : {our::transform_batch::InstructionSet::SCALAR, our::transform_batch::InstructionSet::SSE2, our::transform_batch::InstructionSet::AVX2})
+            if(instructionSet <= supported) results.push_back({instructionSet});
+
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> angle(-angleRange, angleRange);
+        std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+        std::uniform_real_distribution<float> velocity(-10.0f, 10.0f);
+        transforms.clear(); linearVelocities.clear(); angularVelocities.clear();
+        transformList.clear(); velocityList.clear();
+        for(int index = 0; index < count; index++){
+            our::Transform transform;
+            transform.position = glm::vec3(position(generator), position(generator), position(generator));
+            transform.rotation = glm::vec3(angle(generator), angle(generator), angle(generator));
+            transform.scale = glm::vec3(scale(generator), scale(generator), scale(generator));
+            glm::vec3 linear(velocity(generator), velocity(generator), velocity(generator));
+            glm::vec3 angular(velocity(generator), velocity(generator), velocity(generator));
+            transforms.push_back(transform);
+            linearVelocities.push_back(linear);
+            angularVelocities.push_back(angular);
+            transformList.push(transform);
+            velocityList.push(linear, angular);
+        }
+        scalarMatrices.resize(count);
+        batchMatrices.resize(count);
+    }
+
+    void onDraw(double) override {
+        using clock = std::chrono::high_resolution_clock;
+        // The transforms move back & forth so that their angles stay within the same range during the whole run
+        const float step = (iterations % 2 == 0 ? 1.0f : -1.0f) / 60.0f;
+
+        auto start = clock::now();
+        for(size_t index = 0; index < transforms.size(); index++){
+            transforms[index].position += step * linearVelocities[index];
+            transforms[index].rotation += step * angularVelocities[index];
+            scalarMatrices[index] = transforms[index].toMat4();
+        }
+        scalarTime += std::chrono::duration<double>(clock::now() - start).count();
+
+        // Each instruction set integrates a copy of the same transforms. Their matrices are compared with the scalar matrices
+        // of the transforms they integrated (the fused multiply add of AVX2 can round the integrated values differently).
+        auto selected = our::transform_batch::getInstructionSet();
+        our::transform_batch::TransformList original = transformList;
+        for(auto& result : results){
+            transformList = original;
+            our::transform_batch::setInstructionSet(result.instructionSet);
+            start = clock::now();
+            our::transform_batch::integrate(transformList, velocityList, step);
+            our::transform_batch::compose(transformList, batchMatrices.data());
+            result.time += std::chrono::duration<double>(clock::now() - start).count();
+            for(size_t index = 0; index < transforms.size(); index++)
+                result.error = std::max(result.error, our::transform_batch::getError(batchMatrices[index], transformList.get(index)));
+        }
+        our::transform_batch::setInstructionSet(selected);
+        iterations++;
+    }
+
+    // Returns the number of transforms processed per second given the total time of all the iterations
+    double getThroughput(double time) const {
+        return time > 0 ? (double)transforms.size() * iterations / time : 0.0;
+    }
+
+    void onImmediateGui() override {
+        if(iterations == 0) return;
+        ImGui::Begin("Transform Benchmark");
+        ImGui::Text("Transforms: %d", (int)transforms.size());
+        ImGui::Text("toMat4: %.2f M entities/s", 1e-6 * getThroughput(scalarTime));
+        for(const auto& result : results)
+            ImGui::Text("Batch (%s): %.2f M entities/s, max error: %g", our::transform_batch::getInstructionSetName(result.instructionSet),
+                1e-6 * getThroughput(result.time), result.error);
+        ImGui::End();
+    }
+
+    void onDestroy() override {
+        if(iterations > 0){
+            std::cout << "Transform benchmark (" << transforms.size() << " transforms, " << iterations << " iterations)" << std::endl;
+            std::cout << "  toMat4:        " << getThroughput(scalarTime) << " entities/s" << std::endl;
+            for(const auto& result : results){
+                std::cout << "  batch (" << our::transform_batch::getInstructionSetName(result.instructionSet) << "): "
+                    << getThroughput(result.time) << " entities/s, max error " << result.error
+                    << (result.error <= our::transform_batch::TOLERANCE ? " (within" : " (EXCEEDS")
+                    << " the tolerance " << our::transform_batch::TOLERANCE << ")" << std::endl;
+            }
+        }
+        transforms.clear();
+        transformList.clear();
+    }
+};